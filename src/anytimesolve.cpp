@@ -0,0 +1,175 @@
+#include "anytimesolve.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+
+uint64_t microsSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+uint64_t percentile(std::vector<uint64_t>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min<size_t>(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+} // namespace
+
+AnytimeSolve::AnytimeSolve(const CubieCube& cube, const AnytimeSolveOptions& options)
+    : options(options)
+    , started(std::chrono::steady_clock::now())
+    , cancelled(false)
+    , stopped(false)
+    , thread(&AnytimeSolve::run, this, cube)
+{
+}
+
+AnytimeSolve::~AnytimeSolve() {
+    cancel();
+    thread.join();
+}
+
+void AnytimeSolve::run(CubieCube cube) {
+    AnytimeOptions search;
+    search.deadline = started + options.budget + options.improveFor;
+    search.maxNodes = options.maxNodes;
+    search.targetLength = options.targetLength;
+    search.cancel = &cancelled;
+    Solver solver;
+    Solution solution;
+    solver.solveAnytime(cube, search, solution, [this](const Solution& found) {
+        std::lock_guard<std::mutex> lock(mutex);
+        best = found;
+        trace.push_back({microsSince(started), found.nodes, found.length});
+    });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+    changed.notify_all();
+}
+
+// Waits on the clock rather than on the search, which only looks at the
+// clock every thousand nodes or so
+bool AnytimeSolve::answer(Solution& out) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait_until(lock, started + options.budget, [this] { return stopped; });
+    out = best;
+    return out.found();
+}
+
+bool AnytimeSolve::finish(Solution& out) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return stopped; });
+    out = best;
+    return out.found();
+}
+
+bool AnytimeSolve::current(Solution& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    out = best;
+    return out.found();
+}
+
+void AnytimeSolve::cancel() {
+    cancelled = true;
+}
+
+std::vector<Improvement> AnytimeSolve::improvements() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return trace;
+}
+
+AnytimeProfile profileAnytime(const AnytimeProfileOptions& options,
+                              const std::function<void(uint64_t, uint64_t)>& progress) {
+    constexpr uint64_t PROFILE_CHUNK = 16;
+    Solver::warmUp();
+    // Per scramble: every improvement, and when the search stopped
+    std::vector<std::vector<Improvement>> traces(options.count);
+    std::vector<uint64_t> stops(options.count);
+    std::atomic<uint64_t> next{0};
+    std::atomic<uint64_t> done{0};
+    auto worker = [&] {
+        Solver solver;
+        Solution solution;
+        AnytimeOptions search;
+        search.maxNodes = options.maxNodes;
+        search.targetLength = options.targetLength;
+        for (uint64_t chunk = next++; chunk * PROFILE_CHUNK < options.count; chunk = next++) {
+            std::mt19937_64 gen(splitMix64(options.seed ^ splitMix64(chunk)));
+            uint64_t end = std::min(options.count, (chunk + 1) * PROFILE_CHUNK);
+            for (uint64_t i = chunk * PROFILE_CHUNK; i < end; i++) {
+                CubieCube cube = CubieCube::random(gen);
+                std::vector<Improvement>& trace = traces[i];
+                auto start = std::chrono::steady_clock::now();
+                search.deadline = start + options.budget;
+                solver.solveAnytime(cube, search, solution, [&](const Solution& found) {
+                    trace.push_back({microsSince(start), found.nodes, found.length});
+                });
+                stops[i] = microsSince(start);
+            }
+            done += end - chunk * PROFILE_CHUNK;
+        }
+    };
+
+    int threadCount = options.threads > 0 ? options.threads
+                                          : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back(worker);
+    }
+    if (progress) {
+        while (done < options.count) {
+            progress(done, options.count);
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+        progress(done, options.count);
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+
+    AnytimeProfile profile;
+    uint64_t budget = static_cast<uint64_t>(options.budget.count());
+    for (int shift = 8; shift >= 0; shift--) {
+        uint64_t micros = budget >> shift;
+        if (micros == 0 || (!profile.checkpoints.empty() && profile.checkpoints.back().micros == micros)) {
+            continue;
+        }
+        uint64_t solved = 0;
+        uint64_t atTarget = 0;
+        uint64_t lengthSum = 0;
+        for (const std::vector<Improvement>& trace : traces) {
+            int length = -1;
+            for (const Improvement& improvement : trace) {
+                if (improvement.micros <= micros) {
+                    length = improvement.length;
+                }
+            }
+            if (length >= 0) {
+                solved++;
+                lengthSum += static_cast<uint64_t>(length);
+                atTarget += length <= options.targetLength;
+            }
+        }
+        double count = options.count ? static_cast<double>(options.count) : 1.0;
+        profile.checkpoints.push_back({micros, solved / count, solved ? double(lengthSum) / solved : 0.0,
+                                       atTarget / count});
+    }
+
+    std::vector<uint64_t> firsts;
+    for (const std::vector<Improvement>& trace : traces) {
+        if (!trace.empty()) {
+            firsts.push_back(trace.front().micros);
+        }
+    }
+    profile.firstP50 = percentile(firsts, 0.50);
+    profile.firstP99 = percentile(firsts, 0.99);
+    profile.stopP50 = percentile(stops, 0.50);
+    profile.stopP99 = percentile(stops, 0.99);
+    profile.stopMax = stops.empty() ? 0 : stops.back();
+    return profile;
+}
@@ -0,0 +1,109 @@
+#ifndef RUBIKSCUBE_ANYTIMESOLVE_H
+#define RUBIKSCUBE_ANYTIMESOLVE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "solver.h"
+
+// A shorter solution found micros after the solve started, having
+// expanded nodes search nodes
+struct Improvement {
+    uint64_t micros;
+    uint64_t nodes;
+    int length;
+};
+
+struct AnytimeSolveOptions {
+    std::chrono::microseconds budget{10000};      // answer() returns by then
+    std::chrono::microseconds improveFor{0};      // search on this much longer
+    int targetLength = 20;                        // stop once this short
+    uint64_t maxNodes = 0;                        // 0 = no limit
+};
+
+// A solve that answers by a deadline and, if asked, goes on improving its
+// answer in the background: answer() returns the best solution found
+// within the budget, and finish() the best found by the time the search
+// stops. The search runs on a thread of its own with its own Solver; call
+// Solver::warmUp() first, or the first solve spends its budget building
+// tables.
+class AnytimeSolve {
+public:
+    AnytimeSolve(const CubieCube& cube, const AnytimeSolveOptions& options);
+    ~AnytimeSolve();  // cancels the search and waits for it
+
+    AnytimeSolve(const AnytimeSolve&) = delete;
+    AnytimeSolve& operator=(const AnytimeSolve&) = delete;
+
+    // Waits until the budget is spent or the search stops, whichever is
+    // first; false if there is no solution yet
+    bool answer(Solution& out);
+    // Waits until the search stops: it met the target, ran out of time or
+    // nodes, or was cancelled
+    bool finish(Solution& out);
+    // Best so far, without waiting
+    bool current(Solution& out) const;
+    void cancel();
+
+    // Every solution found so far, each shorter than the last
+    std::vector<Improvement> improvements() const;
+
+private:
+    void run(CubieCube cube);
+
+    AnytimeSolveOptions options;
+    std::chrono::steady_clock::time_point started;
+    std::atomic<bool> cancelled;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    Solution best;
+    std::vector<Improvement> trace;
+    bool stopped;
+
+    std::thread thread;  // last, so it starts after everything above
+};
+
+struct AnytimeProfileOptions {
+    uint64_t count = 0;  // random scrambles to solve
+    uint64_t seed = 1;
+    int threads = 0;     // 0 = one per hardware thread
+    std::chrono::microseconds budget{100000};
+    int targetLength = 20;
+    uint64_t maxNodes = 0;
+};
+
+// Solution quality at one point in time, over all scrambles of a profile
+struct AnytimeCheckpoint {
+    uint64_t micros;
+    double solved;      // fraction with some solution by then
+    double meanLength;  // of the best solutions by then, over those solved
+    double atTarget;    // fraction with a solution of at most targetLength
+};
+
+struct AnytimeProfile {
+    // At budget / 256, budget / 128, ... budget
+    std::vector<AnytimeCheckpoint> checkpoints;
+    // Time to the first solution, and until the search stopped (met the
+    // target or ran out of budget), in microseconds
+    uint64_t firstP50 = 0;
+    uint64_t firstP99 = 0;
+    uint64_t stopP50 = 0;
+    uint64_t stopP99 = 0;
+    uint64_t stopMax = 0;
+};
+
+// Anytime-solve count uniformly random scrambles on every core with the
+// same budget and record when each found each shorter solution, to choose
+// a budget that meets a latency target at the wanted solution length.
+// Scramble i depends only on the seed and i. progress, if set, is called
+// from the calling thread with (done, count).
+AnytimeProfile profileAnytime(const AnytimeProfileOptions& options,
+                              const std::function<void(uint64_t, uint64_t)>& progress = nullptr);
+
+#endif
@@ -0,0 +1,154 @@
+// Solver benchmark. Counts heap allocations during the timed loop and
+// fails if the solve path allocated after warm-up.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+#include "metrics.h"
+#include "solver.h"
+
+namespace {
+
+std::atomic<uint64_t> allocationCount{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+void usage(const char* program) {
+    std::fprintf(stderr, "usage: %s [-n solves] [-l maxLength] [-s seed] [-m text|json]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int count = 1000;
+    SolveOptions options;
+    unsigned seed = 1;
+    std::string metricsFormat;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        if (arg == "-n") count = std::atoi(argv[++i]);
+        else if (arg == "-l") options.maxLength = std::atoi(argv[++i]);
+        else if (arg == "-s") seed = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "-m") metricsFormat = argv[++i];
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // Everything the timed loop touches is prepared up front
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<> dis(0, NUM_MOVES - 1);
+    std::vector<CubieCube> states(count);
+    for (CubieCube& state : states) {
+        for (int i = 0; i < 40; i++) {
+            state.applyMove(dis(gen));
+        }
+    }
+    std::vector<double> latencies(count);
+
+    auto warmStart = std::chrono::steady_clock::now();
+    Solver::warmUp();
+    Solver solver;
+    Solution solution;
+    solver.solve(states[0], options, solution);
+    double warmUpSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - warmStart).count();
+
+    // The same solves without prefetching first, for comparison
+    SolveOptions plain = options;
+    plain.prefetch = false;
+    uint64_t plainNodes = 0;
+    auto plainStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        solver.solve(states[i], plain, solution);
+        plainNodes += solution.nodes;
+    }
+    double plainSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - plainStart).count();
+
+    metrics::reset();
+    uint64_t allocationsBefore = allocationCount.load();
+    uint64_t totalNodes = 0;
+    int totalLength = 0;
+    int failures = 0;
+    auto runStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        auto start = std::chrono::steady_clock::now();
+        if (solver.solve(states[i], options, solution)) {
+            totalLength += solution.length;
+        } else {
+            failures++;
+        }
+        totalNodes += solution.nodes;
+        latencies[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    uint64_t allocations = allocationCount.load() - allocationsBefore;
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies.empty() ? 0.0 : latencies[std::min<size_t>(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+
+    std::printf("warm-up          %.3f s\n", warmUpSeconds);
+    std::printf("solves           %d (%d failed)\n", count, failures);
+    std::printf("solves/s         %.1f\n", count / seconds);
+    std::printf("nodes/s          %.0f\n", totalNodes / seconds);
+    std::printf("  no prefetch    %.0f (%+.1f%% with)\n", plainNodes / plainSeconds,
+                100.0 * (totalNodes / seconds) / (plainNodes / plainSeconds) - 100.0);
+    std::printf("mean length      %.2f\n", count > failures ? double(totalLength) / (count - failures) : 0.0);
+    std::printf("latency p50      %.1f us\n", percentile(0.50));
+    std::printf("latency p99      %.1f us\n", percentile(0.99));
+    std::printf("latency max      %.1f us\n", latencies.empty() ? 0.0 : latencies.back());
+    std::printf("allocations      %llu\n", static_cast<unsigned long long>(allocations));
+
+    if (metricsFormat == "text") {
+        std::printf("%s", metrics::snapshot().toText().c_str());
+    } else if (metricsFormat == "json") {
+        std::printf("%s\n", metrics::snapshot().toJson().c_str());
+    }
+
+    if (allocations != 0) {
+        std::fprintf(stderr, "error: solve path allocated %llu times after warm-up\n",
+                     static_cast<unsigned long long>(allocations));
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -1,4 +1,7 @@
 #include "cube.h"
+#include "cubie.h"
+#include "metrics.h"
+#include "movetables.h"
 #include <algorithm>
 #include <random>
 
@@ -21,100 +24,36 @@ Cube::Cube() {
     }
 }
 
-void Cube::rotateFaceClockwise(Face face) {
-    auto& f = faces[static_cast<int>(face)];
-    Color temp[9];
-    std::copy(f.begin(), f.end(), temp);
-    
-    // Rotate corners
-    f[0] = temp[6];
-    f[2] = temp[0];
-    f[8] = temp[2];
-    f[6] = temp[8];
-    
-    // Rotate edges
-    f[1] = temp[3];
-    f[5] = temp[1];
-    f[7] = temp[5];
-    f[3] = temp[7];
-}
-
-void Cube::F() {
-    rotateFaceClockwise(Face::FRONT);
-    
-    const int edges[12] = {
-        // RIGHT left edge
-        static_cast<int>(Face::RIGHT) * 9 + 0,
-        static_cast<int>(Face::RIGHT) * 9 + 3,
-        static_cast<int>(Face::RIGHT) * 9 + 6,
-        // UP bottom edge
-        static_cast<int>(Face::UP) * 9 + 6,
-        static_cast<int>(Face::UP) * 9 + 7,
-        static_cast<int>(Face::UP) * 9 + 8,
-        // LEFT right edge
-        static_cast<int>(Face::LEFT) * 9 + 8,
-        static_cast<int>(Face::LEFT) * 9 + 5,
-        static_cast<int>(Face::LEFT) * 9 + 2,
-        // DOWN top edge
-        static_cast<int>(Face::DOWN) * 9 + 2,
-        static_cast<int>(Face::DOWN) * 9 + 1,
-        static_cast<int>(Face::DOWN) * 9 + 0
-    };
-    
-    rotateEdges(Face::FRONT, edges);
-}
-
-void Cube::FPrime() {
-    rotateFaceCounterClockwise(Face::FRONT);
-    
-    const int edges[12] = {
-        // DOWN top edge
-        static_cast<int>(Face::DOWN) * 9 + 2,
-        static_cast<int>(Face::DOWN) * 9 + 1,
-        static_cast<int>(Face::DOWN) * 9 + 0,
-        // LEFT right edge
-        static_cast<int>(Face::LEFT) * 9 + 8,
-        static_cast<int>(Face::LEFT) * 9 + 5,
-        static_cast<int>(Face::LEFT) * 9 + 2,
-        // UP bottom edge
-        static_cast<int>(Face::UP) * 9 + 6,
-        static_cast<int>(Face::UP) * 9 + 7,
-        static_cast<int>(Face::UP) * 9 + 8,
-        // RIGHT left edge
-        static_cast<int>(Face::RIGHT) * 9 + 0,
-        static_cast<int>(Face::RIGHT) * 9 + 3,
-        static_cast<int>(Face::RIGHT) * 9 + 6
-    };
-    
-    rotateEdges(Face::FRONT, edges);
-}
-
-void Cube::F2() {
-    F();
-    F();
-}
-
-// Helper function to rotate edges
-void Cube::rotateEdges(Face face, const int edges[12]) {
-    Color temp[3];
-    Color* flatFaces = reinterpret_cast<Color*>(faces.data());
-    
-    // Save first three edges
-    for (int i = 0; i < 3; i++) {
-        temp[i] = flatFaces[edges[i]];
-    }
-    
-    // Rotate edges
-    for (int i = 0; i < 9; i++) {
-        flatFaces[edges[i]] = flatFaces[edges[i + 3]];
-    }
-    
-    // Place saved edges
-    for (int i = 0; i < 3; i++) {
-        flatFaces[edges[i + 9]] = temp[i];
+// Every named turn is one gather through its compile-time facelet table
+void Cube::turn(int move) {
+    const FaceletPermutation& source = FACELET_MOVES[move];
+    const Facelets before = faces;
+    const Color* from = before[0].data();
+    Color* to = faces[0].data();
+    for (int i = 0; i < 54; i++) {
+        to[i] = from[source[i]];
     }
 }
 
+void Cube::F() { turn(0); }
+void Cube::FPrime() { turn(1); }
+void Cube::F2() { turn(2); }
+void Cube::B() { turn(3); }
+void Cube::BPrime() { turn(4); }
+void Cube::B2() { turn(5); }
+void Cube::L() { turn(6); }
+void Cube::LPrime() { turn(7); }
+void Cube::L2() { turn(8); }
+void Cube::R() { turn(9); }
+void Cube::RPrime() { turn(10); }
+void Cube::R2() { turn(11); }
+void Cube::U() { turn(12); }
+void Cube::UPrime() { turn(13); }
+void Cube::U2() { turn(14); }
+void Cube::D() { turn(15); }
+void Cube::DPrime() { turn(16); }
+void Cube::D2() { turn(17); }
+
 Color Cube::getFaceColor(int face, int row, int col) const {
     return faces[face][row * 3 + col];
 }
@@ -132,347 +71,158 @@ bool Cube::isSolved() const {
     return true;
 }
 
-void Cube::B() {
-    rotateFaceClockwise(Face::BACK);
-    
-    const int edges[12] = {
-        // LEFT left edge
-        static_cast<int>(Face::LEFT) * 9 + 0,
-        static_cast<int>(Face::LEFT) * 9 + 3,
-        static_cast<int>(Face::LEFT) * 9 + 6,
-        // UP top edge
-        static_cast<int>(Face::UP) * 9 + 2,
-        static_cast<int>(Face::UP) * 9 + 1,
-        static_cast<int>(Face::UP) * 9 + 0,
-        // RIGHT right edge
-        static_cast<int>(Face::RIGHT) * 9 + 8,
-        static_cast<int>(Face::RIGHT) * 9 + 5,
-        static_cast<int>(Face::RIGHT) * 9 + 2,
-        // DOWN bottom edge
-        static_cast<int>(Face::DOWN) * 9 + 6,
-        static_cast<int>(Face::DOWN) * 9 + 7,
-        static_cast<int>(Face::DOWN) * 9 + 8
-    };
+// Update the scramble function to include all moves
+void Cube::scramble(int numMoves) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> dis(0, 17); // 18 possible moves
     
-    rotateEdges(Face::BACK, edges);
+    for (int i = 0; i < numMoves; i++) {
+        applyMove(dis(gen));
+    }
 }
 
-void Cube::BPrime() {
-    rotateFaceCounterClockwise(Face::BACK);
-    
-    const int edges[12] = {
-        // LEFT left edge
-        static_cast<int>(Face::LEFT) * 9 + 0,
-        static_cast<int>(Face::LEFT) * 9 + 3,
-        static_cast<int>(Face::LEFT) * 9 + 6,
-        // DOWN bottom edge
-        static_cast<int>(Face::DOWN) * 9 + 6,
-        static_cast<int>(Face::DOWN) * 9 + 7,
-        static_cast<int>(Face::DOWN) * 9 + 8,
-        // RIGHT right edge
-        static_cast<int>(Face::RIGHT) * 9 + 8,
-        static_cast<int>(Face::RIGHT) * 9 + 5,
-        static_cast<int>(Face::RIGHT) * 9 + 2,
-        // UP top edge
-        static_cast<int>(Face::UP) * 9 + 2,
-        static_cast<int>(Face::UP) * 9 + 1,
-        static_cast<int>(Face::UP) * 9 + 0
-    };
-    
-    rotateEdges(Face::BACK, edges);
+void Cube::applyMove(int move) {
+    if (move < 0 || move >= NUM_MOVES) {
+        throw CubeException("Invalid move number: " + std::to_string(move));
+    }
+    CUBE_METRIC_ADD(Counter::FACELET_MOVES, 1);
+    turn(move);
 }
 
-void Cube::B2() {
-    B();
-    B();
-}
+namespace {
 
-void Cube::L() {
-    rotateFaceClockwise(Face::LEFT);
-    
-    const int edges[12] = {
-        // FRONT left edge
-        static_cast<int>(Face::FRONT) * 9 + 0,
-        static_cast<int>(Face::FRONT) * 9 + 3,
-        static_cast<int>(Face::FRONT) * 9 + 6,
-        // UP left edge
-        static_cast<int>(Face::UP) * 9 + 0,
-        static_cast<int>(Face::UP) * 9 + 3,
-        static_cast<int>(Face::UP) * 9 + 6,
-        // BACK right edge
-        static_cast<int>(Face::BACK) * 9 + 8,
-        static_cast<int>(Face::BACK) * 9 + 5,
-        static_cast<int>(Face::BACK) * 9 + 2,
-        // DOWN left edge
-        static_cast<int>(Face::DOWN) * 9 + 0,
-        static_cast<int>(Face::DOWN) * 9 + 3,
-        static_cast<int>(Face::DOWN) * 9 + 6
-    };
-    
-    rotateEdges(Face::LEFT, edges);
-}
+const char* const moveNames[NUM_MOVES] = {
+    "F", "F'", "F2", "B", "B'", "B2", "L", "L'", "L2",
+    "R", "R'", "R2", "U", "U'", "U2", "D", "D'", "D2"
+};
 
-void Cube::LPrime() {
-    rotateFaceCounterClockwise(Face::LEFT);
-    
-    const int edges[12] = {
-        // DOWN left edge
-        static_cast<int>(Face::DOWN) * 9 + 0,
-        static_cast<int>(Face::DOWN) * 9 + 3,
-        static_cast<int>(Face::DOWN) * 9 + 6,
-        // BACK right edge
-        static_cast<int>(Face::BACK) * 9 + 8,
-        static_cast<int>(Face::BACK) * 9 + 5,
-        static_cast<int>(Face::BACK) * 9 + 2,
-        // UP left edge
-        static_cast<int>(Face::UP) * 9 + 0,
-        static_cast<int>(Face::UP) * 9 + 3,
-        static_cast<int>(Face::UP) * 9 + 6,
-        // FRONT left edge
-        static_cast<int>(Face::FRONT) * 9 + 0,
-        static_cast<int>(Face::FRONT) * 9 + 3,
-        static_cast<int>(Face::FRONT) * 9 + 6
-    };
-    
-    rotateEdges(Face::LEFT, edges);
+} // namespace
+
+const char* Cube::moveName(int move) {
+    if (move < 0 || move >= NUM_MOVES) {
+        throw CubeException("Invalid move number: " + std::to_string(move));
+    }
+    return moveNames[move];
 }
 
-void Cube::L2() {
-    L();
-    L();
+int Cube::parseMove(const std::string& move) {
+    for (int i = 0; i < NUM_MOVES; i++) {
+        if (move == moveNames[i]) {
+            return i;
+        }
+    }
+    return -1;
 }
 
-void Cube::R() {
-    rotateFaceClockwise(Face::RIGHT);
-    
-    const int edges[12] = {
-        // FRONT right edge
-        static_cast<int>(Face::FRONT) * 9 + 8,
-        static_cast<int>(Face::FRONT) * 9 + 5,
-        static_cast<int>(Face::FRONT) * 9 + 2,
-        // DOWN right edge
-        static_cast<int>(Face::DOWN) * 9 + 8,
-        static_cast<int>(Face::DOWN) * 9 + 5,
-        static_cast<int>(Face::DOWN) * 9 + 2,
-        // BACK left edge
-        static_cast<int>(Face::BACK) * 9 + 0,
-        static_cast<int>(Face::BACK) * 9 + 3,
-        static_cast<int>(Face::BACK) * 9 + 6,
-        // UP right edge
-        static_cast<int>(Face::UP) * 9 + 8,
-        static_cast<int>(Face::UP) * 9 + 5,
-        static_cast<int>(Face::UP) * 9 + 2
-    };
-    
-    rotateEdges(Face::RIGHT, edges);
+bool Cube::isValidMove(const std::string& move) const {
+    return parseMove(move) >= 0;
 }
 
-void Cube::RPrime() {
-    rotateFaceCounterClockwise(Face::RIGHT);
-    
-    const int edges[12] = {
-        // FRONT right edge
-        static_cast<int>(Face::FRONT) * 9 + 8,
-        static_cast<int>(Face::FRONT) * 9 + 5,
-        static_cast<int>(Face::FRONT) * 9 + 2,
-        // UP right edge
-        static_cast<int>(Face::UP) * 9 + 8,
-        static_cast<int>(Face::UP) * 9 + 5,
-        static_cast<int>(Face::UP) * 9 + 2,
-        // BACK left edge
-        static_cast<int>(Face::BACK) * 9 + 0,
-        static_cast<int>(Face::BACK) * 9 + 3,
-        static_cast<int>(Face::BACK) * 9 + 6,
-        // DOWN right edge
-        static_cast<int>(Face::DOWN) * 9 + 8,
-        static_cast<int>(Face::DOWN) * 9 + 5,
-        static_cast<int>(Face::DOWN) * 9 + 2
+void Cube::reset() {
+    // Reset to initial solved state
+    const Color centerColors[6] = {
+        Color::GREEN,   // Front (0)
+        Color::BLUE,    // Back  (1)
+        Color::ORANGE,  // Left  (2)
+        Color::RED,     // Right (3)
+        Color::WHITE,   // Up    (4)
+        Color::YELLOW   // Down  (5)
     };
     
-    rotateEdges(Face::RIGHT, edges);
+    for (int face = 0; face < 6; face++) {
+        for (int i = 0; i < 9; i++) {
+            faces[face][i] = centerColors[face];
+        }
+    }
 }
 
-void Cube::R2() {
-    R();
-    R();
-}
+namespace {
 
-void Cube::U() {
-    rotateFaceClockwise(Face::UP);
-    
-    const int edges[12] = {
-        // RIGHT top edge
-        static_cast<int>(Face::RIGHT) * 9 + 0,
-        static_cast<int>(Face::RIGHT) * 9 + 1,
-        static_cast<int>(Face::RIGHT) * 9 + 2,
-        // BACK top edge
-        static_cast<int>(Face::BACK) * 9 + 0,
-        static_cast<int>(Face::BACK) * 9 + 1,
-        static_cast<int>(Face::BACK) * 9 + 2,
-        // LEFT top edge
-        static_cast<int>(Face::LEFT) * 9 + 0,
-        static_cast<int>(Face::LEFT) * 9 + 1,
-        static_cast<int>(Face::LEFT) * 9 + 2,
-        // FRONT top edge
-        static_cast<int>(Face::FRONT) * 9 + 0,
-        static_cast<int>(Face::FRONT) * 9 + 1,
-        static_cast<int>(Face::FRONT) * 9 + 2
-    };
-    
-    rotateEdges(Face::UP, edges);
-}
+// Colour letters used by getState()/setState(), indexed by Color
+const char colorLetters[6] = {'G', 'B', 'O', 'R', 'W', 'Y'};
 
-void Cube::UPrime() {
-    rotateFaceCounterClockwise(Face::UP);
-    
-    const int edges[12] = {
-        // FRONT top edge
-        static_cast<int>(Face::FRONT) * 9 + 0,
-        static_cast<int>(Face::FRONT) * 9 + 1,
-        static_cast<int>(Face::FRONT) * 9 + 2,
-        // LEFT top edge
-        static_cast<int>(Face::LEFT) * 9 + 0,
-        static_cast<int>(Face::LEFT) * 9 + 1,
-        static_cast<int>(Face::LEFT) * 9 + 2,
-        // BACK top edge
-        static_cast<int>(Face::BACK) * 9 + 0,
-        static_cast<int>(Face::BACK) * 9 + 1,
-        static_cast<int>(Face::BACK) * 9 + 2,
-        // RIGHT top edge
-        static_cast<int>(Face::RIGHT) * 9 + 0,
-        static_cast<int>(Face::RIGHT) * 9 + 1,
-        static_cast<int>(Face::RIGHT) * 9 + 2
-    };
-    
-    rotateEdges(Face::UP, edges);
+int colorFromLetter(char letter) {
+    for (int i = 0; i < 6; i++) {
+        if (colorLetters[i] == letter) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+const char* StateValidation::message() const {
+    switch (error) {
+        case StateError::NONE: return "valid state";
+        case StateError::BAD_LENGTH: return "state must have exactly 54 facelets";
+        case StateError::BAD_COLOR: return "unknown colour";
+        case StateError::BAD_CENTERS: return "centres do not match the colour scheme";
+        case StateError::BAD_COLOR_COUNT: return "each colour must appear exactly 9 times";
+        case StateError::BAD_CORNER: return "corner colours do not form a real corner";
+        case StateError::BAD_EDGE: return "edge colours do not form a real edge";
+        case StateError::DUPLICATE_CORNER: return "corner appears more than once";
+        case StateError::DUPLICATE_EDGE: return "edge appears more than once";
+        case StateError::CORNER_TWIST: return "a corner is twisted";
+        case StateError::EDGE_FLIP: return "an edge is flipped";
+        case StateError::PERMUTATION_PARITY: return "two pieces are swapped";
+    }
+    return "unknown error";
 }
 
-void Cube::U2() {
-    U();
-    U();
+StateValidation Cube::validate(const Facelets& facelets) {
+    CubieCube cubies;
+    return faceletsToCubie(facelets, cubies);
 }
 
-void Cube::D() {
-    rotateFaceClockwise(Face::DOWN);
-    
-    const int edges[12] = {
-        // FRONT bottom edge
-        static_cast<int>(Face::FRONT) * 9 + 6,
-        static_cast<int>(Face::FRONT) * 9 + 7,
-        static_cast<int>(Face::FRONT) * 9 + 8,
-        // LEFT bottom edge
-        static_cast<int>(Face::LEFT) * 9 + 6,
-        static_cast<int>(Face::LEFT) * 9 + 7,
-        static_cast<int>(Face::LEFT) * 9 + 8,
-        // BACK bottom edge
-        static_cast<int>(Face::BACK) * 9 + 6,
-        static_cast<int>(Face::BACK) * 9 + 7,
-        static_cast<int>(Face::BACK) * 9 + 8,
-        // RIGHT bottom edge
-        static_cast<int>(Face::RIGHT) * 9 + 6,
-        static_cast<int>(Face::RIGHT) * 9 + 7,
-        static_cast<int>(Face::RIGHT) * 9 + 8
-    };
-    
-    rotateEdges(Face::DOWN, edges);
+StateValidation Cube::validate(const std::string& state) {
+    if (state.size() != 54) {
+        return {StateError::BAD_LENGTH, -1};
+    }
+    Facelets facelets;
+    for (int i = 0; i < 54; i++) {
+        int color = colorFromLetter(state[i]);
+        if (color < 0) {
+            return {StateError::BAD_COLOR, i};
+        }
+        facelets[i / 9][i % 9] = static_cast<Color>(color);
+    }
+    return validate(facelets);
 }
 
-void Cube::DPrime() {
-    rotateFaceCounterClockwise(Face::DOWN);
-    
-    const int edges[12] = {
-        // LEFT bottom edge
-        static_cast<int>(Face::LEFT) * 9 + 6,
-        static_cast<int>(Face::LEFT) * 9 + 7,
-        static_cast<int>(Face::LEFT) * 9 + 8,
-        // FRONT bottom edge
-        static_cast<int>(Face::FRONT) * 9 + 6,
-        static_cast<int>(Face::FRONT) * 9 + 7,
-        static_cast<int>(Face::FRONT) * 9 + 8,
-        // RIGHT bottom edge
-        static_cast<int>(Face::RIGHT) * 9 + 6,
-        static_cast<int>(Face::RIGHT) * 9 + 7,
-        static_cast<int>(Face::RIGHT) * 9 + 8,
-        // BACK bottom edge
-        static_cast<int>(Face::BACK) * 9 + 6,
-        static_cast<int>(Face::BACK) * 9 + 7,
-        static_cast<int>(Face::BACK) * 9 + 8
-    };
-    
-    rotateEdges(Face::DOWN, edges);
+StateValidation Cube::validate() const {
+    return validate(faces);
 }
 
-void Cube::D2() {
-    D();
-    D();
+bool Cube::isValidState() const {
+    return validate().ok();
 }
 
-// Update the scramble function to include all moves
-void Cube::scramble(int numMoves) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 17); // 18 possible moves
-    
-    for (int i = 0; i < numMoves; i++) {
-        int move = dis(gen);
-        switch (move) {
-            case 0: F(); break;
-            case 1: FPrime(); break;
-            case 2: F2(); break;
-            case 3: B(); break;
-            case 4: BPrime(); break;
-            case 5: B2(); break;
-            case 6: L(); break;
-            case 7: LPrime(); break;
-            case 8: L2(); break;
-            case 9: R(); break;
-            case 10: RPrime(); break;
-            case 11: R2(); break;
-            case 12: U(); break;
-            case 13: UPrime(); break;
-            case 14: U2(); break;
-            case 15: D(); break;
-            case 16: DPrime(); break;
-            case 17: D2(); break;
-        }
+// State string: 54 colour letters, face by face in Face order
+std::string Cube::getState() const {
+    std::string state(54, ' ');
+    for (int i = 0; i < 54; i++) {
+        state[i] = colorLetters[static_cast<int>(faces[i / 9][i % 9])];
     }
+    return state;
 }
 
-// Add helper function for counter-clockwise rotation
-void Cube::rotateFaceCounterClockwise(Face face) {
-    auto& f = faces[static_cast<int>(face)];
-    Color temp[9];
-    std::copy(f.begin(), f.end(), temp);
-    
-    // Rotate corners counter-clockwise
-    f[0] = temp[2];
-    f[2] = temp[8];
-    f[8] = temp[6];
-    f[6] = temp[0];
-    
-    // Rotate edges counter-clockwise
-    f[1] = temp[5];
-    f[5] = temp[7];
-    f[7] = temp[3];
-    f[3] = temp[1];
-}
-
-void Cube::reset() {
-    // Reset to initial solved state
-    const Color centerColors[6] = {
-        Color::GREEN,   // Front (0)
-        Color::BLUE,    // Back  (1)
-        Color::ORANGE,  // Left  (2)
-        Color::RED,     // Right (3)
-        Color::WHITE,   // Up    (4)
-        Color::YELLOW   // Down  (5)
-    };
-    
-    for (int face = 0; face < 6; face++) {
-        for (int i = 0; i < 9; i++) {
-            faces[face][i] = centerColors[face];
-        }
+bool Cube::setFacelets(const Facelets& facelets) {
+    if (!validate(facelets).ok()) {
+        return false;
     }
+    faces = facelets;
+    return true;
 }
 
-// Implement other moves (B, L, R, U, D and their variants) similarly... 
\ No newline at end of file
+// Only reachable states are accepted; the cube is left untouched otherwise
+bool Cube::setState(const std::string& state) {
+    if (!validate(state).ok()) {
+        return false;
+    }
+    for (int i = 0; i < 54; i++) {
+        faces[i / 9][i % 9] = static_cast<Color>(colorFromLetter(state[i]));
+    }
+    return true;
+} 
\ No newline at end of file
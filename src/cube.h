@@ -9,6 +9,36 @@
 enum class Face { FRONT, BACK, LEFT, RIGHT, UP, DOWN };
 enum class Color { GREEN, BLUE, ORANGE, RED, WHITE, YELLOW };
 
+// Reasons a facelet state can be rejected by Cube::validate()
+enum class StateError {
+    NONE,
+    BAD_LENGTH,          // state string is not 54 facelets long
+    BAD_COLOR,           // state string contains an unknown colour letter
+    BAD_CENTERS,         // centres are not in the fixed colour scheme
+    BAD_COLOR_COUNT,     // some colour does not appear exactly 9 times
+    BAD_CORNER,          // a corner's colours do not form a real corner
+    BAD_EDGE,            // an edge's colours do not form a real edge
+    DUPLICATE_CORNER,    // the same corner appears twice
+    DUPLICATE_EDGE,      // the same edge appears twice
+    CORNER_TWIST,        // total corner twist is not a multiple of 3
+    EDGE_FLIP,           // total edge flip is odd
+    PERMUTATION_PARITY   // corner and edge permutation parities differ
+};
+
+// Outcome of validating a state. position is the facelet, colour, corner or
+// edge slot that triggered the rejection, or -1 when it does not apply.
+struct StateValidation {
+    StateError error = StateError::NONE;
+    int position = -1;
+
+    bool ok() const { return error == StateError::NONE; }
+    const char* message() const;
+};
+
+// Moves are numbered face * 3 + {0: clockwise, 1: prime, 2: double},
+// with faces in Face order (F, F', F2, B, B', B2, ...)
+constexpr int NUM_MOVES = 18;
+
 class CubeException : public std::runtime_error {
 public:
     explicit CubeException(const std::string& message) 
@@ -17,6 +47,9 @@ public:
 
 class Cube {
 public:
+    // faces[Face][row * 3 + col]
+    using Facelets = std::array<std::array<Color, 9>, 6>;
+
     Cube();
     
     // Basic moves (clockwise)
@@ -43,6 +76,11 @@ public:
     void U2();
     void D2();
     
+    // Apply a move by number; throws CubeException if out of range
+    void applyMove(int move);
+    static const char* moveName(int move);
+    static int parseMove(const std::string& move);  // -1 if not a move
+    
     // Get the current state of the cube
     Color getFaceColor(int face, int row, int col) const;
     bool isSolved() const;
@@ -55,18 +93,22 @@ public:
     void redo();
     void reset();
     
+    // Recover the cubies from the facelets and check that the state is
+    // reachable. Does not allocate, so it is cheap enough for bulk input.
+    StateValidation validate() const;
+    static StateValidation validate(const Facelets& facelets);
+    static StateValidation validate(const std::string& state);
+    
+    const Facelets& getFacelets() const { return faces; }
+    bool setFacelets(const Facelets& facelets);  // false if unreachable
+    
 private:
     // Each face is represented as a 3x3 grid
     // faces[Face][row * 3 + col] gives the color at that position
-    std::array<std::array<Color, 9>, 6> faces;
-    
-    void rotateFaceClockwise(Face face);
-    void rotateFaceCounterClockwise(Face face);
-    void rotateFaceTwice(Face face);
+    Facelets faces;
     
-    // Helper functions for edge and corner rotations
-    void rotateEdges(Face face, const int edges[12]);
-    void rotateCorners(Face face, const int corners[8]);
+    // Apply a move by number, without checking or counting it
+    void turn(int move);
     
     std::vector<std::string> moveHistory;
     std::vector<std::string> undoStack;
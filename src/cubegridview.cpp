@@ -0,0 +1,440 @@
+#include "cubegridview.h"
+#include <QMouseEvent>
+#include <QSurfaceFormat>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+// Vertex shader: one cube per instance. The instance attribute is the cube
+// index, which gives both the grid cell and the colour texture texel; the
+// texture layout comes in as uniforms from the same constants the upload
+// uses.
+const char* vertexShaderSource =
+    "#version 330 core\n"
+    "layout(location = 0) in vec3 vertex;\n"
+    "layout(location = 1) in vec3 normal;\n"
+    "layout(location = 2) in float facelet;\n"
+    "layout(location = 3) in uint cube;\n"
+    "uniform mat4 viewProjection;\n"
+    "uniform mat4 model;\n"
+    "uniform int columns;\n"
+    "uniform int cubesPerRow;\n"
+    "uniform int texelsPerCube;\n"
+    "uniform float spacing;\n"
+    "uniform usampler2D colors;\n"
+    "uniform vec3 palette[7];\n"
+    "out vec3 norm;\n"
+    "out vec3 fragColor;\n"
+    "void main() {\n"
+    "   int index = int(cube);\n"
+    "   vec3 color = palette[6];\n"
+    "   if (facelet >= 0.0) {\n"
+    "       ivec2 texel = ivec2((index % cubesPerRow) * texelsPerCube + int(facelet), index / cubesPerRow);\n"
+    "       color = palette[min(int(texelFetch(colors, texel, 0).r), 6)];\n"
+    "   }\n"
+    "   vec3 offset = vec3(float(index % columns), -float(index / columns), 0.0) * spacing;\n"
+    "   norm = mat3(model) * normal;\n"
+    "   fragColor = color;\n"
+    "   gl_Position = viewProjection * vec4((model * vec4(vertex, 1.0)).xyz + offset, 1.0);\n"
+    "}\n";
+
+const char* fragmentShaderSource =
+    "#version 330 core\n"
+    "in vec3 norm;\n"
+    "in vec3 fragColor;\n"
+    "out vec4 outColor;\n"
+    "void main() {\n"
+    "   vec3 L = normalize(vec3(0.4, 0.6, 1.0));\n"
+    "   float NL = max(dot(normalize(norm), L), 0.0);\n"
+    "   outColor = vec4(fragColor * (0.3 + 0.7 * NL), 1.0);\n"
+    "}\n";
+
+// Same colours as CubeRenderer, indexed by Color; the last entry is the body
+const QVector3D palette[7] = {
+    QVector3D(0.0f, 1.0f, 0.0f),  // GREEN
+    QVector3D(0.0f, 0.0f, 1.0f),  // BLUE
+    QVector3D(1.0f, 0.5f, 0.0f),  // ORANGE
+    QVector3D(1.0f, 0.0f, 0.0f),  // RED
+    QVector3D(1.0f, 1.0f, 1.0f),  // WHITE
+    QVector3D(1.0f, 1.0f, 0.0f),  // YELLOW
+    QVector3D(0.1f, 0.1f, 0.1f)   // body
+};
+
+struct MeshVertex {
+    GLfloat position[3];
+    GLfloat normal[3];
+    GLfloat facelet;  // texel within the cube's row segment, -1 for the body
+};
+
+// Outward normal of each face, in Face order
+const QVector3D faceNormals[6] = {
+    QVector3D(0, 0, 1), QVector3D(0, 0, -1), QVector3D(-1, 0, 0),
+    QVector3D(1, 0, 0), QVector3D(0, 1, 0), QVector3D(0, -1, 0)
+};
+
+// Centre of sticker (row, col) on a cube spanning -1.5..1.5, using the
+// same facelet layout as CubeRenderer
+QVector3D stickerCenter(int face, int row, int col) {
+    const float r = float(row - 1);
+    const float c = float(col - 1);
+    switch (static_cast<Face>(face)) {
+        case Face::FRONT: return QVector3D(c, -r, 1.5f);
+        case Face::BACK: return QVector3D(-c, -r, -1.5f);
+        case Face::LEFT: return QVector3D(-1.5f, -r, c);
+        case Face::RIGHT: return QVector3D(1.5f, -r, -c);
+        case Face::UP: return QVector3D(c, 1.5f, r);
+        case Face::DOWN: return QVector3D(c, -1.5f, -r);
+    }
+    return QVector3D();
+}
+
+// Two triangles facing along normal, counter-clockwise seen from outside
+void addQuad(std::vector<MeshVertex>& mesh, const QVector3D& center, const QVector3D& normal,
+             float halfSize, float facelet) {
+    QVector3D u = normal.y() != 0.0f ? QVector3D(1, 0, 0) : QVector3D(0, 1, 0);
+    QVector3D v = QVector3D::crossProduct(normal, u);
+    u *= halfSize;
+    v *= halfSize;
+    const QVector3D corners[4] = {center - u - v, center + u - v, center + u + v, center - u + v};
+    for (int corner : {0, 1, 2, 0, 2, 3}) {
+        mesh.push_back({{corners[corner].x(), corners[corner].y(), corners[corner].z()},
+                        {normal.x(), normal.y(), normal.z()}, facelet});
+    }
+}
+
+const float FIELD_OF_VIEW = 45.0f;
+const float CUBE_RADIUS = 1.5f * 1.7321f;  // bounding sphere of the cube
+
+} // namespace
+
+CubeGridView::CubeGridView(QWidget* parent)
+    : QOpenGLWidget(parent)
+    , shaderProgram(nullptr)
+    , meshBuffer(QOpenGLBuffer::VertexBuffer)
+    , instanceBuffer(QOpenGLBuffer::VertexBuffer)
+    , vao()
+    , colorTexture(0)
+    , textureRows(0)
+    , maxCubes(0)
+    , detailedVertexCount(0)
+    , coarseVertexCount(0)
+    , uploadAll(true)
+    , columns(1)
+    , centerX(0.0f)
+    , centerY(0.0f)
+    , distance(10.0f)
+    , mousePressed(false)
+{
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    setFormat(format);
+    setFocusPolicy(Qt::StrongFocus);
+}
+
+CubeGridView::~CubeGridView()
+{
+    makeCurrent();
+    if (colorTexture) {
+        glDeleteTextures(1, &colorTexture);
+    }
+    delete shaderProgram;
+    instanceBuffer.destroy();
+    meshBuffer.destroy();
+    vao.destroy();
+    doneCurrent();
+}
+
+void CubeGridView::setCubes(const std::vector<Cube>& cubes, int columnCount)
+{
+    colors.assign(cubes.size() * TEXELS_PER_CUBE, 0);
+    for (size_t i = 0; i < cubes.size(); i++) {
+        writeColors(static_cast<int>(i), cubes[i]);
+    }
+    columns = columnCount > 0 ? columnCount
+                              : std::max(1, static_cast<int>(std::ceil(std::sqrt(double(cubes.size())))));
+    dirtyCubes.clear();
+    uploadAll = true;
+    fitView();
+    update();
+}
+
+void CubeGridView::setCube(int index, const Cube& cube)
+{
+    if (index < 0 || index >= cubeCount()) {
+        return;
+    }
+    writeColors(index, cube);
+    if (!uploadAll) {
+        dirtyCubes.push_back(index);
+    }
+    update();
+}
+
+void CubeGridView::writeColors(int index, const Cube& cube)
+{
+    uint8_t* texels = colors.data() + size_t(index) * TEXELS_PER_CUBE;
+    for (int face = 0; face < 6; face++) {
+        int counts[6] = {};
+        for (int i = 0; i < 9; i++) {
+            int color = static_cast<int>(cube.getFaceColor(face, i / 3, i % 3));
+            texels[face * 9 + i] = static_cast<uint8_t>(color);
+            counts[color]++;
+        }
+        // The coarse mesh shows each face in its most common colour
+        texels[54 + face] = static_cast<uint8_t>(std::max_element(counts, counts + 6) - counts);
+    }
+}
+
+void CubeGridView::initializeGL()
+{
+    initializeOpenGLFunctions();
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    maxCubes = maxTextureSize * CUBES_PER_ROW;
+
+    initShaders();
+    initMesh();
+
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+}
+
+void CubeGridView::initShaders()
+{
+    shaderProgram = new QOpenGLShaderProgram;
+    shaderProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource);
+    shaderProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource);
+    shaderProgram->link();
+
+    shaderProgram->bind();
+    shaderProgram->setUniformValue("colors", 0);
+    shaderProgram->setUniformValueArray("palette", palette, 7);
+    shaderProgram->setUniformValue("spacing", SPACING);
+    shaderProgram->setUniformValue("cubesPerRow", CUBES_PER_ROW);
+    shaderProgram->setUniformValue("texelsPerCube", TEXELS_PER_CUBE);
+
+    // Every cube is drawn from the same angle so three faces show
+    QMatrix4x4 model;
+    model.rotate(30.0f, 1.0f, 0.0f, 0.0f);
+    model.rotate(-35.0f, 0.0f, 1.0f, 0.0f);
+    shaderProgram->setUniformValue("model", model);
+    shaderProgram->release();
+}
+
+void CubeGridView::initMesh()
+{
+    std::vector<MeshVertex> mesh;
+
+    // Detailed: black body with 54 stickers floating just above it
+    for (int face = 0; face < 6; face++) {
+        addQuad(mesh, faceNormals[face] * 1.5f, faceNormals[face], 1.5f, -1.0f);
+    }
+    for (int face = 0; face < 6; face++) {
+        for (int i = 0; i < 9; i++) {
+            QVector3D center = stickerCenter(face, i / 3, i % 3) + faceNormals[face] * 0.01f;
+            addQuad(mesh, center, faceNormals[face], 0.45f, float(face * 9 + i));
+        }
+    }
+    detailedVertexCount = static_cast<int>(mesh.size());
+
+    // Coarse: one quad per face in the face's majority colour
+    for (int face = 0; face < 6; face++) {
+        addQuad(mesh, faceNormals[face] * 1.5f, faceNormals[face], 1.5f, float(54 + face));
+    }
+    coarseVertexCount = static_cast<int>(mesh.size()) - detailedVertexCount;
+
+    vao.create();
+    vao.bind();
+
+    meshBuffer.create();
+    meshBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    meshBuffer.bind();
+    meshBuffer.allocate(mesh.data(), static_cast<int>(mesh.size() * sizeof(MeshVertex)));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
+                          reinterpret_cast<void*>(offsetof(MeshVertex, position)));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
+                          reinterpret_cast<void*>(offsetof(MeshVertex, normal)));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
+                          reinterpret_cast<void*>(offsetof(MeshVertex, facelet)));
+
+    instanceBuffer.create();
+    instanceBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    instanceBuffer.bind();
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+
+    vao.release();
+}
+
+void CubeGridView::uploadColors()
+{
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    if (uploadAll) {
+        // Only the first maxCubes fit in the texture; the rest keep their
+        // colours here but are not drawn
+        int count = std::min(cubeCount(), maxCubes);
+        textureRows = std::max(1, (count + CUBES_PER_ROW - 1) / CUBES_PER_ROW);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, CUBES_PER_ROW * TEXELS_PER_CUBE, textureRows, 0,
+                     GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+        // Full rows in one upload, then the partial last row on its own so
+        // nothing is read past the end of colors
+        int fullRows = count / CUBES_PER_ROW;
+        int rest = count % CUBES_PER_ROW;
+        if (fullRows > 0) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, CUBES_PER_ROW * TEXELS_PER_CUBE, fullRows, GL_RED_INTEGER,
+                            GL_UNSIGNED_BYTE, colors.data());
+        }
+        if (rest > 0) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, fullRows, rest * TEXELS_PER_CUBE, 1, GL_RED_INTEGER,
+                            GL_UNSIGNED_BYTE, colors.data() + size_t(fullRows) * CUBES_PER_ROW * TEXELS_PER_CUBE);
+        }
+        uploadAll = false;
+    } else {
+        for (int index : dirtyCubes) {
+            if (index < maxCubes) {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, (index % CUBES_PER_ROW) * TEXELS_PER_CUBE,
+                                index / CUBES_PER_ROW, TEXELS_PER_CUBE, 1, GL_RED_INTEGER,
+                                GL_UNSIGNED_BYTE, colors.data() + size_t(index) * TEXELS_PER_CUBE);
+            }
+        }
+    }
+    dirtyCubes.clear();
+}
+
+QMatrix4x4 CubeGridView::viewProjection() const
+{
+    QMatrix4x4 matrix;
+    matrix.perspective(FIELD_OF_VIEW, float(width()) / std::max(1, height()), 0.5f, distance + 10.0f);
+    matrix.translate(-centerX, -centerY, -distance);
+    return matrix;
+}
+
+void CubeGridView::fitView()
+{
+    int rows = (cubeCount() + columns - 1) / std::max(1, columns);
+    float gridWidth = columns * SPACING;
+    float gridHeight = rows * SPACING;
+    centerX = (columns - 1) * SPACING * 0.5f;
+    centerY = -(rows - 1) * SPACING * 0.5f;
+
+    float aspect = float(width()) / std::max(1, height());
+    float halfExtent = std::max(gridHeight, gridWidth / aspect) * 0.5f;
+    distance = std::max(10.0f, halfExtent / std::tan(qDegreesToRadians(FIELD_OF_VIEW * 0.5f)) + 3.0f);
+}
+
+void CubeGridView::paintGL()
+{
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (cubeCount() == 0) {
+        return;
+    }
+    if (uploadAll || !dirtyCubes.empty()) {
+        uploadColors();
+    }
+
+    // The grid lies in the z = 0 plane under a camera looking straight
+    // down, so the frustum covers a rectangle of grid cells: only those
+    // cubes are visited. The camera distance is also the same for every
+    // cube, so one projected size picks the level of detail for the frame.
+    QMatrix4x4 matrix = viewProjection();
+    float halfHeight = distance * std::tan(qDegreesToRadians(FIELD_OF_VIEW * 0.5f));
+    float halfWidth = halfHeight * float(width()) / std::max(1, height());
+    float pixelsPerUnit = height() / (2.0f * halfHeight);
+    bool detailed = 2.0f * CUBE_RADIUS * pixelsPerUnit >= LOD_PIXELS;
+
+    int count = std::min(cubeCount(), maxCubes);
+    int rows = (count + columns - 1) / columns;
+    int firstColumn = std::max(0, int(std::floor((centerX - halfWidth - CUBE_RADIUS) / SPACING)));
+    int lastColumn = std::min(columns - 1, int(std::ceil((centerX + halfWidth + CUBE_RADIUS) / SPACING)));
+    int firstRow = std::max(0, int(std::floor((-centerY - halfHeight - CUBE_RADIUS) / SPACING)));
+    int lastRow = std::min(rows - 1, int(std::ceil((-centerY + halfHeight + CUBE_RADIUS) / SPACING)));
+
+    visible.clear();
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            int index = row * columns + column;
+            if (index >= count) {
+                break;
+            }
+            visible.push_back(static_cast<GLuint>(index));
+        }
+    }
+    if (visible.empty()) {
+        return;
+    }
+
+    shaderProgram->bind();
+    shaderProgram->setUniformValue("viewProjection", matrix);
+    shaderProgram->setUniformValue("columns", columns);
+    vao.bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+
+    instanceBuffer.bind();
+    instanceBuffer.allocate(visible.data(), static_cast<int>(visible.size() * sizeof(GLuint)));
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+
+    if (detailed) {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, detailedVertexCount, static_cast<GLsizei>(visible.size()));
+    } else {
+        glDrawArraysInstanced(GL_TRIANGLES, detailedVertexCount, coarseVertexCount,
+                              static_cast<GLsizei>(visible.size()));
+    }
+
+    vao.release();
+    shaderProgram->release();
+}
+
+void CubeGridView::resizeGL(int w, int h)
+{
+    glViewport(0, 0, w, h);
+}
+
+void CubeGridView::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton) {
+        mousePressed = true;
+        lastMousePos = event->pos();
+    }
+}
+
+void CubeGridView::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton) {
+        mousePressed = false;
+    }
+}
+
+void CubeGridView::mouseMoveEvent(QMouseEvent* event)
+{
+    if (mousePressed) {
+        // Pan so the grid follows the cursor
+        QPoint delta = event->pos() - lastMousePos;
+        float unitsPerPixel = 2.0f * distance * std::tan(qDegreesToRadians(FIELD_OF_VIEW * 0.5f)) / std::max(1, height());
+        centerX -= delta.x() * unitsPerPixel;
+        centerY += delta.y() * unitsPerPixel;
+        lastMousePos = event->pos();
+        update();
+    }
+}
+
+void CubeGridView::wheelEvent(QWheelEvent* event)
+{
+    float delta = event->angleDelta().y() / 120.0f;
+    distance = qBound(6.0f, distance * std::pow(0.85f, delta), 5000.0f);
+    update();
+}
@@ -0,0 +1,84 @@
+#ifndef CUBEGRIDVIEW_H
+#define CUBEGRIDVIEW_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLShaderProgram>
+#include <QMatrix4x4>
+#include <vector>
+#include "cube.h"
+
+// Wall of many cubes, e.g. a batch of solver failures. All cubes share one
+// static mesh drawn with instancing; each cube's facelet colours live in a
+// row segment of an integer texture, so changing a cube uploads 64 bytes.
+// Cubes outside the view are culled on the CPU and cubes drawn smaller
+// than LOD_PIXELS use a 6-quad mesh showing each face's majority colour.
+//
+// Needs OpenGL 3.3 core, so use it as its own top-level window.
+class CubeGridView : public QOpenGLWidget, protected QOpenGLExtraFunctions
+{
+    Q_OBJECT
+
+public:
+    explicit CubeGridView(QWidget* parent = nullptr);
+    ~CubeGridView();
+
+    // columns = 0 lays the cubes out in a roughly square grid
+    void setCubes(const std::vector<Cube>& cubes, int columns = 0);
+    // Replace one cube; only its colours are streamed to the GPU
+    void setCube(int index, const Cube& cube);
+    int cubeCount() const { return static_cast<int>(colors.size() / TEXELS_PER_CUBE); }
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+    void resizeGL(int w, int h) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+
+private:
+    // Texels per cube: 54 facelets, then the majority colour of each face
+    static constexpr int TEXELS_PER_CUBE = 64;
+    static constexpr int CUBES_PER_ROW = 8;
+    static constexpr float SPACING = 4.5f;
+    static constexpr float LOD_PIXELS = 40.0f;
+
+    void initShaders();
+    void initMesh();
+    void writeColors(int index, const Cube& cube);
+    void uploadColors();
+    void fitView();
+    QMatrix4x4 viewProjection() const;
+
+    QOpenGLShaderProgram* shaderProgram;
+    QOpenGLBuffer meshBuffer;
+    QOpenGLBuffer instanceBuffer;
+    QOpenGLVertexArrayObject vao;
+    GLuint colorTexture;
+    int textureRows;
+    int maxCubes;
+
+    int detailedVertexCount;  // body and 54 stickers
+    int coarseVertexCount;    // 6 face quads, stored after the detailed mesh
+
+    // Texture contents on the CPU side, and what still has to be uploaded
+    std::vector<uint8_t> colors;
+    std::vector<int> dirtyCubes;
+    bool uploadAll;
+    int columns;
+
+    std::vector<GLuint> visible;  // cube indices drawn this frame
+
+    // Camera looking down at the grid
+    float centerX;
+    float centerY;
+    float distance;
+    QPoint lastMousePos;
+    bool mousePressed;
+};
+
+#endif // CUBEGRIDVIEW_H
@@ -1,6 +1,9 @@
 #include "cuberenderer.h"
 #include <QOpenGLShaderProgram>
+#include <QFontDatabase>
+#include <QKeyEvent>
 #include <QMouseEvent>
+#include <QPainter>
 #include <QtMath>
 
 // Vertex shader
@@ -41,6 +44,7 @@ CubeRenderer::CubeRenderer(Cube* cube, QWidget* parent)
     , mousePressed(false)
     , distance(7.0f)
     , rotation(QQuaternion::fromAxisAndAngle(1.0f, 1.0f, 0.0f, 45.0f))
+    , overlayVisible(false)
 {
     setFocusPolicy(Qt::StrongFocus);
     setMouseTracking(true);
@@ -49,6 +53,7 @@ CubeRenderer::CubeRenderer(Cube* cube, QWidget* parent)
 CubeRenderer::~CubeRenderer()
 {
     makeCurrent();
+    profiler.release();
     delete shaderProgram;
     doneCurrent();
 }
@@ -62,6 +67,7 @@ void CubeRenderer::initializeGL()
 
     initShaders();
     initCubeGeometry();
+    profiler.initialize();
 
     // Initialize view matrix with an angled view
     view.setToIdentity();
@@ -118,8 +124,26 @@ void CubeRenderer::initCubeGeometry()
     vao.release();
 }
 
+void CubeRenderer::setOverlayVisible(bool visible)
+{
+    overlayVisible = visible;
+    update();
+}
+
+bool CubeRenderer::setFrameLog(const QString& path)
+{
+    return profiler.setLog(path);
+}
+
 void CubeRenderer::paintGL()
 {
+    profiler.beginFrame();
+
+    // The overlay's QPainter leaves its own state behind
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     shaderProgram->bind();
@@ -197,6 +221,29 @@ void CubeRenderer::paintGL()
 
     vao.release();
     shaderProgram->release();
+    profiler.endFrame();
+
+    if (overlayVisible) {
+        drawOverlay();
+    }
+}
+
+// Drawn after the frame is measured, so it costs nothing in the numbers
+void CubeRenderer::drawOverlay()
+{
+    const QStringList lines = profiler.summary();
+    QPainter painter(this);
+    painter.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    const QFontMetrics metrics = painter.fontMetrics();
+    int textWidth = 0;
+    for (const QString& line : lines) {
+        textWidth = qMax(textWidth, metrics.horizontalAdvance(line));
+    }
+    painter.fillRect(QRect(8, 8, textWidth + 12, metrics.height() * lines.size() + 8), QColor(0, 0, 0, 170));
+    painter.setPen(Qt::white);
+    for (int i = 0; i < lines.size(); i++) {
+        painter.drawText(14, 12 + metrics.ascent() + i * metrics.height(), lines[i]);
+    }
 }
 
 void CubeRenderer::drawCubeFace(const QMatrix4x4& transform, const QVector3D& color)
@@ -204,6 +251,8 @@ void CubeRenderer::drawCubeFace(const QMatrix4x4& transform, const QVector3D& co
     shaderProgram->setUniformValue(matrixLocation, transform);
     shaderProgram->setUniformValue(colorLocation, color);
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    profiler.countUniformUploads(2);
+    profiler.countDrawCall();
 }
 
 void CubeRenderer::drawCubeFace(const QMatrix4x4& transform, Color color)
@@ -262,7 +311,7 @@ void CubeRenderer::mouseMoveEvent(QMouseEvent* event)
         rotation = rotY * rotX * rotation;
         
         lastMousePos = event->pos();
-        update();
+        requestUpdate();
     }
 }
 
@@ -271,5 +320,22 @@ void CubeRenderer::wheelEvent(QWheelEvent* event)
     // Adjust zoom range
     float delta = event->angleDelta().y() / 120.0f;
     distance = qBound(3.0f, distance - delta * 0.5f, 15.0f);  // Modified range
+    requestUpdate();
+}
+
+void CubeRenderer::keyPressEvent(QKeyEvent* event)
+{
+    if (event->key() == Qt::Key_F3) {
+        setOverlayVisible(!overlayVisible);
+    } else {
+        QOpenGLWidget::keyPressEvent(event);
+    }
+}
+
+// Qt folds the update() calls between two frames into one repaint; the
+// profiler counts how many each frame absorbed
+void CubeRenderer::requestUpdate()
+{
+    profiler.countUpdateRequest();
     update();
 } 
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <QOpenGLShaderProgram>
 #include <QMatrix4x4>
 #include "cube.h"
+#include "frameprofiler.h"
 
 class CubeRenderer : public QOpenGLWidget, protected QOpenGLFunctions
 {
@@ -17,6 +18,12 @@ public:
     explicit CubeRenderer(Cube* cube, QWidget* parent = nullptr);
     ~CubeRenderer();
 
+    // Frame-time and draw-call overlay in the top-left corner; F3 toggles it
+    void setOverlayVisible(bool visible);
+    // Log every frame's timings and counts to a CSV file (empty path stops);
+    // false if the file cannot be opened
+    bool setFrameLog(const QString& path);
+
 protected:
     void initializeGL() override;
     void paintGL() override;
@@ -25,12 +32,15 @@ protected:
     void mouseReleaseEvent(QMouseEvent* event) override;
     void mouseMoveEvent(QMouseEvent* event) override;
     void wheelEvent(QWheelEvent* event) override;
+    void keyPressEvent(QKeyEvent* event) override;
 
 private:
     void initShaders();
     void initCubeGeometry();
     void drawCubeFace(const QMatrix4x4& transform, Color color);
     void drawCubeFace(const QMatrix4x4& transform, const QVector3D& color);
+    void drawOverlay();
+    void requestUpdate();
 
     Cube* cube;
     QOpenGLShaderProgram* shaderProgram;
@@ -61,6 +71,9 @@ private:
     // Camera parameters
     float distance;
     QVector3D cameraPosition;
+
+    FrameProfiler profiler;
+    bool overlayVisible;
 };
 
 #endif // CUBERENDERER_H 
\ No newline at end of file
@@ -0,0 +1,422 @@
+#include "cubie.h"
+#include "metrics.h"
+#include "movetables.h"
+#include <algorithm>
+
+namespace {
+
+// The solved colour of a facelet: each face's centre colour shares its
+// enum value with the face
+constexpr Color faceColor(int facelet) {
+    return static_cast<Color>(facelet / 9);
+}
+
+constexpr uint8_t NO_PIECE = 0xFF;
+
+// Maps the colours read off a slot straight to (piece << 2 | orientation),
+// so identifying a cubie is one table probe instead of a search
+struct PieceLookup {
+    std::array<uint8_t, 6 * 6 * 6> corner;
+    std::array<uint8_t, 6 * 6> edge;
+};
+
+constexpr PieceLookup buildPieceLookup() {
+    PieceLookup lookup{};
+    for (auto& entry : lookup.corner) entry = NO_PIECE;
+    for (auto& entry : lookup.edge) entry = NO_PIECE;
+
+    for (int piece = 0; piece < NUM_CORNERS; piece++) {
+        for (int ori = 0; ori < 3; ori++) {
+            int c[3] = {};
+            for (int n = 0; n < 3; n++) {
+                c[(n + ori) % 3] = cornerFacelet[piece][n] / 9;
+            }
+            lookup.corner[c[0] * 36 + c[1] * 6 + c[2]] = static_cast<uint8_t>(piece << 2 | ori);
+        }
+    }
+    for (int piece = 0; piece < NUM_EDGES; piece++) {
+        for (int ori = 0; ori < 2; ori++) {
+            int c0 = edgeFacelet[piece][ori] / 9;
+            int c1 = edgeFacelet[piece][1 - ori] / 9;
+            lookup.edge[c0 * 6 + c1] = static_cast<uint8_t>(piece << 2 | ori);
+        }
+    }
+    return lookup;
+}
+
+constexpr PieceLookup pieceLookup = buildPieceLookup();
+
+template <std::size_t N>
+int permutationParity(const std::array<uint8_t, N>& perm) {
+    int inversions = 0;
+    for (std::size_t i = 0; i < N; i++) {
+        for (std::size_t j = i + 1; j < N; j++) {
+            inversions += perm[i] > perm[j];
+        }
+    }
+    return inversions & 1;
+}
+
+} // namespace
+
+StateValidation faceletsToCubie(const Cube::Facelets& facelets, CubieCube& out) {
+    const Color* flat = facelets[0].data();
+
+    // Colour counts, and centres in the fixed scheme (moves never turn them)
+    int counts[6] = {};
+    for (int i = 0; i < 54; i++) {
+        int color = static_cast<int>(flat[i]);
+        if (color < 0 || color >= 6) {
+            return {StateError::BAD_COLOR, i};
+        }
+        counts[color]++;
+    }
+    for (int face = 0; face < 6; face++) {
+        if (static_cast<int>(flat[face * 9 + 4]) != face) {
+            return {StateError::BAD_CENTERS, face * 9 + 4};
+        }
+    }
+    for (int color = 0; color < 6; color++) {
+        if (counts[color] != 9) {
+            return {StateError::BAD_COLOR_COUNT, color};
+        }
+    }
+
+    unsigned seenCorners = 0;
+    int twist = 0;
+    for (int i = 0; i < NUM_CORNERS; i++) {
+        int key = static_cast<int>(flat[cornerFacelet[i][0]]) * 36 +
+                  static_cast<int>(flat[cornerFacelet[i][1]]) * 6 +
+                  static_cast<int>(flat[cornerFacelet[i][2]]);
+        uint8_t piece = pieceLookup.corner[key];
+        if (piece == NO_PIECE) {
+            return {StateError::BAD_CORNER, i};
+        }
+        unsigned bit = 1u << (piece >> 2);
+        if (seenCorners & bit) {
+            return {StateError::DUPLICATE_CORNER, i};
+        }
+        seenCorners |= bit;
+        out.cp[i] = piece >> 2;
+        out.co[i] = piece & 3;
+        twist += piece & 3;
+    }
+
+    unsigned seenEdges = 0;
+    int flip = 0;
+    for (int i = 0; i < NUM_EDGES; i++) {
+        int key = static_cast<int>(flat[edgeFacelet[i][0]]) * 6 +
+                  static_cast<int>(flat[edgeFacelet[i][1]]);
+        uint8_t piece = pieceLookup.edge[key];
+        if (piece == NO_PIECE) {
+            return {StateError::BAD_EDGE, i};
+        }
+        unsigned bit = 1u << (piece >> 2);
+        if (seenEdges & bit) {
+            return {StateError::DUPLICATE_EDGE, i};
+        }
+        seenEdges |= bit;
+        out.ep[i] = piece >> 2;
+        out.eo[i] = piece & 1;
+        flip += piece & 1;
+    }
+
+    if (twist % 3 != 0) {
+        return {StateError::CORNER_TWIST, -1};
+    }
+    if (flip % 2 != 0) {
+        return {StateError::EDGE_FLIP, -1};
+    }
+    if (permutationParity(out.cp) != permutationParity(out.ep)) {
+        return {StateError::PERMUTATION_PARITY, -1};
+    }
+    return {};
+}
+
+void cubieToFacelets(const CubieCube& cc, Cube::Facelets& facelets) {
+    Color* flat = facelets[0].data();
+    for (int face = 0; face < 6; face++) {
+        flat[face * 9 + 4] = static_cast<Color>(face);
+    }
+    for (int i = 0; i < NUM_CORNERS; i++) {
+        for (int n = 0; n < 3; n++) {
+            flat[cornerFacelet[i][(n + cc.co[i]) % 3]] = faceColor(cornerFacelet[cc.cp[i]][n]);
+        }
+    }
+    for (int i = 0; i < NUM_EDGES; i++) {
+        for (int n = 0; n < 2; n++) {
+            flat[edgeFacelet[i][(n + cc.eo[i]) % 2]] = faceColor(edgeFacelet[cc.ep[i]][n]);
+        }
+    }
+}
+
+CubieCube CubieCube::inverse() const {
+    CubieCube result;
+    for (int i = 0; i < NUM_CORNERS; i++) {
+        result.cp[cp[i]] = static_cast<uint8_t>(i);
+        result.co[cp[i]] = static_cast<uint8_t>((3 - co[i]) % 3);
+    }
+    for (int i = 0; i < NUM_EDGES; i++) {
+        result.ep[ep[i]] = static_cast<uint8_t>(i);
+        result.eo[ep[i]] = eo[i];
+    }
+    return result;
+}
+
+void CubieCube::applyMove(int move) {
+    CUBE_METRIC_ADD(Counter::CUBIE_MOVES, 1);
+    multiply(moveCube(move));
+}
+
+const CubieCube& moveCube(int move) {
+    return MOVE_CUBES[move];
+}
+
+namespace {
+
+int binomial(int n, int k) {
+    if (k < 0 || k > n) {
+        return 0;
+    }
+    int result = 1;
+    for (int i = 0; i < k; i++) {
+        result = result * (n - i) / (i + 1);
+    }
+    return result;
+}
+
+template <typename T>
+void rotateLeft(T* values, int left, int right) {
+    T first = values[left];
+    for (int i = left; i < right; i++) {
+        values[i] = values[i + 1];
+    }
+    values[right] = first;
+}
+
+template <typename T>
+void rotateRight(T* values, int left, int right) {
+    T last = values[right];
+    for (int i = right; i > left; i--) {
+        values[i] = values[i - 1];
+    }
+    values[left] = last;
+}
+
+// Lehmer-style index of a permutation of 0..n-1
+int permutationIndex(uint8_t* perm, int n) {
+    int index = 0;
+    for (int j = n - 1; j > 0; j--) {
+        int k = 0;
+        while (perm[j] != j) {
+            rotateLeft(perm, 0, j);
+            k++;
+        }
+        index = (j + 1) * index + k;
+    }
+    return index;
+}
+
+// Slots of pieces first..first+3, encoded as a 4-permutation of N slots
+template <size_t N>
+int placementIndex(const std::array<uint8_t, N>& perm, int first) {
+    int slots[4] = {};
+    for (size_t j = 0; j < N; j++) {
+        if (perm[j] >= first && perm[j] < first + 4) {
+            slots[perm[j] - first] = static_cast<int>(j);
+        }
+    }
+    int index = 0;
+    for (int k = 0; k < 4; k++) {
+        int rank = slots[k];
+        for (int i = 0; i < k; i++) {
+            if (slots[i] < slots[k]) {
+                rank--;
+            }
+        }
+        index = index * static_cast<int>(N - k) + rank;
+    }
+    return index;
+}
+
+template <size_t N>
+void setPlacementIndex(std::array<uint8_t, N>& perm, int first, int index) {
+    int ranks[4];
+    for (int k = 3; k >= 0; k--) {
+        ranks[k] = index % static_cast<int>(N - k);
+        index /= static_cast<int>(N - k);
+    }
+    perm.fill(0xFF);
+    for (int k = 0; k < 4; k++) {
+        size_t slot = 0;
+        for (int free = ranks[k];; slot++) {
+            if (perm[slot] == 0xFF && free-- == 0) {
+                break;
+            }
+        }
+        perm[slot] = static_cast<uint8_t>(first + k);
+    }
+    int other = 0;
+    for (size_t j = 0; j < N; j++) {
+        if (perm[j] == 0xFF) {
+            if (other == first) {
+                other += 4;
+            }
+            perm[j] = static_cast<uint8_t>(other++);
+        }
+    }
+}
+
+void setPermutationIndex(uint8_t* perm, int n, int index) {
+    for (int i = 0; i < n; i++) {
+        perm[i] = static_cast<uint8_t>(i);
+    }
+    for (int j = 0; j < n; j++) {
+        int k = index % (j + 1);
+        index /= j + 1;
+        while (k-- > 0) {
+            rotateRight(perm, 0, j);
+        }
+    }
+}
+
+} // namespace
+
+int CubieCube::twist() const {
+    int result = 0;
+    for (int i = 0; i < NUM_CORNERS - 1; i++) {
+        result = 3 * result + co[i];
+    }
+    return result;
+}
+
+void CubieCube::setTwist(int twist) {
+    int sum = 0;
+    for (int i = NUM_CORNERS - 2; i >= 0; i--) {
+        co[i] = static_cast<uint8_t>(twist % 3);
+        sum += co[i];
+        twist /= 3;
+    }
+    co[NUM_CORNERS - 1] = static_cast<uint8_t>((3 - sum % 3) % 3);
+}
+
+int CubieCube::flip() const {
+    int result = 0;
+    for (int i = 0; i < NUM_EDGES - 1; i++) {
+        result = 2 * result + eo[i];
+    }
+    return result;
+}
+
+void CubieCube::setFlip(int flip) {
+    int sum = 0;
+    for (int i = NUM_EDGES - 2; i >= 0; i--) {
+        eo[i] = static_cast<uint8_t>(flip & 1);
+        sum += eo[i];
+        flip >>= 1;
+    }
+    eo[NUM_EDGES - 1] = static_cast<uint8_t>(sum & 1);
+}
+
+int CubieCube::sliceSorted() const {
+    const int firstSlice = static_cast<int>(Edge::FR);
+    int a = 0;
+    int x = 0;
+    uint8_t slice[4] = {};
+    for (int j = NUM_EDGES - 1; j >= 0; j--) {
+        if (ep[j] >= firstSlice) {
+            a += binomial(NUM_EDGES - 1 - j, x + 1);
+            slice[3 - x] = static_cast<uint8_t>(ep[j] - firstSlice);
+            x++;
+        }
+    }
+    return 24 * a + permutationIndex(slice, 4);
+}
+
+void CubieCube::setSliceSorted(int index) {
+    uint8_t slice[4];
+    setPermutationIndex(slice, 4, index % 24);
+    int a = index / 24;
+    const int firstSlice = static_cast<int>(Edge::FR);
+    for (int i = 0; i < NUM_EDGES; i++) {
+        ep[i] = 0xFF;
+    }
+    int x = 4;
+    for (int j = 0; j < NUM_EDGES && x > 0; j++) {
+        if (a - binomial(NUM_EDGES - 1 - j, x) >= 0) {
+            ep[j] = static_cast<uint8_t>(firstSlice + slice[4 - x]);
+            a -= binomial(NUM_EDGES - 1 - j, x);
+            x--;
+        }
+    }
+    int other = 0;
+    for (int j = 0; j < NUM_EDGES; j++) {
+        if (ep[j] == 0xFF) {
+            ep[j] = static_cast<uint8_t>(other++);
+        }
+    }
+}
+
+int CubieCube::cornerPerm() const {
+    std::array<uint8_t, NUM_CORNERS> perm = cp;
+    return permutationIndex(perm.data(), NUM_CORNERS);
+}
+
+void CubieCube::setCornerPerm(int index) {
+    setPermutationIndex(cp.data(), NUM_CORNERS, index);
+}
+
+// Only meaningful when the slice edges are in the slice (phase 2)
+int CubieCube::udEdgePerm() const {
+    uint8_t perm[8];
+    for (int i = 0; i < 8; i++) {
+        perm[i] = ep[i];
+    }
+    return permutationIndex(perm, 8);
+}
+
+void CubieCube::setUdEdgePerm(int index) {
+    setPermutationIndex(ep.data(), 8, index);
+    for (int i = 8; i < NUM_EDGES; i++) {
+        ep[i] = static_cast<uint8_t>(i);
+    }
+}
+
+int CubieCube::cornerPlacement(int first) const {
+    return placementIndex(cp, first);
+}
+
+void CubieCube::setCornerPlacement(int first, int index) {
+    setPlacementIndex(cp, first, index);
+}
+
+int CubieCube::edgePlacement(int first) const {
+    return placementIndex(ep, first);
+}
+
+void CubieCube::setEdgePlacement(int first, int index) {
+    setPlacementIndex(ep, first, index);
+}
+
+int CubieCube::edgePerm() const {
+    std::array<uint8_t, NUM_EDGES> perm = ep;
+    return permutationIndex(perm.data(), NUM_EDGES);
+}
+
+void CubieCube::setEdgePerm(int index) {
+    setPermutationIndex(ep.data(), NUM_EDGES, index);
+}
+
+CubieCube CubieCube::random(std::mt19937_64& gen) {
+    CubieCube cube;
+    std::shuffle(cube.cp.begin(), cube.cp.end(), gen);
+    std::shuffle(cube.ep.begin(), cube.ep.end(), gen);
+    // Swapping two edges maps odd edge permutations one-to-one onto even
+    // ones, so fixing parity this way keeps the distribution uniform
+    if (permutationParity(cube.cp) != permutationParity(cube.ep)) {
+        std::swap(cube.ep[NUM_EDGES - 2], cube.ep[NUM_EDGES - 1]);
+    }
+    cube.setTwist(std::uniform_int_distribution<int>(0, NUM_TWIST - 1)(gen));
+    cube.setFlip(std::uniform_int_distribution<int>(0, NUM_FLIP - 1)(gen));
+    return cube;
+}
@@ -0,0 +1,150 @@
+#ifndef RUBIKSCUBE_CUBIE_H
+#define RUBIKSCUBE_CUBIE_H
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include "cube.h"
+
+// Corner and edge slots, in the usual two-phase solver order
+enum class Corner { URF, UFL, ULB, UBR, DFR, DLF, DBL, DRB };
+enum class Edge { UR, UF, UL, UB, DR, DF, DL, DB, FR, FL, BL, BR };
+
+constexpr int NUM_CORNERS = 8;
+constexpr int NUM_EDGES = 12;
+
+// Piece-level view of the cube: which cubie sits in each slot and how it
+// is twisted (corners, 0-2) or flipped (edges, 0-1)
+struct CubieCube {
+    std::array<uint8_t, NUM_CORNERS> cp;
+    std::array<uint8_t, NUM_CORNERS> co;
+    std::array<uint8_t, NUM_EDGES> ep;
+    std::array<uint8_t, NUM_EDGES> eo;
+
+    constexpr CubieCube() : cp(), co(), ep(), eo() {
+        for (int i = 0; i < NUM_CORNERS; i++) {
+            cp[i] = static_cast<uint8_t>(i);
+        }
+        for (int i = 0; i < NUM_EDGES; i++) {
+            ep[i] = static_cast<uint8_t>(i);
+        }
+    }
+
+    bool operator==(const CubieCube& other) const {
+        return cp == other.cp && co == other.co && ep == other.ep && eo == other.eo;
+    }
+    bool operator!=(const CubieCube& other) const { return !(*this == other); }
+
+    // this = this * other, i.e. apply other's permutation after this one
+    constexpr void multiply(const CubieCube& other) {
+        CubieCube result;
+        for (int i = 0; i < NUM_CORNERS; i++) {
+            result.cp[i] = cp[other.cp[i]];
+            result.co[i] = static_cast<uint8_t>((co[other.cp[i]] + other.co[i]) % 3);
+        }
+        for (int i = 0; i < NUM_EDGES; i++) {
+            result.ep[i] = ep[other.ep[i]];
+            result.eo[i] = static_cast<uint8_t>((eo[other.ep[i]] + other.eo[i]) & 1);
+        }
+        *this = result;
+    }
+    void applyMove(int move);
+    // The state that undoes this one: c * c.inverse() is solved
+    CubieCube inverse() const;
+
+    // Solver coordinates. Phase 1: twist (0-2186), flip (0-2047) and the
+    // UD-slice edges (sliceSorted / 24 picks their positions, 0 = solved).
+    // Phase 2: corner permutation and U/D-layer edge permutation (0-40319)
+    // and sliceSorted % 24 for the order of the slice edges.
+    int twist() const;
+    void setTwist(int twist);
+    int flip() const;
+    void setFlip(int flip);
+    int sliceSorted() const;
+    void setSliceSorted(int index);
+    int cornerPerm() const;
+    void setCornerPerm(int index);
+    int udEdgePerm() const;
+    void setUdEdgePerm(int index);
+
+    // Where the four pieces first..first+3 are, in piece order: corner
+    // placement 0-1679, edge placement 0-11879. Placing sets only those
+    // pieces' slots; the other pieces fill the rest in order.
+    int cornerPlacement(int first) const;
+    void setCornerPlacement(int first, int index);
+    int edgePlacement(int first) const;
+    void setEdgePlacement(int first, int index);
+
+    // Permutation of all 12 edges (0-479001599), for compact storage
+    int edgePerm() const;
+    void setEdgePerm(int index);
+
+    // Uniformly random reachable state
+    static CubieCube random(std::mt19937_64& gen);
+};
+
+// Scrambles a seed, so that seed ^ splitMix64(i) seeds independent
+// generators for chunks i
+inline uint64_t splitMix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+constexpr int NUM_TWIST = 2187;
+constexpr int NUM_FLIP = 2048;
+constexpr int NUM_SLICE = 495;
+constexpr int NUM_SLICE_SORTED = 11880;
+constexpr int NUM_CORNER_PERM = 40320;
+constexpr int NUM_UD_EDGE_PERM = 40320;
+constexpr int NUM_EDGE_PERM = 479001600;
+constexpr int NUM_CORNER_PLACEMENT = 8 * 7 * 6 * 5;
+constexpr int NUM_EDGE_PLACEMENT = 12 * 11 * 10 * 9;
+constexpr int NUM_SLICE_PERM = 24;
+
+// Cubie effect of each of the 18 moves, numbered as in Cube::applyMove();
+// MOVE_CUBES in movetables.h
+const CubieCube& moveCube(int move);
+
+constexpr int faceletIndex(Face face, int index) {
+    return static_cast<int>(face) * 9 + index;
+}
+
+// Facelet indices of each corner and edge slot, listed clockwise starting
+// from the U or D sticker (F or B for the middle-layer edges)
+constexpr int cornerFacelet[NUM_CORNERS][3] = {
+    {faceletIndex(Face::UP, 8), faceletIndex(Face::RIGHT, 0), faceletIndex(Face::FRONT, 2)},  // URF
+    {faceletIndex(Face::UP, 6), faceletIndex(Face::FRONT, 0), faceletIndex(Face::LEFT, 2)},   // UFL
+    {faceletIndex(Face::UP, 0), faceletIndex(Face::LEFT, 0), faceletIndex(Face::BACK, 2)},    // ULB
+    {faceletIndex(Face::UP, 2), faceletIndex(Face::BACK, 0), faceletIndex(Face::RIGHT, 2)},   // UBR
+    {faceletIndex(Face::DOWN, 2), faceletIndex(Face::FRONT, 8), faceletIndex(Face::RIGHT, 6)}, // DFR
+    {faceletIndex(Face::DOWN, 0), faceletIndex(Face::LEFT, 8), faceletIndex(Face::FRONT, 6)},  // DLF
+    {faceletIndex(Face::DOWN, 6), faceletIndex(Face::BACK, 8), faceletIndex(Face::LEFT, 6)},   // DBL
+    {faceletIndex(Face::DOWN, 8), faceletIndex(Face::RIGHT, 8), faceletIndex(Face::BACK, 6)}   // DRB
+};
+
+constexpr int edgeFacelet[NUM_EDGES][2] = {
+    {faceletIndex(Face::UP, 5), faceletIndex(Face::RIGHT, 1)},   // UR
+    {faceletIndex(Face::UP, 7), faceletIndex(Face::FRONT, 1)},   // UF
+    {faceletIndex(Face::UP, 3), faceletIndex(Face::LEFT, 1)},    // UL
+    {faceletIndex(Face::UP, 1), faceletIndex(Face::BACK, 1)},    // UB
+    {faceletIndex(Face::DOWN, 5), faceletIndex(Face::RIGHT, 7)}, // DR
+    {faceletIndex(Face::DOWN, 1), faceletIndex(Face::FRONT, 7)}, // DF
+    {faceletIndex(Face::DOWN, 3), faceletIndex(Face::LEFT, 7)},  // DL
+    {faceletIndex(Face::DOWN, 7), faceletIndex(Face::BACK, 7)},  // DB
+    {faceletIndex(Face::FRONT, 5), faceletIndex(Face::RIGHT, 3)}, // FR
+    {faceletIndex(Face::FRONT, 3), faceletIndex(Face::LEFT, 5)},  // FL
+    {faceletIndex(Face::BACK, 5), faceletIndex(Face::LEFT, 3)},   // BL
+    {faceletIndex(Face::BACK, 3), faceletIndex(Face::RIGHT, 5)}   // BR
+};
+
+// Recover the cubies from a facelet state. Checks colour counts, that every
+// corner and edge exists exactly once, and the twist, flip and permutation
+// parity invariants. out is only meaningful when the result is ok().
+StateValidation faceletsToCubie(const Cube::Facelets& facelets, CubieCube& out);
+
+// Paint a cubie state back onto facelets
+void cubieToFacelets(const CubieCube& cc, Cube::Facelets& facelets);
+
+#endif
@@ -0,0 +1,339 @@
+#include "dataset.h"
+#include <unistd.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void put16(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void put32(uint8_t* out, uint32_t value) {
+    put16(out, value);
+    put16(out + 2, value >> 16);
+}
+
+void put64(uint8_t* out, uint64_t value) {
+    put32(out, static_cast<uint32_t>(value));
+    put32(out + 4, static_cast<uint32_t>(value >> 32));
+}
+
+uint32_t get16(const uint8_t* in) {
+    return in[0] | in[1] << 8;
+}
+
+uint32_t get32(const uint8_t* in) {
+    return get16(in) | get16(in + 2) << 16;
+}
+
+uint64_t get64(const uint8_t* in) {
+    return get32(in) | static_cast<uint64_t>(get32(in + 4)) << 32;
+}
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+
+using File = std::unique_ptr<std::FILE, FileCloser>;
+
+// Records of one chunk, laid out column by column
+void generateChunk(const DatasetOptions& options, uint64_t chunk, uint64_t count,
+                   Solver& solver, std::vector<uint8_t>& bytes) {
+    std::mt19937_64 gen(splitMix64(options.seed ^ splitMix64(chunk)));
+    Solution solution;
+    bytes.assign(count * DATASET_RECORD_SIZE, 0);
+    uint8_t* lengths = bytes.data();
+    uint8_t* states = lengths + count;
+    uint8_t* moves = states + count * DATASET_STATE_BYTES;
+    for (uint64_t i = 0; i < count; i++) {
+        CubieCube state = CubieCube::random(gen);
+        solver.solve(state, options.solve, solution);
+        lengths[i] = solution.found() ? static_cast<uint8_t>(solution.length) : DATASET_UNSOLVED;
+        packState(state, states + i * DATASET_STATE_BYTES);
+        packMoves(solution, moves + i * DATASET_MOVE_BYTES);
+    }
+}
+
+DatasetChunk summarizeChunk(uint64_t offset, const uint8_t* lengths, uint32_t count) {
+    DatasetChunk chunk;
+    chunk.offset = offset;
+    chunk.count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        if (lengths[i] == DATASET_UNSOLVED) {
+            chunk.hasUnsolved = true;
+        } else {
+            chunk.shortest = std::min(chunk.shortest, lengths[i]);
+            chunk.longest = std::max(chunk.longest, lengths[i]);
+        }
+    }
+    return chunk;
+}
+
+} // namespace
+
+void encodeHeader(const DatasetHeader& header, uint8_t* out) {
+    std::memset(out, 0, DATASET_HEADER_SIZE);
+    std::memcpy(out, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+    put32(out + 8, header.version);
+    put32(out + 12, header.recordSize);
+    put32(out + 16, header.chunkRecords);
+    put32(out + 20, header.maxLength);
+    put64(out + 24, header.maxNodes);
+    put64(out + 32, header.seed);
+    put64(out + 40, header.totalRecords);
+}
+
+DatasetHeader decodeHeader(const uint8_t* in) {
+    if (std::memcmp(in, DATASET_MAGIC, sizeof(DATASET_MAGIC)) != 0) {
+        throw CubeException("Not a cube dataset file");
+    }
+    DatasetHeader header;
+    header.version = get32(in + 8);
+    header.recordSize = get32(in + 12);
+    header.chunkRecords = get32(in + 16);
+    header.maxLength = get32(in + 20);
+    header.maxNodes = get64(in + 24);
+    header.seed = get64(in + 32);
+    header.totalRecords = get64(in + 40);
+    if (header.version != 2 || header.recordSize != DATASET_RECORD_SIZE || header.chunkRecords == 0) {
+        throw CubeException("Unsupported cube dataset version");
+    }
+    return header;
+}
+
+void packState(const CubieCube& state, uint8_t* out) {
+    put16(out, static_cast<uint32_t>(state.cornerPerm()));
+    put16(out + 2, static_cast<uint32_t>(state.twist()));
+    put32(out + 4, static_cast<uint32_t>(state.edgePerm()));
+    put16(out + 8, static_cast<uint32_t>(state.flip()));
+}
+
+CubieCube unpackState(const uint8_t* in) {
+    CubieCube state;
+    state.setCornerPerm(static_cast<int>(get16(in)));
+    state.setTwist(static_cast<int>(get16(in + 2)));
+    state.setEdgePerm(static_cast<int>(get32(in + 4)));
+    state.setFlip(static_cast<int>(get16(in + 8)));
+    return state;
+}
+
+void packMoves(const Solution& solution, uint8_t* out) {
+    std::memset(out, 0, DATASET_MOVE_BYTES);
+    for (int i = 0; i < solution.length; i++) {
+        int bit = i * 5;
+        uint32_t value = static_cast<uint32_t>(solution.moves[i]) << (bit & 7);
+        out[bit >> 3] |= static_cast<uint8_t>(value);
+        if ((bit & 7) > 3) {
+            out[(bit >> 3) + 1] |= static_cast<uint8_t>(value >> 8);
+        }
+    }
+}
+
+void unpackMoves(const uint8_t* in, int length, uint8_t* moves) {
+    for (int i = 0; i < length; i++) {
+        int bit = i * 5;
+        uint32_t value = in[bit >> 3];
+        if ((bit & 7) > 3) {
+            value |= static_cast<uint32_t>(in[(bit >> 3) + 1]) << 8;
+        }
+        moves[i] = static_cast<uint8_t>((value >> (bit & 7)) & 31);
+    }
+}
+
+void encodeIndexEntry(const DatasetChunk& chunk, uint8_t* out) {
+    std::memset(out, 0, DATASET_INDEX_ENTRY_SIZE);
+    put64(out, chunk.offset);
+    put32(out + 8, chunk.count);
+    out[12] = chunk.shortest;
+    out[13] = chunk.longest;
+    out[14] = chunk.hasUnsolved ? 1 : 0;
+}
+
+DatasetChunk decodeIndexEntry(const uint8_t* in) {
+    DatasetChunk chunk;
+    chunk.offset = get64(in);
+    chunk.count = get32(in + 8);
+    chunk.shortest = in[12];
+    chunk.longest = in[13];
+    chunk.hasUnsolved = (in[14] & 1) != 0;
+    return chunk;
+}
+
+bool decodeTrailer(const uint8_t* in, uint64_t& chunkCount, uint64_t& footerOffset) {
+    if (std::memcmp(in, DATASET_INDEX_MAGIC, sizeof(DATASET_INDEX_MAGIC)) != 0) {
+        return false;
+    }
+    chunkCount = get64(in + 8);
+    footerOffset = get64(in + 16);
+    return true;
+}
+
+uint64_t generateDataset(const DatasetOptions& options,
+                         const std::function<void(uint64_t, uint64_t)>& progress) {
+    if (options.chunkRecords == 0) {
+        throw CubeException("Chunk size must be positive");
+    }
+    if (options.solve.maxLength > DATASET_MAX_MOVES) {
+        throw CubeException("Solutions longer than " + std::to_string(DATASET_MAX_MOVES) + " moves do not fit a record");
+    }
+
+    DatasetHeader header;
+    header.chunkRecords = options.chunkRecords;
+    header.maxLength = static_cast<uint32_t>(options.solve.maxLength);
+    header.maxNodes = options.solve.maxNodes;
+    header.seed = options.seed;
+    header.totalRecords = options.records;
+    const uint64_t chunkBytes = static_cast<uint64_t>(options.chunkRecords) * DATASET_RECORD_SIZE;
+
+    // Resume after the last complete chunk of a matching earlier run
+    uint64_t firstChunk = 0;
+    std::vector<DatasetChunk> index;
+    File file(std::fopen(options.path.c_str(), "r+b"));
+    uint8_t headerBytes[DATASET_HEADER_SIZE];
+    if (file && std::fread(headerBytes, 1, sizeof(headerBytes), file.get()) == sizeof(headerBytes)) {
+        DatasetHeader existing = decodeHeader(headerBytes);
+        if (existing.chunkRecords != header.chunkRecords || existing.seed != header.seed ||
+            existing.maxLength != header.maxLength || existing.maxNodes != header.maxNodes) {
+            throw CubeException("Existing " + options.path + " was generated with different parameters");
+        }
+        std::fseek(file.get(), 0, SEEK_END);
+        uint64_t dataEnd = static_cast<uint64_t>(std::ftell(file.get()));
+        bool finished = false;
+        uint8_t trailer[DATASET_TRAILER_SIZE];
+        uint64_t chunkCount;
+        uint64_t footerOffset;
+        if (dataEnd >= DATASET_HEADER_SIZE + DATASET_TRAILER_SIZE &&
+            std::fseek(file.get(), static_cast<long>(dataEnd - DATASET_TRAILER_SIZE), SEEK_SET) == 0 &&
+            std::fread(trailer, 1, sizeof(trailer), file.get()) == sizeof(trailer) &&
+            decodeTrailer(trailer, chunkCount, footerOffset)) {
+            dataEnd = footerOffset;
+            finished = true;
+        }
+        if (finished && existing.totalRecords == options.records) {
+            return 0;
+        }
+        // Only full chunks are kept; a short final chunk is regenerated
+        uint64_t fullChunks = (dataEnd - DATASET_HEADER_SIZE) / chunkBytes;
+        firstChunk = std::min(fullChunks, options.records / options.chunkRecords);
+
+        std::vector<uint8_t> lengths(options.chunkRecords);
+        for (uint64_t chunk = 0; chunk < firstChunk; chunk++) {
+            uint64_t offset = DATASET_HEADER_SIZE + chunk * chunkBytes;
+            std::fseek(file.get(), static_cast<long>(offset), SEEK_SET);
+            if (std::fread(lengths.data(), 1, lengths.size(), file.get()) != lengths.size()) {
+                throw CubeException("Cannot read " + options.path);
+            }
+            index.push_back(summarizeChunk(offset, lengths.data(), options.chunkRecords));
+        }
+    } else {
+        file.reset(std::fopen(options.path.c_str(), "w+b"));
+    }
+    if (!file) {
+        throw CubeException("Cannot open " + options.path);
+    }
+    std::fflush(file.get());
+    if (::ftruncate(fileno(file.get()), static_cast<off_t>(DATASET_HEADER_SIZE + firstChunk * chunkBytes)) != 0) {
+        throw CubeException("Cannot truncate " + options.path);
+    }
+    encodeHeader(header, headerBytes);
+    std::fseek(file.get(), 0, SEEK_SET);
+    std::fwrite(headerBytes, 1, sizeof(headerBytes), file.get());
+    std::fseek(file.get(), 0, SEEK_END);
+
+    const uint64_t numChunks = (options.records + options.chunkRecords - 1) / options.chunkRecords;
+    const int threadCount = options.threads > 0 ? options.threads
+                                                : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    // Chunks finish out of order; at most this many wait to be written
+    const uint64_t window = static_cast<uint64_t>(threadCount) * 2;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<uint64_t, std::vector<uint8_t>> ready;
+    uint64_t nextChunk = firstChunk;
+    uint64_t writtenChunks = firstChunk;
+    bool failed = false;
+
+    auto worker = [&] {
+        Solver solver;
+        std::vector<uint8_t> bytes;
+        while (true) {
+            uint64_t chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return failed || nextChunk < writtenChunks + window; });
+                if (failed || nextChunk >= numChunks) {
+                    return;
+                }
+                chunk = nextChunk++;
+            }
+            uint64_t count = std::min<uint64_t>(options.chunkRecords, options.records - chunk * options.chunkRecords);
+            generateChunk(options, chunk, count, solver, bytes);
+            std::lock_guard<std::mutex> lock(mutex);
+            ready[chunk] = std::move(bytes);
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back(worker);
+    }
+
+    std::vector<uint8_t> bytes;
+    for (uint64_t chunk = firstChunk; chunk < numChunks && !failed; chunk++) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return ready.count(chunk) != 0; });
+            bytes = std::move(ready[chunk]);
+            ready.erase(chunk);
+        }
+        uint32_t count = static_cast<uint32_t>(bytes.size() / DATASET_RECORD_SIZE);
+        index.push_back(summarizeChunk(DATASET_HEADER_SIZE + chunk * chunkBytes, bytes.data(), count));
+        // One large write per chunk, flushed so a crash loses at most the
+        // chunks still in flight
+        bool ok = std::fwrite(bytes.data(), 1, bytes.size(), file.get()) == bytes.size() &&
+                  std::fflush(file.get()) == 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ok) {
+                writtenChunks++;
+            } else {
+                failed = true;
+            }
+            changed.notify_all();
+        }
+        if (ok && progress) {
+            progress(std::min((chunk + 1) * options.chunkRecords, options.records), options.records);
+        }
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    if (failed) {
+        throw CubeException("Write to " + options.path + " failed");
+    }
+
+    // Footer index, which also marks the file as complete
+    uint64_t footerOffset = DATASET_HEADER_SIZE + options.records * DATASET_RECORD_SIZE;
+    std::vector<uint8_t> footer(index.size() * DATASET_INDEX_ENTRY_SIZE + DATASET_TRAILER_SIZE, 0);
+    for (size_t i = 0; i < index.size(); i++) {
+        encodeIndexEntry(index[i], footer.data() + i * DATASET_INDEX_ENTRY_SIZE);
+    }
+    uint8_t* trailer = footer.data() + index.size() * DATASET_INDEX_ENTRY_SIZE;
+    std::memcpy(trailer, DATASET_INDEX_MAGIC, sizeof(DATASET_INDEX_MAGIC));
+    put64(trailer + 8, index.size());
+    put64(trailer + 16, footerOffset);
+    if (std::fwrite(footer.data(), 1, footer.size(), file.get()) != footer.size() || std::fflush(file.get()) != 0) {
+        throw CubeException("Write to " + options.path + " failed");
+    }
+    return options.records - std::min(options.records, firstChunk * options.chunkRecords);
+}
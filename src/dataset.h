@@ -0,0 +1,103 @@
+#ifndef RUBIKSCUBE_DATASET_H
+#define RUBIKSCUBE_DATASET_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "solver.h"
+
+// Binary corpus of (state, solution length, solution) records.
+//
+// File layout, all integers little-endian:
+//   64-byte header (DATASET_MAGIC, parameters of the run)
+//   chunks of chunkRecords records, each generated independently from
+//   (seed, chunk index) so any chunk can be regenerated on resume
+//   footer: one DATASET_INDEX_ENTRY_SIZE entry per chunk, then a
+//   DATASET_TRAILER_SIZE trailer; only present once the run is complete
+//
+// Within a chunk of n records the fields are stored column by column, so
+// a scan reads only the columns it needs:
+//   n bytes      solution length, DATASET_UNSOLVED if the solver gave up
+//   n * 10 bytes packed state: uint16 corner permutation, uint16 twist,
+//                uint32 edge permutation, uint16 flip
+//   n * 20 bytes moves, 5 bits each, least significant bits first
+//
+// Index entry: uint64 chunk offset, uint32 record count, uint8 shortest
+// and uint8 longest solution, uint8 flags (1 = has unsolved records).
+// Trailer: DATASET_INDEX_MAGIC, uint64 chunk count, uint64 footer offset.
+
+constexpr char DATASET_MAGIC[8] = {'C', 'U', 'B', 'E', 'D', 'S', '0', '2'};
+constexpr char DATASET_INDEX_MAGIC[8] = {'C', 'U', 'B', 'E', 'I', 'D', 'X', '1'};
+constexpr int DATASET_HEADER_SIZE = 64;
+constexpr int DATASET_STATE_BYTES = 10;
+constexpr int DATASET_MOVE_BYTES = 20;
+constexpr int DATASET_RECORD_SIZE = 1 + DATASET_STATE_BYTES + DATASET_MOVE_BYTES;
+constexpr int DATASET_INDEX_ENTRY_SIZE = 16;
+constexpr int DATASET_TRAILER_SIZE = 32;
+constexpr uint8_t DATASET_UNSOLVED = 0xFF;
+constexpr int DATASET_MAX_MOVES = DATASET_MOVE_BYTES * 8 / 5;
+
+struct DatasetHeader {
+    uint32_t version = 2;
+    uint32_t recordSize = DATASET_RECORD_SIZE;
+    uint32_t chunkRecords = 4096;
+    uint32_t maxLength = 0;
+    uint64_t maxNodes = 0;
+    uint64_t seed = 0;
+    uint64_t totalRecords = 0;
+};
+
+struct DatasetChunk {
+    uint64_t offset = 0;
+    uint32_t count = 0;
+    uint8_t shortest = DATASET_UNSOLVED;  // DATASET_UNSOLVED if none solved
+    uint8_t longest = 0;
+    bool hasUnsolved = false;
+
+    // Whether any record in the chunk can have this length (-1 = unsolved)
+    bool mayContain(int length) const {
+        return length < 0 ? hasUnsolved : length >= shortest && length <= longest;
+    }
+};
+
+struct DatasetRecord {
+    CubieCube state;
+    int length = -1;  // -1 if unsolved
+    std::array<uint8_t, MAX_SOLUTION_LENGTH> moves{};
+};
+
+void encodeHeader(const DatasetHeader& header, uint8_t* out);
+// Throws CubeException if the bytes are not a dataset header
+DatasetHeader decodeHeader(const uint8_t* in);
+
+void packState(const CubieCube& state, uint8_t* out);
+CubieCube unpackState(const uint8_t* in);
+void packMoves(const Solution& solution, uint8_t* out);
+void unpackMoves(const uint8_t* in, int length, uint8_t* moves);
+
+void encodeIndexEntry(const DatasetChunk& chunk, uint8_t* out);
+DatasetChunk decodeIndexEntry(const uint8_t* in);
+// Chunk count and footer offset, or false if in is not a trailer
+bool decodeTrailer(const uint8_t* in, uint64_t& chunkCount, uint64_t& footerOffset);
+
+struct DatasetOptions {
+    std::string path;
+    uint64_t records = 0;
+    uint32_t chunkRecords = 4096;
+    uint64_t seed = 1;
+    int threads = 0;  // 0 = one per hardware thread
+    SolveOptions solve;
+};
+
+// Generate uniformly random states, solve each within options.solve and
+// stream the records to options.path. An existing file from a run with the
+// same seed, chunk size and solve limits is resumed after its last complete
+// chunk. progress, if set, is called from the writing thread after each
+// chunk with (records written, records wanted). Returns the records
+// generated by this call; throws CubeException on I/O or parameter errors.
+uint64_t generateDataset(const DatasetOptions& options,
+                         const std::function<void(uint64_t, uint64_t)>& progress = nullptr);
+
+#endif
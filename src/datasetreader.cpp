@@ -0,0 +1,204 @@
+#include "datasetreader.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+void DatasetReader::ChunkView::record(uint32_t i, DatasetRecord& out) const {
+    const std::string corrupt = "Corrupt dataset record " + std::to_string(firstRecord + i) + ": ";
+    out.state = state(i);
+    out.length = length(i);
+    if (out.length > MAX_SOLUTION_LENGTH) {
+        throw CubeException(corrupt + "solution length " + std::to_string(out.length));
+    }
+    // Out-of-range coordinates decode to some other state, so they show up
+    // as bytes that do not pack back the same; the rest is a parity check
+    uint8_t repacked[DATASET_STATE_BYTES];
+    packState(out.state, repacked);
+    if (std::memcmp(repacked, states + i * DATASET_STATE_BYTES, DATASET_STATE_BYTES) != 0) {
+        throw CubeException(corrupt + "state coordinates out of range");
+    }
+    Cube::Facelets facelets;
+    cubieToFacelets(out.state, facelets);
+    StateValidation validation = Cube::validate(facelets);
+    if (!validation.ok()) {
+        throw CubeException(corrupt + validation.message());
+    }
+    unpackMoves(moves + i * DATASET_MOVE_BYTES, std::max(out.length, 0), out.moves.data());
+}
+
+DatasetReader::DatasetReader(const std::string& path)
+    : data(nullptr)
+    , mappedSize(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw CubeException("Cannot open " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size < DATASET_HEADER_SIZE + DATASET_TRAILER_SIZE) {
+        ::close(fd);
+        throw CubeException(path + " is too small to be a dataset");
+    }
+    mappedSize = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw CubeException("Cannot map " + path);
+    }
+    data = static_cast<const uint8_t*>(mapping);
+
+    try {
+        fileHeader = decodeHeader(data);
+        uint64_t chunkCount;
+        uint64_t footerOffset;
+        if (!decodeTrailer(data + mappedSize - DATASET_TRAILER_SIZE, chunkCount, footerOffset) ||
+            footerOffset + chunkCount * DATASET_INDEX_ENTRY_SIZE + DATASET_TRAILER_SIZE != mappedSize) {
+            throw CubeException(path + " has no chunk index; the run that wrote it did not finish");
+        }
+        // Chunks are full and back to back, except that the last may be
+        // short, and together they hold every record the header counts
+        const uint64_t chunkBytes = uint64_t(fileHeader.chunkRecords) * DATASET_RECORD_SIZE;
+        uint64_t records = 0;
+        index.reserve(chunkCount);
+        for (uint64_t i = 0; i < chunkCount; i++) {
+            index.push_back(decodeIndexEntry(data + footerOffset + i * DATASET_INDEX_ENTRY_SIZE));
+            const DatasetChunk& entry = index.back();
+            bool lengthsValid = (entry.shortest <= DATASET_MAX_MOVES || entry.shortest == DATASET_UNSOLVED) &&
+                                entry.longest <= DATASET_MAX_MOVES;
+            bool countValid = i + 1 < chunkCount ? entry.count == fileHeader.chunkRecords
+                                                 : entry.count <= fileHeader.chunkRecords;
+            if (!lengthsValid || !countValid || entry.offset != DATASET_HEADER_SIZE + i * chunkBytes ||
+                entry.offset + uint64_t(entry.count) * DATASET_RECORD_SIZE > footerOffset) {
+                throw CubeException(path + " has a corrupt chunk index");
+            }
+            records += entry.count;
+        }
+        if (records != fileHeader.totalRecords) {
+            throw CubeException(path + " has a corrupt chunk index");
+        }
+    } catch (...) {
+        ::munmap(const_cast<uint8_t*>(data), mappedSize);
+        throw;
+    }
+}
+
+DatasetReader::~DatasetReader() {
+    ::munmap(const_cast<uint8_t*>(data), mappedSize);
+}
+
+DatasetReader::ChunkView DatasetReader::chunk(size_t i) const {
+    const DatasetChunk& entry = index[i];
+    ChunkView view;
+    view.firstRecord = static_cast<uint64_t>(i) * fileHeader.chunkRecords;
+    view.count = entry.count;
+    view.lengths = data + entry.offset;
+    view.states = view.lengths + entry.count;
+    view.moves = view.states + entry.count * DATASET_STATE_BYTES;
+    return view;
+}
+
+DatasetRecord DatasetReader::record(uint64_t index) const {
+    if (index >= size()) {
+        throw CubeException("Record index out of range: " + std::to_string(index));
+    }
+    DatasetRecord result;
+    chunk(index / fileHeader.chunkRecords).record(static_cast<uint32_t>(index % fileHeader.chunkRecords), result);
+    return result;
+}
+
+Cube DatasetReader::cube(uint64_t index) const {
+    Cube::Facelets facelets;
+    cubieToFacelets(record(index).state, facelets);
+    Cube result;
+    if (!result.setFacelets(facelets)) {
+        throw CubeException("Corrupt dataset record " + std::to_string(index) + ": " +
+                            Cube::validate(facelets).message());
+    }
+    return result;
+}
+
+void DatasetReader::scan(const std::function<bool(const DatasetChunk&)>& filter,
+                         const std::function<void(const ChunkView&)>& visit, int threads) const {
+    std::vector<size_t> selected;
+    for (size_t i = 0; i < index.size(); i++) {
+        if (!filter || filter(index[i])) {
+            selected.push_back(i);
+        }
+    }
+    int threadCount = threads > 0 ? threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threadCount = static_cast<int>(std::min<size_t>(threadCount, selected.size()));
+
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next++; i < selected.size(); i = next++) {
+            visit(chunk(selected[i]));
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threadCount; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+}
+
+std::array<uint64_t, DATASET_MAX_MOVES + 2> DatasetReader::lengthHistogram(int threads) const {
+    std::array<uint64_t, DATASET_MAX_MOVES + 2> histogram{};
+    const size_t unsolved = histogram.size() - 1;
+    std::mutex mutex;
+
+    // Chunks holding a single length are counted from the index alone
+    auto needsScan = [&](const DatasetChunk& entry) {
+        if (entry.shortest == entry.longest && !entry.hasUnsolved) {
+            std::lock_guard<std::mutex> lock(mutex);
+            histogram[entry.shortest] += entry.count;
+            return false;
+        }
+        if (entry.shortest == DATASET_UNSOLVED) {
+            std::lock_guard<std::mutex> lock(mutex);
+            histogram[unsolved] += entry.count;
+            return false;
+        }
+        return true;
+    };
+    scan(needsScan, [&](const ChunkView& view) {
+        std::array<uint64_t, 256> local{};
+        for (uint32_t i = 0; i < view.count; i++) {
+            local[view.lengths[i]]++;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int length = 0; length <= DATASET_MAX_MOVES; length++) {
+            histogram[length] += local[length];
+        }
+        histogram[unsolved] += local[DATASET_UNSOLVED];
+    }, threads);
+    return histogram;
+}
+
+std::vector<uint64_t> DatasetReader::findByLength(int length, int threads) const {
+    std::vector<std::vector<uint64_t>> perChunk(index.size());
+    const uint8_t wanted = length < 0 ? DATASET_UNSOLVED : static_cast<uint8_t>(length);
+    scan([&](const DatasetChunk& entry) { return entry.mayContain(length); },
+         [&](const ChunkView& view) {
+             std::vector<uint64_t>& matches = perChunk[view.firstRecord / fileHeader.chunkRecords];
+             for (uint32_t i = 0; i < view.count; i++) {
+                 if (view.lengths[i] == wanted) {
+                     matches.push_back(view.firstRecord + i);
+                 }
+             }
+         }, threads);
+
+    std::vector<uint64_t> result;
+    for (const std::vector<uint64_t>& matches : perChunk) {
+        result.insert(result.end(), matches.begin(), matches.end());
+    }
+    return result;
+}
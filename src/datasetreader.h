@@ -0,0 +1,66 @@
+#ifndef RUBIKSCUBE_DATASETREADER_H
+#define RUBIKSCUBE_DATASETREADER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "dataset.h"
+
+// Read-only, memory-mapped view of a complete dataset file. Columns are
+// read in place; states and solutions are only decoded when asked for.
+class DatasetReader {
+public:
+    // Zero-copy view of one chunk's columns
+    struct ChunkView {
+        uint64_t firstRecord;
+        uint32_t count;
+        const uint8_t* lengths;
+        const uint8_t* states;
+        const uint8_t* moves;
+
+        int length(uint32_t i) const { return lengths[i] == DATASET_UNSOLVED ? -1 : lengths[i]; }
+        CubieCube state(uint32_t i) const { return unpackState(states + i * DATASET_STATE_BYTES); }
+        void record(uint32_t i, DatasetRecord& out) const;  // throws as DatasetReader::record()
+    };
+
+    // Throws CubeException if the file cannot be mapped, or is not a
+    // complete dataset (no footer index, or one that disagrees with the
+    // header)
+    explicit DatasetReader(const std::string& path);
+    ~DatasetReader();
+
+    DatasetReader(const DatasetReader&) = delete;
+    DatasetReader& operator=(const DatasetReader&) = delete;
+
+    const DatasetHeader& header() const { return fileHeader; }
+    uint64_t size() const { return fileHeader.totalRecords; }
+    const std::vector<DatasetChunk>& chunks() const { return index; }
+    ChunkView chunk(size_t i) const;
+
+    // Throw CubeException if the record's length or state is corrupt
+    DatasetRecord record(uint64_t index) const;
+    Cube cube(uint64_t index) const;
+
+    // Visit, in parallel, every chunk whose index entry passes filter.
+    // visit runs on worker threads and must be thread-safe.
+    void scan(const std::function<bool(const DatasetChunk&)>& filter,
+              const std::function<void(const ChunkView&)>& visit, int threads = 0) const;
+
+    // Records per solution length; the last slot counts unsolved records
+    std::array<uint64_t, DATASET_MAX_MOVES + 2> lengthHistogram(int threads = 0) const;
+
+    // Indices, in file order, of records with this solution length
+    // (-1 = unsolved); chunks whose range excludes it are never touched
+    std::vector<uint64_t> findByLength(int length, int threads = 0) const;
+
+private:
+    const uint8_t* data;
+    size_t mappedSize;
+    DatasetHeader fileHeader;
+    std::vector<DatasetChunk> index;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "frameprofiler.h"
+#include <algorithm>
+
+namespace {
+
+// p-th percentile of values, in milliseconds
+double percentileMillis(std::vector<qint64>& values, double p)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min<size_t>(values.size() - 1, static_cast<size_t>(p * values.size()))] / 1e6;
+}
+
+QString micros(qint64 nanos)
+{
+    return nanos < 0 ? QString() : QString::number(nanos / 1000.0, 'f', 1);
+}
+
+} // namespace
+
+FrameProfiler::FrameProfiler()
+    : frameStart(0)
+    , previousStart(-1)
+    , frameCount(0)
+    , updateRequests(0)
+{
+    clock.start();
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    setLog(QString());
+}
+
+void FrameProfiler::initialize()
+{
+    for (int i = 0; i < QUERY_SLOTS; i++) {
+        auto query = std::make_unique<QOpenGLTimerQuery>();
+        if (!query->create()) {
+            queries.clear();
+            break;
+        }
+        queries.push_back(std::move(query));
+    }
+    queryBusy.assign(queries.size(), false);
+}
+
+void FrameProfiler::release()
+{
+    collect(true);
+    queries.clear();
+    queryBusy.clear();
+}
+
+void FrameProfiler::beginFrame()
+{
+    collect(false);
+    frameStart = clock.nsecsElapsed();
+    current = Frame();
+    current.number = frameCount++;
+    current.intervalNanos = previousStart >= 0 ? frameStart - previousStart : 0;
+    current.updateRequests = updateRequests;
+    previousStart = frameStart;
+    updateRequests = 0;
+
+    for (size_t slot = 0; slot < queries.size(); slot++) {
+        if (!queryBusy[slot]) {
+            queryBusy[slot] = true;
+            current.query = static_cast<int>(slot);
+            queries[slot]->begin();
+            break;
+        }
+    }
+}
+
+void FrameProfiler::endFrame()
+{
+    if (current.query >= 0) {
+        queries[current.query]->end();
+    }
+    current.cpuNanos = clock.nsecsElapsed() - frameStart;
+    pending.push_back(current);
+}
+
+// Record finished frames in order, stopping at the first whose GPU time is
+// not in yet unless told to wait for it
+void FrameProfiler::collect(bool wait)
+{
+    while (!pending.empty()) {
+        Frame& frame = pending.front();
+        if (frame.query >= 0) {
+            QOpenGLTimerQuery& query = *queries[frame.query];
+            if (!wait && !query.isResultAvailable()) {
+                break;
+            }
+            frame.gpuNanos = static_cast<qint64>(query.waitForResult());
+            queryBusy[frame.query] = false;
+        }
+        record(frame);
+        pending.pop_front();
+    }
+}
+
+void FrameProfiler::record(const Frame& frame)
+{
+    recent.push_back(frame);
+    if (recent.size() > static_cast<size_t>(WINDOW)) {
+        recent.pop_front();
+    }
+    if (logFile.isOpen()) {
+        log << frame.number << ',' << micros(frame.cpuNanos) << ',' << micros(frame.gpuNanos) << ','
+            << micros(frame.intervalNanos) << ',' << frame.drawCalls << ',' << frame.uniformUploads << ','
+            << frame.updateRequests << '\n';
+    }
+}
+
+bool FrameProfiler::setLog(const QString& path)
+{
+    if (logFile.isOpen()) {
+        log.flush();
+        log.setDevice(nullptr);
+        logFile.close();
+    }
+    if (path.isEmpty()) {
+        return true;
+    }
+    logFile.setFileName(path);
+    if (!logFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+    log.setDevice(&logFile);
+    log << "frame,cpu_us,gpu_us,interval_us,draw_calls,uniform_uploads,update_requests\n";
+    return true;
+}
+
+QStringList FrameProfiler::summary() const
+{
+    if (recent.empty()) {
+        return {QStringLiteral("no frames yet")};
+    }
+    std::vector<qint64> cpu;
+    std::vector<qint64> gpu;
+    std::vector<qint64> interval;
+    qint64 requests = 0;
+    for (const Frame& frame : recent) {
+        cpu.push_back(frame.cpuNanos);
+        if (frame.gpuNanos >= 0) {
+            gpu.push_back(frame.gpuNanos);
+        }
+        if (frame.intervalNanos > 0) {
+            interval.push_back(frame.intervalNanos);
+        }
+        requests += frame.updateRequests;
+    }
+
+    const Frame& last = recent.back();
+    QStringList lines;
+    lines << QString("CPU %1 ms  p50 %2  p99 %3")
+                 .arg(last.cpuNanos / 1e6, 6, 'f', 3)
+                 .arg(percentileMillis(cpu, 0.50), 6, 'f', 3)
+                 .arg(percentileMillis(cpu, 0.99), 6, 'f', 3);
+    if (gpu.empty()) {
+        lines << QStringLiteral("GPU n/a");
+    } else {
+        lines << QString("GPU %1 ms  p50 %2  p99 %3")
+                     .arg(last.gpuNanos < 0 ? QStringLiteral("-") : QString::number(last.gpuNanos / 1e6, 'f', 3), 6)
+                     .arg(percentileMillis(gpu, 0.50), 6, 'f', 3)
+                     .arg(percentileMillis(gpu, 0.99), 6, 'f', 3);
+    }
+    lines << QString("frame interval p50 %1 ms  p99 %2 ms")
+                 .arg(percentileMillis(interval, 0.50), 0, 'f', 1)
+                 .arg(percentileMillis(interval, 0.99), 0, 'f', 1);
+    lines << QString("draw calls %1  uniform uploads %2").arg(last.drawCalls).arg(last.uniformUploads);
+    lines << QString("update() calls per frame %1").arg(double(requests) / recent.size(), 0, 'f', 1);
+    return lines;
+}
@@ -0,0 +1,81 @@
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QOpenGLTimerQuery>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// Per-frame cost of a QOpenGLWidget: CPU time in paintGL, GPU time from
+// timer queries, draw calls and uniform uploads, and how many update()
+// requests each painted frame absorbed. GPU times arrive a few frames late,
+// so a frame is recorded (and logged) once its query has a result; GPU
+// time is -1 where timer queries are unavailable (before OpenGL 3.3 or
+// ARB_timer_query, or on OpenGL ES) or all of them were still in flight.
+//
+// Call initialize() and release() with the context current, and
+// beginFrame()/endFrame() around the work to measure.
+class FrameProfiler
+{
+public:
+    // Frames kept for the rolling percentiles
+    static constexpr int WINDOW = 240;
+
+    FrameProfiler();
+    ~FrameProfiler();
+
+    void initialize();
+    void release();
+
+    void beginFrame();
+    void endFrame();
+
+    void countDrawCall() { current.drawCalls++; }
+    void countUniformUploads(int uploads) { current.uniformUploads += uploads; }
+    void countUpdateRequest() { updateRequests++; }
+
+    // Append every recorded frame to a CSV file from now on; an empty path
+    // stops logging. Returns false if the file cannot be opened.
+    bool setLog(const QString& path);
+
+    // Overlay text: the last frame and the rolling window
+    QStringList summary() const;
+
+private:
+    struct Frame {
+        qint64 number = 0;
+        qint64 cpuNanos = 0;
+        qint64 gpuNanos = -1;
+        qint64 intervalNanos = 0;  // since the previous frame began
+        int drawCalls = 0;
+        int uniformUploads = 0;
+        int updateRequests = 0;    // update() calls since the previous frame
+        int query = -1;            // timer query slot, or -1
+    };
+
+    static constexpr int QUERY_SLOTS = 4;
+
+    void collect(bool wait);
+    void record(const Frame& frame);
+
+    std::vector<std::unique_ptr<QOpenGLTimerQuery>> queries;
+    std::vector<bool> queryBusy;
+    QElapsedTimer clock;
+    qint64 frameStart;
+    qint64 previousStart;
+    qint64 frameCount;
+    int updateRequests;
+    Frame current;
+    std::deque<Frame> pending;  // waiting for their GPU time
+    std::deque<Frame> recent;   // the last WINDOW recorded frames
+
+    QFile logFile;
+    QTextStream log;
+};
+
+#endif // FRAMEPROFILER_H
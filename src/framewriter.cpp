@@ -0,0 +1,187 @@
+#include "framewriter.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "cube.h"
+
+namespace {
+
+void putBigEndian32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Length, type, data and the CRC of type and data
+void putChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+    putBigEndian32(out, static_cast<uint32_t>(size));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    uLong crc = crc32(0L, out.data() + start, static_cast<uInt>(size + 4));
+    putBigEndian32(out, static_cast<uint32_t>(crc));
+}
+
+int encoderThreads(const FrameWriterOptions& options) {
+    if (options.format == FrameFormat::RAW) {
+        return 1;
+    }
+    return options.threads > 0 ? options.threads
+                               : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+bool writeAll(std::FILE* file, const uint8_t* data, size_t size) {
+    return std::fwrite(data, 1, size, file) == size;
+}
+
+} // namespace
+
+std::vector<uint8_t> encodePng(const uint8_t* rgb, int width, int height, int compression) {
+    // Every row uses the Up filter: the flat faces of a render turn into
+    // long runs of zeros, which deflate compresses well even at level 1
+    const size_t stride = size_t(width) * 3;
+    std::vector<uint8_t> filtered((stride + 1) * height);
+    for (int y = 0; y < height; y++) {
+        uint8_t* out = &filtered[(stride + 1) * y];
+        const uint8_t* row = rgb + stride * y;
+        out[0] = 2;
+        if (y == 0) {
+            std::copy(row, row + stride, out + 1);  // the row above the first is zeros
+            continue;
+        }
+        const uint8_t* above = rgb + stride * (y - 1);
+        for (size_t i = 0; i < stride; i++) {
+            out[i + 1] = static_cast<uint8_t>(row[i] - above[i]);
+        }
+    }
+
+    uLongf compressedSize = compressBound(static_cast<uLong>(filtered.size()));
+    std::vector<uint8_t> compressed(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, filtered.data(), static_cast<uLong>(filtered.size()),
+                  compression) != Z_OK) {
+        throw CubeException("PNG compression failed");
+    }
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<uint8_t> png(signature, signature + 8);
+    png.reserve(compressedSize + 64);
+    std::vector<uint8_t> header;
+    putBigEndian32(header, static_cast<uint32_t>(width));
+    putBigEndian32(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), {8, 2, 0, 0, 0});  // 8-bit RGB, deflate, no interlace
+    putChunk(png, "IHDR", header.data(), header.size());
+    putChunk(png, "IDAT", compressed.data(), compressedSize);
+    putChunk(png, "IEND", nullptr, 0);
+    return png;
+}
+
+FrameWriter::FrameWriter(const FrameWriterOptions& options)
+    : options(options)
+    , queue(options.queueFrames ? options.queueFrames : size_t(encoderThreads(options)) * 2)
+    , stream(nullptr)
+    , submitted(0)
+    , written(0)
+    , finished(false)
+{
+    if (options.format == FrameFormat::RAW) {
+        stream = options.path == "-" ? stdout : std::fopen(options.path.c_str(), "wb");
+        if (!stream) {
+            throw CubeException("Cannot open " + options.path + ": " + std::strerror(errno));
+        }
+    }
+    for (int i = encoderThreads(options); i > 0; i--) {
+        workers.emplace_back(&FrameWriter::workerLoop, this);
+    }
+}
+
+FrameWriter::~FrameWriter() {
+    try {
+        finish();
+    } catch (const CubeException&) {
+        // Already reported to whoever called finish(), or nobody is listening
+    }
+}
+
+void FrameWriter::write(std::vector<uint8_t>&& rgb) {
+    if (rgb.size() != size_t(options.width) * options.height * 3) {
+        throw CubeException("Frame size does not match the writer");
+    }
+    if (!queue.push(Frame{submitted++, std::move(rgb)})) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        throw CubeException(error.empty() ? "Frame writer is closed" : error);
+    }
+}
+
+void FrameWriter::finish() {
+    if (finished) {
+        return;
+    }
+    finished = true;
+    queue.close();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    if (stream) {
+        bool flushed = std::fflush(stream) == 0;
+        if (stream != stdout) {
+            flushed = std::fclose(stream) == 0 && flushed;
+        }
+        stream = nullptr;
+        if (!flushed) {
+            fail("Cannot write " + options.path);
+        }
+    }
+    std::lock_guard<std::mutex> lock(errorMutex);
+    if (!error.empty()) {
+        throw CubeException(error);
+    }
+}
+
+void FrameWriter::workerLoop() {
+    Frame frame;
+    while (queue.pop(frame)) {
+        try {
+            writeFrame(frame);
+            written++;
+        } catch (const CubeException& e) {
+            fail(e.what());
+        }
+    }
+}
+
+void FrameWriter::writeFrame(const Frame& frame) {
+    if (options.format == FrameFormat::RAW) {
+        if (!writeAll(stream, frame.rgb.data(), frame.rgb.size())) {
+            throw CubeException("Cannot write " + options.path + ": " + std::strerror(errno));
+        }
+        return;
+    }
+
+    std::vector<uint8_t> png = encodePng(frame.rgb.data(), options.width, options.height, options.compression);
+    char number[32];
+    std::snprintf(number, sizeof(number), "%05llu.png", static_cast<unsigned long long>(frame.index));
+    std::string path = options.path + number;
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw CubeException("Cannot open " + path + ": " + std::strerror(errno));
+    }
+    bool ok = writeAll(file, png.data(), png.size());
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        throw CubeException("Cannot write " + path);
+    }
+}
+
+void FrameWriter::fail(const std::string& message) {
+    {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (error.empty()) {
+            error = message;
+        }
+    }
+    // Unblock the producer; write() reports the error from now on
+    queue.close();
+}
@@ -0,0 +1,74 @@
+#ifndef RUBIKSCUBE_FRAMEWRITER_H
+#define RUBIKSCUBE_FRAMEWRITER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "boundedqueue.h"
+
+enum class FrameFormat {
+    PNG,  // one file per frame: <path>00000.png, <path>00001.png, ...
+    RAW   // one stream of packed RGB24 frames; path "-" is stdout
+};
+
+struct FrameWriterOptions {
+    FrameFormat format = FrameFormat::PNG;
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int threads = 0;         // PNG encoders; 0 = one per hardware thread
+    size_t queueFrames = 0;  // frames buffered ahead of the encoders; 0 = 2 per thread
+    int compression = 1;     // zlib level for PNG
+};
+
+// Encodes and writes RGB24 frames on worker threads while the caller
+// renders the next ones. write() blocks when the encoders fall behind.
+// PNG frames are encoded in parallel, each into its own file; a raw stream
+// has a single writer so frames stay in order.
+class FrameWriter {
+public:
+    // Throws CubeException if a raw output cannot be opened
+    explicit FrameWriter(const FrameWriterOptions& options);
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // Takes a frame of width * height * 3 bytes. Throws CubeException if
+    // an earlier frame failed to write.
+    void write(std::vector<uint8_t>&& rgb);
+
+    // Wait for every frame to be written; throws CubeException on failure
+    void finish();
+
+    uint64_t framesWritten() const { return written.load(); }
+
+private:
+    struct Frame {
+        uint64_t index;
+        std::vector<uint8_t> rgb;
+    };
+
+    void workerLoop();
+    void writeFrame(const Frame& frame);
+    void fail(const std::string& message);
+
+    FrameWriterOptions options;
+    BoundedQueue<Frame> queue;
+    std::vector<std::thread> workers;
+    std::FILE* stream;
+    uint64_t submitted;
+    std::atomic<uint64_t> written;
+    std::mutex errorMutex;
+    std::string error;
+    bool finished;
+};
+
+// PNG file (8-bit RGB, no interlace) holding one RGB24 image
+std::vector<uint8_t> encodePng(const uint8_t* rgb, int width, int height, int compression = 1);
+
+#endif
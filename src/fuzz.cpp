@@ -0,0 +1,431 @@
+// Differential fuzzer. Runs seeded random move sequences through every move
+// engine and checks each against a reference that turns stickers by
+// rotating their coordinates in space, independent of the compile-time
+// move tables. Also checks group identities, and that solver output
+// really solves its input. Case i depends only on the seed and i, so a
+// failure is replayed with -s seed -f i -n 1.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "lastlayer.h"
+#include "solver.h"
+#include "stepsolver.h"
+
+namespace {
+
+// The named face turns, in move number order
+using NamedTurn = void (Cube::*)();
+const NamedTurn REFERENCE_MOVES[NUM_MOVES] = {
+    &Cube::F, &Cube::FPrime, &Cube::F2, &Cube::B, &Cube::BPrime, &Cube::B2,
+    &Cube::L, &Cube::LPrime, &Cube::L2, &Cube::R, &Cube::RPrime, &Cube::R2,
+    &Cube::U, &Cube::UPrime, &Cube::U2, &Cube::D, &Cube::DPrime, &Cube::D2
+};
+
+struct Vec {
+    int x, y, z;
+    bool operator==(const Vec& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+Vec operator+(Vec a, Vec b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+Vec operator*(int k, Vec v) { return {k * v.x, k * v.y, k * v.z}; }
+int dot(Vec a, Vec b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+Vec cross(Vec a, Vec b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+
+// The reference engine. A sticker is its cubie's position (coordinates
+// -1..1) and the direction it faces; a clockwise turn rotates the stickers
+// of the turning layer a quarter turn about the face's outward axis.
+struct GeometricCube {
+    Cube::Facelets faces = Cube().getFacelets();
+
+    // The same flat gather as Cube::turn(), through tables built here
+    void applyMove(int move) {
+        static const std::vector<std::array<int, 54>> moveTables = buildMoves();
+        const std::array<int, 54>& source = moveTables[move];
+        const Cube::Facelets before = faces;
+        const Color* from = before[0].data();
+        Color* to = faces[0].data();
+        for (int i = 0; i < 54; i++) {
+            to[i] = from[source[i]];
+        }
+    }
+
+    // Outward normal, then the directions of increasing column and row,
+    // of each face in Face order as the facelets are laid out
+    static void sticker(int facelet, Vec& position, Vec& normal) {
+        static const Vec frames[6][3] = {
+            {{0, 0, 1}, {1, 0, 0}, {0, -1, 0}},    // F
+            {{0, 0, -1}, {-1, 0, 0}, {0, -1, 0}},  // B
+            {{-1, 0, 0}, {0, 0, 1}, {0, -1, 0}},   // L
+            {{1, 0, 0}, {0, 0, -1}, {0, -1, 0}},   // R
+            {{0, 1, 0}, {1, 0, 0}, {0, 0, 1}},     // U
+            {{0, -1, 0}, {1, 0, 0}, {0, 0, -1}}    // D
+        };
+        const Vec* frame = frames[facelet / 9];
+        int row = facelet % 9 / 3;
+        int col = facelet % 3;
+        normal = frame[0];
+        position = frame[0] + (col - 1) * frame[1] + (row - 1) * frame[2];
+    }
+
+    // quarterTurns[face][i] is the facelet whose sticker a clockwise
+    // quarter turn carries to facelet i
+    static std::vector<std::array<int, 54>> buildQuarterTurns() {
+        std::vector<std::array<int, 54>> result(6);
+        for (int face = 0; face < 6; face++) {
+            Vec axis;
+            Vec unused;
+            sticker(face * 9 + 4, unused, axis);
+            auto rotate = [&](Vec v) { return dot(axis, v) * axis + -1 * cross(axis, v); };
+            result[face] = {};
+            for (int i = 0; i < 54; i++) {
+                Vec position;
+                Vec normal;
+                sticker(i, position, normal);
+                if (dot(position, axis) != 1) {
+                    result[face][i] = i;
+                    continue;
+                }
+                for (int j = 0; j < 54; j++) {
+                    Vec to;
+                    Vec toNormal;
+                    sticker(j, to, toNormal);
+                    if (to == rotate(position) && toNormal == rotate(normal)) {
+                        result[face][j] = i;
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    // Moves as one, two or three quarter turns
+    static std::vector<std::array<int, 54>> buildMoves() {
+        static const int turns[3] = {1, 3, 2};
+        std::vector<std::array<int, 54>> quarterTurns = buildQuarterTurns();
+        std::vector<std::array<int, 54>> result(NUM_MOVES);
+        for (int m = 0; m < NUM_MOVES; m++) {
+            for (int i = 0; i < 54; i++) {
+                int source = i;
+                for (int t = 0; t < turns[m % 3]; t++) {
+                    source = quarterTurns[m / 3][source];
+                }
+                result[m][i] = source;
+            }
+        }
+        return result;
+    }
+};
+
+int inverseMove(int move) {
+    static const int inverse[3] = {1, 0, 2};
+    return move / 3 * 3 + inverse[move % 3];
+}
+
+struct FuzzOptions {
+    uint64_t first = 0;
+    uint64_t cases = 100000;
+    int length = 100;
+    uint64_t seed = 1;
+    int threads = 0;
+    uint64_t solveEvery = 1000;  // 0 = no solver checks
+    std::string ollPath;
+    std::string pllPath;
+};
+
+std::string movesToString(const std::vector<int>& moves) {
+    std::string result;
+    for (int move : moves) {
+        if (!result.empty()) {
+            result += ' ';
+        }
+        result += Cube::moveName(move);
+    }
+    return result;
+}
+
+// Every engine applies moves and reports whether it ends up solved; the
+// identities must hold in all of them
+template <typename State, typename Apply, typename Solved>
+bool holds(const std::vector<int>& sequence, int repeat, Apply apply, Solved solved) {
+    State state;
+    for (int r = 0; r < repeat; r++) {
+        for (int move : sequence) {
+            apply(state, move);
+        }
+    }
+    return solved(state);
+}
+
+bool identityHolds(const std::vector<int>& sequence, int repeat) {
+    auto geometric = [](GeometricCube& cube, int move) { cube.applyMove(move); };
+    auto geometricSolved = [](const GeometricCube& cube) { return cube.faces == Cube().getFacelets(); };
+    auto reference = [](Cube& cube, int move) { (cube.*REFERENCE_MOVES[move])(); };
+    auto dispatch = [](Cube& cube, int move) { cube.applyMove(move); };
+    auto cubie = [](CubieCube& cube, int move) { cube.applyMove(move); };
+    auto cubeSolved = [](const Cube& cube) { return cube.isSolved(); };
+    auto cubieSolved = [](const CubieCube& cube) { return cube == CubieCube(); };
+    return holds<GeometricCube>(sequence, repeat, geometric, geometricSolved) &&
+           holds<Cube>(sequence, repeat, reference, cubeSolved) &&
+           holds<Cube>(sequence, repeat, dispatch, cubeSolved) &&
+           holds<CubieCube>(sequence, repeat, cubie, cubieSolved);
+}
+
+// Fixed identities, checked once: each returns the failure, or "" if all hold
+std::string checkIdentities() {
+    const int R = 9, U = 12, RP = 10, UP = 13;
+    struct Identity {
+        std::vector<int> sequence;
+        int repeat;
+    };
+    std::vector<Identity> identities = {
+        {{R, U}, 105},                              // (R U) has order 105
+        {{R, U, RP, UP}, 6},                        // sexy move has order 6
+        {{R, U, RP, U, R, U + 2, RP}, 6},           // Sune has order 6
+    };
+    for (int m = 0; m < NUM_MOVES; m++) {
+        identities.push_back({{m, inverseMove(m)}, 1});  // X X' = I
+        identities.push_back({{m}, m % 3 == 2 ? 2 : 4});  // X^4 = I, X2^2 = I
+        int opposite = (m / 3 ^ 1) * 3;
+        for (int k = 0; k < 3; k++) {
+            // Opposite faces commute: X Y X' Y' = I
+            identities.push_back({{m, opposite + k, inverseMove(m), inverseMove(opposite + k)}, 1});
+        }
+    }
+    for (const Identity& identity : identities) {
+        if (!identityHolds(identity.sequence, identity.repeat)) {
+            return "(" + movesToString(identity.sequence) + ")^" + std::to_string(identity.repeat) + " is not the identity";
+        }
+    }
+    // And no shorter power of (R U) is
+    for (int repeat = 1; repeat < 105; repeat++) {
+        if (identityHolds({R, U}, repeat)) {
+            return "(R U)^" + std::to_string(repeat) + " is the identity";
+        }
+    }
+    return "";
+}
+
+struct Checker {
+    const FuzzOptions& options;
+    const LastLayerTable* oll;
+    const LastLayerTable* pll;
+    Solver solver;
+    std::unique_ptr<StepSolver> stepSolver;
+    Solution solution;
+    StepSolution steps;
+    std::vector<int> moves;
+
+    Checker(const FuzzOptions& options, const LastLayerTable* oll, const LastLayerTable* pll)
+        : options(options), oll(oll), pll(pll) {
+        if (oll && pll) {
+            stepSolver.reset(new StepSolver(*oll, *pll));
+        }
+    }
+
+    // Returns the failure, or "" if the case passes
+    std::string run(uint64_t index) {
+        std::mt19937_64 gen(splitMix64(options.seed ^ splitMix64(index)));
+        std::uniform_int_distribution<int> randomMove(0, NUM_MOVES - 1);
+        moves.resize(options.length);
+        for (int& move : moves) {
+            move = randomMove(gen);
+        }
+        int split = std::uniform_int_distribution<int>(0, options.length)(gen);
+
+        GeometricCube geometric;
+        Cube reference;
+        Cube dispatch;
+        CubieCube cubie;
+        CubieCube prefix;
+        CubieCube suffix;
+        for (int i = 0; i < options.length; i++) {
+            geometric.applyMove(moves[i]);
+            (reference.*REFERENCE_MOVES[moves[i]])();
+            dispatch.applyMove(moves[i]);
+            cubie.applyMove(moves[i]);
+            (i < split ? prefix : suffix).multiply(moveCube(moves[i]));
+        }
+
+        if (reference.getFacelets() != geometric.faces) {
+            return "the named turns differ from the reference";
+        }
+        if (dispatch.getFacelets() != geometric.faces) {
+            return "Cube::applyMove() differs from the reference";
+        }
+        Cube::Facelets painted;
+        cubieToFacelets(cubie, painted);
+        if (painted != geometric.faces) {
+            return "CubieCube::applyMove() differs from the reference";
+        }
+        prefix.multiply(suffix);
+        if (prefix != cubie) {
+            return "CubieCube::multiply() of the halves split at " + std::to_string(split) +
+                   " differs from the move by move product";
+        }
+        CubieCube recovered;
+        if (!faceletsToCubie(reference.getFacelets(), recovered).ok() || recovered != cubie) {
+            return "faceletsToCubie() does not recover the cubies";
+        }
+        Cube parsed;
+        if (!parsed.setState(reference.getState()) || parsed.getFacelets() != reference.getFacelets()) {
+            return "getState() does not round-trip through setState()";
+        }
+
+        // X followed by the inverse sequence is the identity
+        Cube undone = reference;
+        for (int i = options.length - 1; i >= 0; i--) {
+            (undone.*REFERENCE_MOVES[inverseMove(moves[i])])();
+        }
+        if (!undone.isSolved()) {
+            return "the inverse sequence does not undo the sequence";
+        }
+
+        if (options.solveEvery != 0 && index % options.solveEvery == 0) {
+            return checkSolvers(reference, cubie);
+        }
+        return "";
+    }
+
+    std::string checkSolvers(const Cube& reference, const CubieCube& cubie) {
+        SolveOptions solveOptions;
+        if (!solver.solve(cubie, solveOptions, solution)) {
+            return "Solver found no solution";
+        }
+        Cube solved = reference;
+        for (int i = 0; i < solution.length; i++) {
+            (solved.*REFERENCE_MOVES[solution.moves[i]])();
+        }
+        if (!solved.isSolved()) {
+            return "Solver solution " + solution.toString() + " does not solve the cube";
+        }
+
+        if (stepSolver) {
+            if (!stepSolver->solve(cubie, steps)) {
+                return "StepSolver found no solution";
+            }
+            solved = reference;
+            for (const Solution& step : steps.steps) {
+                for (int i = 0; i < step.length; i++) {
+                    (solved.*REFERENCE_MOVES[step.moves[i]])();
+                }
+            }
+            if (!solved.isSolved()) {
+                return "StepSolver solution " + steps.toString() + " does not solve the cube";
+            }
+        }
+        return "";
+    }
+};
+
+void usage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [-n cases] [-f first] [-l length] [-s seed] [-j threads]\n"
+                 "       [-S solve-every] [-o oll-table -p pll-table]\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    FuzzOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        if (arg == "-n") options.cases = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "-f") options.first = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "-l") options.length = std::atoi(argv[++i]);
+        else if (arg == "-s") options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "-j") options.threads = std::atoi(argv[++i]);
+        else if (arg == "-S") options.solveEvery = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "-o") options.ollPath = argv[++i];
+        else if (arg == "-p") options.pllPath = argv[++i];
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.length < 0 || options.ollPath.empty() != options.pllPath.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::string failure = checkIdentities();
+    if (!failure.empty()) {
+        std::fprintf(stderr, "error: %s\n", failure.c_str());
+        return 1;
+    }
+
+    std::unique_ptr<LastLayerTable> oll;
+    std::unique_ptr<LastLayerTable> pll;
+    try {
+        if (!options.ollPath.empty()) {
+            oll.reset(new LastLayerTable(LastLayerTable::load(options.ollPath)));
+            pll.reset(new LastLayerTable(LastLayerTable::load(options.pllPath)));
+            StepSolver::warmUp();
+        }
+        if (options.solveEvery != 0) {
+            Solver::warmUp();
+        }
+    } catch (const CubeException& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+
+    constexpr uint64_t CHUNK = 1024;
+    std::atomic<uint64_t> next{0};
+    std::atomic<uint64_t> done{0};
+    std::atomic<bool> failed{false};
+    std::mutex reportMutex;
+    auto worker = [&] {
+        Checker checker(options, oll.get(), pll.get());
+        for (uint64_t chunk = next++; chunk * CHUNK < options.cases && !failed; chunk = next++) {
+            uint64_t end = std::min(options.cases, (chunk + 1) * CHUNK);
+            for (uint64_t i = chunk * CHUNK; i < end; i++) {
+                std::string error = checker.run(options.first + i);
+                if (!error.empty()) {
+                    std::lock_guard<std::mutex> lock(reportMutex);
+                    if (!failed.exchange(true)) {
+                        std::fprintf(stderr, "error: case %llu: %s\n  moves: %s\n  replay: -s %llu -f %llu -n 1 -l %d\n",
+                                     static_cast<unsigned long long>(options.first + i), error.c_str(),
+                                     movesToString(checker.moves).c_str(),
+                                     static_cast<unsigned long long>(options.seed),
+                                     static_cast<unsigned long long>(options.first + i), options.length);
+                    }
+                    return;
+                }
+            }
+            done += end - chunk * CHUNK;
+        }
+    };
+
+    int threadCount = options.threads > 0 ? options.threads
+                                          : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("cases            %llu\n", static_cast<unsigned long long>(done.load()));
+    std::printf("moves per case   %d\n", options.length);
+    std::printf("cases/min        %.0f\n", seconds > 0 ? done * 60.0 / seconds : 0.0);
+    std::printf("solver checks    %s\n", options.solveEvery == 0 ? "off"
+                                         : oll ? "two-phase, step" : "two-phase");
+    return failed ? 1 : 0;
+}
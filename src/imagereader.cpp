@@ -0,0 +1,249 @@
+#include "imagereader.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "cube.h"
+
+namespace {
+
+constexpr uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+constexpr size_t MAX_PIXELS = size_t(1) << 26;  // 64 megapixels
+
+uint32_t getBigEndian32(const uint8_t* p) {
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+}
+
+int paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+
+// Undo the per-row filters in place; rows are 1 filter byte + rowBytes.
+// The first row sees a row of zeros above it.
+void unfilter(uint8_t* data, int height, size_t rowBytes, size_t bpp) {
+    std::vector<uint8_t> zeros(rowBytes, 0);
+    const uint8_t* above = zeros.data();
+    for (int y = 0; y < height; y++) {
+        uint8_t filter = data[0];
+        uint8_t* row = data + 1;
+        switch (filter) {
+        case 0:
+            break;
+        case 1:
+            for (size_t i = bpp; i < rowBytes; i++) {
+                row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+            }
+            break;
+        case 2:
+            for (size_t i = 0; i < rowBytes; i++) {
+                row[i] = static_cast<uint8_t>(row[i] + above[i]);
+            }
+            break;
+        case 3:
+            for (size_t i = 0; i < rowBytes; i++) {
+                int left = i >= bpp ? row[i - bpp] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + (left + above[i]) / 2);
+            }
+            break;
+        case 4:
+            for (size_t i = 0; i < rowBytes; i++) {
+                int left = i >= bpp ? row[i - bpp] : 0;
+                int corner = i >= bpp ? above[i - bpp] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + paeth(left, above[i], corner));
+            }
+            break;
+        default:
+            throw CubeException("Bad PNG row filter");
+        }
+        above = row;
+        data += rowBytes + 1;
+    }
+}
+
+// Skip whitespace and # comments, then read a decimal number
+bool readPpmNumber(const uint8_t* data, size_t size, size_t& pos, int& value) {
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n') {
+                pos++;
+            }
+        } else if (std::isspace(data[pos])) {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    if (pos >= size || !std::isdigit(data[pos])) {
+        return false;
+    }
+    value = 0;
+    while (pos < size && std::isdigit(data[pos]) && value < (1 << 20)) {
+        value = value * 10 + (data[pos++] - '0');
+    }
+    return true;
+}
+
+} // namespace
+
+RgbImage decodePng(const uint8_t* data, size_t size) {
+    if (size < 8 || std::memcmp(data, PNG_SIGNATURE, 8) != 0) {
+        throw CubeException("Not a PNG file");
+    }
+    int width = 0;
+    int height = 0;
+    int bitDepth = 0;
+    int colorType = -1;
+    std::vector<uint8_t> palette;
+    std::vector<uint8_t> compressed;
+    for (size_t pos = 8; pos + 12 <= size;) {
+        uint32_t length = getBigEndian32(data + pos);
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* body = data + pos + 8;
+        if (length > size - pos - 12) {
+            throw CubeException("Truncated PNG chunk");
+        }
+        if (std::memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+            width = static_cast<int>(getBigEndian32(body));
+            height = static_cast<int>(getBigEndian32(body + 4));
+            bitDepth = body[8];
+            colorType = body[9];
+            if (body[12] != 0) {
+                throw CubeException("Interlaced PNG is not supported");
+            }
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            palette.assign(body, body + length);
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), body, body + length);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        pos += size_t(length) + 12;
+    }
+
+    int channels;
+    switch (colorType) {
+    case 0: channels = 1; break;
+    case 2: channels = 3; break;
+    case 3: channels = 1; break;
+    case 4: channels = 2; break;
+    case 6: channels = 4; break;
+    default: throw CubeException("Missing or bad PNG header");
+    }
+    bool supported = colorType == 3 ? bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8
+                                    : bitDepth == 8 || bitDepth == 16;
+    if (!supported || width <= 0 || height <= 0 || width > (1 << 15) || height > (1 << 15)) {
+        throw CubeException("Unsupported PNG format");
+    }
+
+    const size_t rowBytes = (size_t(width) * channels * bitDepth + 7) / 8;
+    const size_t bpp = std::max<size_t>(1, size_t(channels) * bitDepth / 8);
+    const size_t rawBytes = (rowBytes + 1) * height;
+    // Deflate expands at most about 1032:1, so a header claiming more than
+    // that is corrupt or hostile; check before allocating for it
+    if (size_t(width) * height > MAX_PIXELS || rawBytes / 1032 > compressed.size() + 1) {
+        throw CubeException("PNG image too large or data truncated");
+    }
+    std::vector<uint8_t> raw(rawBytes);
+    uLongf rawSize = static_cast<uLongf>(raw.size());
+    if (uncompress(raw.data(), &rawSize, compressed.data(), static_cast<uLong>(compressed.size())) != Z_OK ||
+        rawSize != raw.size()) {
+        throw CubeException("Corrupt PNG image data");
+    }
+    unfilter(raw.data(), height, rowBytes, bpp);
+
+    RgbImage image;
+    image.width = width;
+    image.height = height;
+    image.rgb.resize(size_t(width) * height * 3);
+    const int sampleBytes = bitDepth == 16 ? 2 : 1;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = raw.data() + (rowBytes + 1) * y + 1;
+        uint8_t* out = image.rgb.data() + size_t(width) * 3 * y;
+        for (int x = 0; x < width; x++, out += 3) {
+            if (colorType == 3) {
+                int perByte = 8 / bitDepth;
+                int shift = 8 - bitDepth * (x % perByte + 1);
+                size_t index = (row[x / perByte] >> shift) & ((1 << bitDepth) - 1);
+                if (index * 3 + 2 >= palette.size()) {
+                    throw CubeException("PNG palette index out of range");
+                }
+                std::memcpy(out, &palette[index * 3], 3);
+                continue;
+            }
+            // High byte of each sample; grey fills all three channels
+            const uint8_t* pixel = row + size_t(x) * channels * sampleBytes;
+            if (channels < 3) {
+                out[0] = out[1] = out[2] = pixel[0];
+            } else {
+                out[0] = pixel[0];
+                out[1] = pixel[sampleBytes];
+                out[2] = pixel[2 * sampleBytes];
+            }
+        }
+    }
+    return image;
+}
+
+RgbImage decodePpm(const uint8_t* data, size_t size) {
+    size_t pos = 2;
+    int width = 0;
+    int height = 0;
+    int maxValue = 0;
+    if (size < 2 || data[0] != 'P' || data[1] != '6' || !readPpmNumber(data, size, pos, width) ||
+        !readPpmNumber(data, size, pos, height) || !readPpmNumber(data, size, pos, maxValue) ||
+        width <= 0 || height <= 0 || width > (1 << 15) || height > (1 << 15) || maxValue <= 0 ||
+        maxValue > 65535) {
+        throw CubeException("Not a binary PPM file");
+    }
+    if (size_t(width) * height > MAX_PIXELS) {
+        throw CubeException("PPM image too large");
+    }
+    pos++;  // the single whitespace after maxval
+    const int sampleBytes = maxValue > 255 ? 2 : 1;
+    const size_t samples = size_t(width) * height * 3;
+    if (size < pos || size - pos < samples * sampleBytes) {
+        throw CubeException("Truncated PPM file");
+    }
+
+    RgbImage image;
+    image.width = width;
+    image.height = height;
+    image.rgb.resize(samples);
+    for (size_t i = 0; i < samples; i++) {
+        int value = sampleBytes == 2 ? data[pos + 2 * i] << 8 | data[pos + 2 * i + 1] : data[pos + i];
+        image.rgb[i] = static_cast<uint8_t>(maxValue == 255 ? value : value * 255 / maxValue);
+    }
+    return image;
+}
+
+RgbImage readImage(const std::string& path) {
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), std::fclose);
+    if (!file) {
+        throw CubeException("Cannot open " + path + ": " + std::strerror(errno));
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[1 << 16];
+    size_t read;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), file.get())) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    if (std::ferror(file.get())) {
+        throw CubeException("Cannot read " + path);
+    }
+    try {
+        if (data.size() >= 2 && data[0] == 'P' && data[1] == '6') {
+            return decodePpm(data.data(), data.size());
+        }
+        return decodePng(data.data(), data.size());
+    } catch (const CubeException& e) {
+        throw CubeException(path + ": " + e.what());
+    }
+}
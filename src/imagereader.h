@@ -0,0 +1,25 @@
+#ifndef RUBIKSCUBE_IMAGEREADER_H
+#define RUBIKSCUBE_IMAGEREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Packed 8-bit RGB, rows top to bottom
+struct RgbImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgb;
+};
+
+// PNG (any colour type at 8 or 16 bits, palettes at 1-8 bits, no
+// interlace) or binary PPM (P6), told apart by their signatures. Alpha is
+// dropped and 16-bit samples keep their high byte. Throws CubeException
+// on unreadable, malformed or unsupported files, and on images over 64
+// megapixels.
+RgbImage readImage(const std::string& path);
+RgbImage decodePng(const uint8_t* data, size_t size);
+RgbImage decodePpm(const uint8_t* data, size_t size);
+
+#endif
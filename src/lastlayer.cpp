@@ -0,0 +1,662 @@
+#include "lastlayer.h"
+#include "movetables.h"
+#include "searchtables.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr char LAST_LAYER_MAGIC[8] = {'C', 'U', 'B', 'E', 'L', 'L', '0', '1'};
+constexpr int LAST_LAYER_HEADER_SIZE = 16;
+constexpr uint32_t NO_CASE = 0xFFFFFFFF;
+
+constexpr int U_MOVE = 12;  // U, U' and U2 are moves 12-14
+constexpr int FIRST_D_CORNER = static_cast<int>(Corner::DFR);
+constexpr int FIRST_D_EDGE = static_cast<int>(Edge::DR);
+constexpr int FIRST_SLICE_EDGE = static_cast<int>(Edge::FR);
+
+int indexCount(LastLayerSet set) {
+    switch (set) {
+        case LastLayerSet::OLL: return 27 * 8;
+        case LastLayerSet::PLL: return 24 * 24;
+        case LastLayerSet::ZBLL: return 24 * 27 * 24;
+    }
+    return 0;
+}
+
+// Rank of a permutation of 0-3
+int rank4(const uint8_t* perm) {
+    int rank = 0;
+    for (int i = 0; i < 3; i++) {
+        int smaller = 0;
+        for (int j = i + 1; j < 4; j++) {
+            smaller += perm[j] < perm[i];
+        }
+        rank = rank * (4 - i) + smaller;
+    }
+    return rank;
+}
+
+void unrank4(int rank, uint8_t* perm) {
+    int digits[4] = {rank / 6, rank / 2 % 3, rank % 2, 0};
+    bool used[4] = {};
+    for (int i = 0; i < 4; i++) {
+        int value = 0;
+        for (int free = digits[i];; value++) {
+            if (!used[value] && free-- == 0) {
+                break;
+            }
+        }
+        used[value] = true;
+        perm[i] = static_cast<uint8_t>(value);
+    }
+}
+
+bool firstTwoLayersSolved(const CubieCube& cube) {
+    for (int i = FIRST_D_CORNER; i < NUM_CORNERS; i++) {
+        if (cube.cp[i] != i || cube.co[i] != 0) {
+            return false;
+        }
+    }
+    for (int i = FIRST_D_EDGE; i < NUM_EDGES; i++) {
+        if (cube.ep[i] != i || cube.eo[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int lastLayerIndex(LastLayerSet set, const CubieCube& cube) {
+    if (!firstTwoLayersSolved(cube)) {
+        return -1;
+    }
+    int twist = cube.co[0] * 9 + cube.co[1] * 3 + cube.co[2];
+    int flip = cube.eo[0] * 4 + cube.eo[1] * 2 + cube.eo[2];
+    switch (set) {
+        case LastLayerSet::OLL:
+            return twist * 8 + flip;
+        case LastLayerSet::PLL:
+            if (twist != 0 || cube.co[3] != 0 || flip != 0 || cube.eo[3] != 0) {
+                return -1;
+            }
+            return rank4(cube.cp.data()) * 24 + rank4(cube.ep.data());
+        case LastLayerSet::ZBLL:
+            if (flip != 0 || cube.eo[3] != 0) {
+                return -1;
+            }
+            return (rank4(cube.cp.data()) * 27 + twist) * 24 + rank4(cube.ep.data());
+    }
+    return -1;
+}
+
+// A cube with the first two layers solved and the last layer at index
+CubieCube lastLayerState(LastLayerSet set, int index) {
+    CubieCube cube;
+    int twist = 0;
+    int flip = 0;
+    switch (set) {
+        case LastLayerSet::OLL:
+            twist = index / 8;
+            flip = index % 8;
+            break;
+        case LastLayerSet::PLL:
+            unrank4(index / 24, cube.cp.data());
+            unrank4(index % 24, cube.ep.data());
+            break;
+        case LastLayerSet::ZBLL:
+            unrank4(index / (27 * 24), cube.cp.data());
+            twist = index / 24 % 27;
+            unrank4(index % 24, cube.ep.data());
+            break;
+    }
+    cube.co[0] = static_cast<uint8_t>(twist / 9);
+    cube.co[1] = static_cast<uint8_t>(twist / 3 % 3);
+    cube.co[2] = static_cast<uint8_t>(twist % 3);
+    cube.co[3] = static_cast<uint8_t>((6 - cube.co[0] - cube.co[1] - cube.co[2]) % 3);
+    cube.eo[0] = static_cast<uint8_t>(flip / 4);
+    cube.eo[1] = static_cast<uint8_t>(flip / 2 % 2);
+    cube.eo[2] = static_cast<uint8_t>(flip % 2);
+    cube.eo[3] = static_cast<uint8_t>((cube.eo[0] + cube.eo[1] + cube.eo[2]) % 2);
+    return cube;
+}
+
+bool evenPermutation(const uint8_t* perm) {
+    int inversions = 0;
+    for (int i = 0; i < 4; i++) {
+        for (int j = i + 1; j < 4; j++) {
+            inversions += perm[j] < perm[i];
+        }
+    }
+    return inversions % 2 == 0;
+}
+
+// U^turns as a cube, turns 0-3
+const CubieCube& uTurn(int turns) {
+    static const CubieCube identity;
+    static const int moves[4] = {-1, U_MOVE, U_MOVE + 2, U_MOVE + 1};
+    return turns == 0 ? identity : moveCube(moves[turns]);
+}
+
+// Reflection through the plane between L and R, with the slot images
+// from movetables.h
+CubieCube mirrored(const CubieCube& cube) {
+    CubieCube result;
+    for (int i = 0; i < NUM_CORNERS; i++) {
+        result.cp[i] = MIRROR_CORNER[cube.cp[MIRROR_CORNER[i]]];
+        result.co[i] = static_cast<uint8_t>((3 - cube.co[MIRROR_CORNER[i]]) % 3);
+    }
+    for (int i = 0; i < NUM_EDGES; i++) {
+        result.ep[i] = MIRROR_EDGE[cube.ep[MIRROR_EDGE[i]]];
+        result.eo[i] = cube.eo[MIRROR_EDGE[i]];
+    }
+    return result;
+}
+
+// Append move to out, merging it with a previous turn of the same face
+void appendMove(Solution& out, int move) {
+    static const int quarterTurns[3] = {1, 3, 2};
+    if (out.length > 0 && out.moves[out.length - 1] / 3 == move / 3) {
+        int face = move / 3;
+        int turns = (quarterTurns[out.moves[out.length - 1] % 3] + quarterTurns[move % 3]) % 4;
+        static const int directions[4] = {-1, 0, 2, 1};
+        if (turns == 0) {
+            out.length--;
+        } else {
+            out.moves[out.length - 1] = static_cast<uint8_t>(face * 3 + directions[turns]);
+        }
+        return;
+    }
+    out.moves[out.length++] = static_cast<uint8_t>(move);
+}
+
+void appendTurns(Solution& out, int turns) {
+    static const int moves[4] = {-1, U_MOVE, U_MOVE + 2, U_MOVE + 1};
+    if (turns != 0) {
+        appendMove(out, moves[turns]);
+    }
+}
+
+// Pruning tables for "first two layers solved and every piece oriented",
+// the OLL goal and a superset of the PLL and ZBLL goals: (D corner
+// placement, twist), (D edge placement, flip), (slice edge placement, flip)
+struct OrientedTables {
+    std::vector<uint16_t> twistMove;
+    std::vector<uint16_t> flipMove;
+    std::vector<uint16_t> cornerMove;  // D corner placement
+    std::vector<uint16_t> edgeMove;    // D edge placement
+    std::vector<uint16_t> sliceMove;   // slice edge placement
+    std::vector<uint8_t> cornerPrune;
+    std::vector<uint8_t> edgePrune;
+    std::vector<uint8_t> slicePrune;
+};
+
+// For PLL and ZBLL, distances to the nearest U turn of the solved cube in
+// (corner permutation, twist) and (U edge placement, flip)
+struct SolvedTables {
+    std::vector<uint16_t> cornerPermMove;
+    std::vector<uint16_t> uEdgeMove;
+    std::vector<uint8_t> cornerPrune;
+    std::vector<uint8_t> uEdgePrune;
+};
+
+const int* allMoves() {
+    static const int moves[NUM_MOVES] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17};
+    return moves;
+}
+
+OrientedTables buildOrientedTables() {
+    OrientedTables t;
+    buildMoveTable(t.twistMove, NUM_TWIST,
+                   [](const CubieCube& c) { return c.twist(); },
+                   [](CubieCube& c, int i) { c.setTwist(i); }, false);
+    buildMoveTable(t.flipMove, NUM_FLIP,
+                   [](const CubieCube& c) { return c.flip(); },
+                   [](CubieCube& c, int i) { c.setFlip(i); }, false);
+    buildMoveTable(t.cornerMove, NUM_CORNER_PLACEMENT,
+                   [](const CubieCube& c) { return c.cornerPlacement(FIRST_D_CORNER); },
+                   [](CubieCube& c, int i) { c.setCornerPlacement(FIRST_D_CORNER, i); }, false);
+    buildMoveTable(t.edgeMove, NUM_EDGE_PLACEMENT,
+                   [](const CubieCube& c) { return c.edgePlacement(FIRST_D_EDGE); },
+                   [](CubieCube& c, int i) { c.setEdgePlacement(FIRST_D_EDGE, i); }, false);
+    buildMoveTable(t.sliceMove, NUM_EDGE_PLACEMENT,
+                   [](const CubieCube& c) { return c.edgePlacement(FIRST_SLICE_EDGE); },
+                   [](CubieCube& c, int i) { c.setEdgePlacement(FIRST_SLICE_EDGE, i); }, false);
+
+    const CubieCube solved;
+    const uint16_t* twistMove = t.twistMove.data();
+    const uint16_t* flipMove = t.flipMove.data();
+    const uint16_t* cornerMove = t.cornerMove.data();
+    const uint16_t* edgeMove = t.edgeMove.data();
+    const uint16_t* sliceMove = t.sliceMove.data();
+
+    buildPruneTable(t.cornerPrune, NUM_CORNER_PLACEMENT * NUM_TWIST, allMoves(), NUM_MOVES,
+                    [=](uint32_t index, int m) {
+                        return cornerMove[index / NUM_TWIST * NUM_MOVES + m] * NUM_TWIST +
+                               twistMove[index % NUM_TWIST * NUM_MOVES + m];
+                    },
+                    {static_cast<uint32_t>(solved.cornerPlacement(FIRST_D_CORNER) * NUM_TWIST)});
+    buildPruneTable(t.edgePrune, NUM_EDGE_PLACEMENT * NUM_FLIP, allMoves(), NUM_MOVES,
+                    [=](uint32_t index, int m) {
+                        return edgeMove[index / NUM_FLIP * NUM_MOVES + m] * NUM_FLIP +
+                               flipMove[index % NUM_FLIP * NUM_MOVES + m];
+                    },
+                    {static_cast<uint32_t>(solved.edgePlacement(FIRST_D_EDGE) * NUM_FLIP)});
+    buildPruneTable(t.slicePrune, NUM_EDGE_PLACEMENT * NUM_FLIP, allMoves(), NUM_MOVES,
+                    [=](uint32_t index, int m) {
+                        return sliceMove[index / NUM_FLIP * NUM_MOVES + m] * NUM_FLIP +
+                               flipMove[index % NUM_FLIP * NUM_MOVES + m];
+                    },
+                    {static_cast<uint32_t>(solved.edgePlacement(FIRST_SLICE_EDGE) * NUM_FLIP)});
+    return t;
+}
+
+SolvedTables buildSolvedTables(const OrientedTables& oriented) {
+    SolvedTables t;
+    buildMoveTable(t.cornerPermMove, NUM_CORNER_PERM,
+                   [](const CubieCube& c) { return c.cornerPerm(); },
+                   [](CubieCube& c, int i) { c.setCornerPerm(i); }, false);
+    buildMoveTable(t.uEdgeMove, NUM_EDGE_PLACEMENT,
+                   [](const CubieCube& c) { return c.edgePlacement(0); },
+                   [](CubieCube& c, int i) { c.setEdgePlacement(0, i); }, false);
+
+    // Roots: the solved cube after U0, U, U2 and U'
+    uint32_t cornerRoots[4];
+    uint32_t edgeRoots[4];
+    for (int turns = 0; turns < 4; turns++) {
+        cornerRoots[turns] = static_cast<uint32_t>(uTurn(turns).cornerPerm()) * NUM_TWIST;
+        edgeRoots[turns] = static_cast<uint32_t>(uTurn(turns).edgePlacement(0)) * NUM_FLIP;
+    }
+    const uint16_t* twistMove = oriented.twistMove.data();
+    const uint16_t* flipMove = oriented.flipMove.data();
+    const uint16_t* cornerMove = t.cornerPermMove.data();
+    const uint16_t* edgeMove = t.uEdgeMove.data();
+
+    buildPruneTable(t.cornerPrune, static_cast<uint32_t>(NUM_CORNER_PERM) * NUM_TWIST, allMoves(), NUM_MOVES,
+                    [=](uint32_t index, int m) {
+                        return static_cast<uint32_t>(cornerMove[index / NUM_TWIST * NUM_MOVES + m]) * NUM_TWIST +
+                               twistMove[index % NUM_TWIST * NUM_MOVES + m];
+                    },
+                    {cornerRoots[0], cornerRoots[1], cornerRoots[2], cornerRoots[3]});
+    buildPruneTable(t.uEdgePrune, NUM_EDGE_PLACEMENT * NUM_FLIP, allMoves(), NUM_MOVES,
+                    [=](uint32_t index, int m) {
+                        return edgeMove[index / NUM_FLIP * NUM_MOVES + m] * NUM_FLIP +
+                               flipMove[index % NUM_FLIP * NUM_MOVES + m];
+                    },
+                    {edgeRoots[0], edgeRoots[1], edgeRoots[2], edgeRoots[3]});
+    return t;
+}
+
+const OrientedTables& orientedTables() {
+    static const OrientedTables instance = buildOrientedTables();
+    return instance;
+}
+
+const SolvedTables& solvedTables() {
+    static const SolvedTables instance = buildSolvedTables(orientedTables());
+    return instance;
+}
+
+// Iterative deepening search for one case, from each pre-AUF of start.
+// solved is null for OLL, whose goal leaves the permutation free.
+class CaseSearch {
+public:
+    CaseSearch(LastLayerSet set, const OrientedTables& t, const SolvedTables* solved)
+        : set(set), t(t), solved(solved), length(0) {}
+
+    // Shortest algorithm taking start to the set's goal, with its AUFs;
+    // false if there is none within maxLength moves
+    bool solve(const CubieCube& start, int maxLength, Solution& out) {
+        for (int depth = 0; depth <= maxLength; depth++) {
+            for (int pre = 0; pre < 4; pre++) {
+                origin = start;
+                origin.multiply(uTurn(pre));
+                Node node = {static_cast<uint16_t>(origin.twist()), static_cast<uint16_t>(origin.flip()),
+                             static_cast<uint16_t>(origin.cornerPlacement(FIRST_D_CORNER)),
+                             static_cast<uint16_t>(origin.edgePlacement(FIRST_D_EDGE)),
+                             static_cast<uint16_t>(origin.edgePlacement(FIRST_SLICE_EDGE)),
+                             static_cast<uint16_t>(origin.cornerPerm()),
+                             static_cast<uint16_t>(origin.edgePlacement(0))};
+                length = depth;
+                int post = 0;
+                if (search(node, 0, NO_MOVE, post)) {
+                    out.length = 0;
+                    out.nodes = 0;
+                    appendTurns(out, pre);
+                    for (int i = 0; i < depth; i++) {
+                        out.moves[out.length++] = path[i];
+                    }
+                    appendTurns(out, (4 - post) % 4);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Node {
+        uint16_t twist;
+        uint16_t flip;
+        uint16_t corners;
+        uint16_t edges;
+        uint16_t slice;
+        uint16_t cornerPerm;
+        uint16_t uEdges;  // U edge placement
+    };
+
+    int bound(const Node& n) const {
+        int h = std::max({t.cornerPrune[n.corners * NUM_TWIST + n.twist],
+                          t.edgePrune[n.edges * NUM_FLIP + n.flip],
+                          t.slicePrune[n.slice * NUM_FLIP + n.flip]});
+        if (solved) {
+            h = std::max({h, static_cast<int>(solved->cornerPrune[size_t(n.cornerPerm) * NUM_TWIST + n.twist]),
+                          static_cast<int>(solved->uEdgePrune[n.uEdges * NUM_FLIP + n.flip])});
+        }
+        return h;
+    }
+
+    // At a node where the first two layers are solved and everything is
+    // oriented: whether the goal is reached, and with which U turn
+    bool reachedGoal(int& post) const {
+        if (set == LastLayerSet::OLL) {
+            post = 0;
+            return true;
+        }
+        CubieCube cube = origin;
+        for (int i = 0; i < length; i++) {
+            cube.multiply(moveCube(path[i]));
+        }
+        for (post = 0; post < 4; post++) {
+            if (cube == uTurn(post)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool search(const Node& n, int depth, uint8_t previous, int& post) {
+        int togo = length - depth;
+        int h = bound(n);
+        if (h > togo) {
+            return false;
+        }
+        if (togo == 0) {
+            return reachedGoal(post);
+        }
+        for (int m = 0; m < NUM_MOVES; m++) {
+            // A leading U turn is another pre-AUF
+            if (!canFollow(previous, m) || (depth == 0 && m / 3 == U_MOVE / 3)) {
+                continue;
+            }
+            Node child = {t.twistMove[n.twist * NUM_MOVES + m], t.flipMove[n.flip * NUM_MOVES + m],
+                          t.cornerMove[n.corners * NUM_MOVES + m], t.edgeMove[n.edges * NUM_MOVES + m],
+                          t.sliceMove[n.slice * NUM_MOVES + m], 0, 0};
+            if (solved) {
+                child.cornerPerm = solved->cornerPermMove[n.cornerPerm * NUM_MOVES + m];
+                child.uEdges = solved->uEdgeMove[n.uEdges * NUM_MOVES + m];
+            }
+            path[depth] = static_cast<uint8_t>(m);
+            if (search(child, depth + 1, static_cast<uint8_t>(m), post)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    LastLayerSet set;
+    const OrientedTables& t;
+    const SolvedTables* solved;
+    CubieCube origin;
+    int length;
+    uint8_t path[MAX_LAST_LAYER_MOVES];
+};
+
+void put32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint32_t get32(const uint8_t* in) {
+    return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+
+using File = std::unique_ptr<std::FILE, FileCloser>;
+
+} // namespace
+
+const char* lastLayerSetName(LastLayerSet set) {
+    switch (set) {
+        case LastLayerSet::OLL: return "oll";
+        case LastLayerSet::PLL: return "pll";
+        case LastLayerSet::ZBLL: return "zbll";
+    }
+    return "";
+}
+
+bool parseLastLayerSet(const std::string& name, LastLayerSet& set) {
+    for (LastLayerSet candidate : {LastLayerSet::OLL, LastLayerSet::PLL, LastLayerSet::ZBLL}) {
+        if (name == lastLayerSetName(candidate)) {
+            set = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+LastLayerTable LastLayerTable::generate(LastLayerSet set, const LastLayerOptions& options,
+                                        const std::function<void(int, int)>& progress) {
+    if (options.maxLength < 0 || options.maxLength > MAX_LAST_LAYER_MOVES - 2) {
+        throw CubeException("Last layer algorithms are limited to " +
+                            std::to_string(MAX_LAST_LAYER_MOVES - 2) + " moves");
+    }
+    LastLayerTable table;
+    table.tableSet = set;
+    table.entries.assign(indexCount(set), NO_CASE);
+
+    // Group the reachable states into cases: the lowest index reachable by
+    // pre-AUF, post-AUF and mirroring names the case
+    std::vector<int> canonical;
+    std::vector<int> caseOfIndex(indexCount(set), -1);
+    for (int index = 0; index < indexCount(set); index++) {
+        CubieCube state = lastLayerState(set, index);
+        if (set != LastLayerSet::OLL && evenPermutation(state.cp.data()) != evenPermutation(state.ep.data())) {
+            continue;
+        }
+        int best = index;
+        uint32_t transform = 0;
+        for (int mirror = 0; mirror < 2; mirror++) {
+            for (int pre = 0; pre < 4; pre++) {
+                for (int post = 0; post < 4; post++) {
+                    CubieCube variant = uTurn(post);
+                    variant.multiply(state);
+                    variant.multiply(uTurn(pre));
+                    if (mirror) {
+                        variant = mirrored(variant);
+                    }
+                    int variantIndex = lastLayerIndex(set, variant);
+                    if (variantIndex < best) {
+                        best = variantIndex;
+                        transform = pre << 16 | post << 18 | mirror << 20;
+                    }
+                }
+            }
+        }
+        if (caseOfIndex[best] < 0) {
+            caseOfIndex[best] = static_cast<int>(canonical.size());
+            canonical.push_back(best);
+        }
+        table.entries[index] = static_cast<uint32_t>(caseOfIndex[best]) | transform;
+    }
+
+    // Cases are independent; search them in parallel
+    const int cases = static_cast<int>(canonical.size());
+    table.caseLengths.assign(cases, 0);
+    table.caseMoves.assign(size_t(cases) * MAX_LAST_LAYER_MOVES, 0);
+    const OrientedTables& t = orientedTables();
+    const SolvedTables* solved = set == LastLayerSet::OLL ? nullptr : &solvedTables();
+    std::atomic<int> next{0};
+    std::atomic<int> done{0};
+    std::atomic<int> failed{-1};
+    auto worker = [&] {
+        CaseSearch search(set, t, solved);
+        Solution solution;
+        for (int i = next++; i < cases && failed < 0; i = next++) {
+            if (!search.solve(lastLayerState(set, canonical[i]), options.maxLength, solution)) {
+                failed = i;
+                break;
+            }
+            table.caseLengths[i] = static_cast<uint8_t>(solution.length);
+            std::copy(solution.moves.begin(), solution.moves.begin() + solution.length,
+                      table.caseMoves.begin() + size_t(i) * MAX_LAST_LAYER_MOVES);
+            done++;
+        }
+    };
+    int threadCount = options.threads > 0 ? options.threads
+                                          : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threadCount; i++) {
+        workers.emplace_back(worker);
+    }
+    if (progress) {
+        // Report from this thread while the workers search
+        std::thread searcher(worker);
+        while (done < cases && failed < 0) {
+            progress(done, cases);
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+        searcher.join();
+    } else {
+        worker();
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    if (failed >= 0) {
+        throw CubeException("No " + std::string(lastLayerSetName(set)) + " algorithm within " +
+                            std::to_string(options.maxLength) + " moves for case " + std::to_string(failed.load()));
+    }
+    if (progress) {
+        progress(cases, cases);
+    }
+    return table;
+}
+
+void LastLayerTable::save(const std::string& path) const {
+    std::vector<uint8_t> bytes(LAST_LAYER_MAGIC, LAST_LAYER_MAGIC + 8);
+    put32(bytes, static_cast<uint32_t>(tableSet));
+    put32(bytes, static_cast<uint32_t>(caseCount()));
+    for (uint32_t entry : entries) {
+        put32(bytes, entry);
+    }
+    bytes.insert(bytes.end(), caseLengths.begin(), caseLengths.end());
+    bytes.insert(bytes.end(), caseMoves.begin(), caseMoves.end());
+
+    File file(std::fopen(path.c_str(), "wb"));
+    if (!file || std::fwrite(bytes.data(), 1, bytes.size(), file.get()) != bytes.size() ||
+        std::fclose(file.release()) != 0) {
+        throw CubeException("Cannot write " + path);
+    }
+}
+
+LastLayerTable LastLayerTable::load(const std::string& path) {
+    File file(std::fopen(path.c_str(), "rb"));
+    if (!file) {
+        throw CubeException("Cannot open " + path);
+    }
+    std::vector<uint8_t> bytes;
+    uint8_t buffer[65536];
+    size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file.get())) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+
+    LastLayerTable table;
+    if (bytes.size() < LAST_LAYER_HEADER_SIZE || std::memcmp(bytes.data(), LAST_LAYER_MAGIC, 8) != 0 ||
+        get32(&bytes[8]) > static_cast<uint32_t>(LastLayerSet::ZBLL)) {
+        throw CubeException(path + " is not a last layer table");
+    }
+    table.tableSet = static_cast<LastLayerSet>(get32(&bytes[8]));
+    const uint32_t cases = get32(&bytes[12]);
+    const size_t indices = indexCount(table.tableSet);
+    if (bytes.size() != LAST_LAYER_HEADER_SIZE + indices * 4 + size_t(cases) * (1 + MAX_LAST_LAYER_MOVES)) {
+        throw CubeException(path + " has the wrong size for a " + lastLayerSetName(table.tableSet) + " table");
+    }
+    const uint8_t* in = bytes.data() + LAST_LAYER_HEADER_SIZE;
+    for (size_t i = 0; i < indices; i++, in += 4) {
+        uint32_t entry = get32(in);
+        if (entry != NO_CASE && ((entry & 0xFFFF) >= cases || entry >> 21 != 0)) {
+            throw CubeException(path + " has a corrupt index");
+        }
+        table.entries.push_back(entry);
+    }
+    table.caseLengths.assign(in, in + cases);
+    in += cases;
+    table.caseMoves.assign(in, in + size_t(cases) * MAX_LAST_LAYER_MOVES);
+    for (uint32_t i = 0; i < cases; i++) {
+        const uint8_t* moves = &table.caseMoves[size_t(i) * MAX_LAST_LAYER_MOVES];
+        if (table.caseLengths[i] > MAX_LAST_LAYER_MOVES ||
+            std::any_of(moves, moves + table.caseLengths[i], [](uint8_t m) { return m >= NUM_MOVES; })) {
+            throw CubeException(path + " has a corrupt algorithm");
+        }
+    }
+    return table;
+}
+
+int LastLayerTable::stateCount() const {
+    return static_cast<int>(std::count_if(entries.begin(), entries.end(),
+                                          [](uint32_t entry) { return entry != NO_CASE; }));
+}
+
+Solution LastLayerTable::caseAlgorithm(int i) const {
+    Solution result;
+    result.length = caseLengths[i];
+    std::copy_n(&caseMoves[size_t(i) * MAX_LAST_LAYER_MOVES], result.length, result.moves.begin());
+    return result;
+}
+
+int LastLayerTable::index(const CubieCube& cube) const {
+    return entries.empty() ? -1 : lastLayerIndex(tableSet, cube);
+}
+
+int LastLayerTable::lookup(const CubieCube& cube, Solution& out) const {
+    int i = index(cube);
+    if (i < 0 || entries[i] == NO_CASE) {
+        return -1;
+    }
+    // The case's state is mirror(U^post * cube * U^pre), so
+    // U^pre, mirror(algorithm), U^post solves cube
+    const uint32_t entry = entries[i];
+    const int caseNumber = static_cast<int>(entry & 0xFFFF);
+    const bool mirror = (entry >> 20 & 1) != 0;
+    const uint8_t* moves = &caseMoves[size_t(caseNumber) * MAX_LAST_LAYER_MOVES];
+    out.length = 0;
+    out.nodes = 0;
+    appendTurns(out, entry >> 16 & 3);
+    for (int k = 0; k < caseLengths[caseNumber]; k++) {
+        appendMove(out, mirror ? MIRROR_MOVE[moves[k]] : moves[k]);
+    }
+    if (tableSet != LastLayerSet::OLL) {
+        appendTurns(out, entry >> 18 & 3);
+    }
+    return caseNumber;
+}
+
+int LastLayerTable::lookup(const Cube& cube, Solution& out) const {
+    CubieCube cubies;
+    StateValidation validation = faceletsToCubie(cube.getFacelets(), cubies);
+    if (!validation.ok()) {
+        throw CubeException(std::string("Invalid cube: ") + validation.message());
+    }
+    return lookup(cubies, out);
+}
@@ -0,0 +1,72 @@
+#ifndef RUBIKSCUBE_LASTLAYER_H
+#define RUBIKSCUBE_LASTLAYER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "solver.h"
+
+// Algorithm tables for the last layer (U) once the first two layers are
+// solved. Every U-layer state of a set has a dense index, which is a
+// perfect hash: one probe into a flat array gives its case and the
+// pre-AUF, post-AUF and mirroring that turn it into the case's canonical
+// state. Each case holds one optimal algorithm (AUFs not counted).
+enum class LastLayerSet {
+    OLL,   // orient the last layer; 27 corner twists x 8 edge flips
+    PLL,   // permute an oriented last layer; 24 x 24 permutations
+    ZBLL   // solve a last layer whose edges are oriented; 24 x 27 x 24
+};
+
+constexpr int MAX_LAST_LAYER_MOVES = 20;
+
+struct LastLayerOptions {
+    int maxLength = 18;  // longest algorithm searched for
+    int threads = 0;     // 0 = one per hardware thread
+};
+
+class LastLayerTable {
+public:
+    LastLayerTable() = default;
+
+    // Search an optimal algorithm for every case; slow, meant to run once
+    // offline and be saved. progress, if set, is called from the calling
+    // thread with (cases done, cases). Throws CubeException if a case has
+    // no algorithm within options.maxLength.
+    static LastLayerTable generate(LastLayerSet set, const LastLayerOptions& options = LastLayerOptions(),
+                                   const std::function<void(int, int)>& progress = nullptr);
+
+    // Throws CubeException on I/O errors or a malformed file
+    void save(const std::string& path) const;
+    static LastLayerTable load(const std::string& path);
+
+    LastLayerSet set() const { return tableSet; }
+    int caseCount() const { return static_cast<int>(caseLengths.size()); }
+    int stateCount() const;  // indexed states, i.e. reachable ones
+    // Canonical algorithm of case i
+    Solution caseAlgorithm(int i) const;
+
+    // Index of the cube's last layer in this set, or -1 if the first two
+    // layers are not solved or the last layer is not in the set
+    int index(const CubieCube& cube) const;
+
+    // Algorithm, with AUFs, that takes cube to the set's goal (oriented
+    // for OLL, solved otherwise). Returns the case number, or -1 as for
+    // index(). Does not allocate.
+    int lookup(const CubieCube& cube, Solution& out) const;
+    // Throws CubeException if cube is not a reachable state
+    int lookup(const Cube& cube, Solution& out) const;
+
+private:
+    LastLayerSet tableSet = LastLayerSet::OLL;
+    // Per index: NO_CASE, or case | pre-AUF << 16 | post-AUF << 18 | mirrored << 20
+    std::vector<uint32_t> entries;
+    std::vector<uint8_t> caseLengths;
+    std::vector<uint8_t> caseMoves;  // MAX_LAST_LAYER_MOVES per case
+};
+
+const char* lastLayerSetName(LastLayerSet set);
+// false if name is not "oll", "pll" or "zbll"
+bool parseLastLayerSet(const std::string& name, LastLayerSet& set);
+
+#endif
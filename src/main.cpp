@@ -4,6 +4,13 @@
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
     MainWindow window;
+
+    // --frame-log FILE writes every frame's timings to FILE as CSV
+    const QStringList args = app.arguments();
+    int log = args.indexOf("--frame-log");
+    if (log > 0 && log + 1 < args.size() && !window.renderer()->setFrameLog(args[log + 1])) {
+        qWarning("Cannot open %s", qPrintable(args[log + 1]));
+    }
     window.show();
     return app.exec();
 } 
\ No newline at end of file
@@ -1,6 +1,14 @@
 #include "mainwindow.h"
+#include "cubegridview.h"
+#include "datasetreader.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QTextStream>
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     setWindowTitle("Rubik's Cube");
@@ -82,7 +90,7 @@ void MainWindow::createControls() {
         }
     }
     
-    // Create control buttons layout (1x2 grid)
+    // Create control buttons layout (1x3 grid)
     QGridLayout* controlButtonsLayout = new QGridLayout();
     controlButtonsLayout->setSpacing(5);
     
@@ -128,13 +136,36 @@ void MainWindow::createControls() {
     );
     connect(resetButton, &QPushButton::clicked, this, &MainWindow::handleReset);
     
+    // Create grid view button
+    QPushButton* gridButton = new QPushButton("Grid View");
+    gridButton->setFixedHeight(50);
+    gridButton->setStyleSheet(
+        "QPushButton {"
+        "   background-color: #795548;"
+        "   color: white;"
+        "   border: 2px solid #666666;"
+        "   border-radius: 5px;"
+        "   font-weight: bold;"
+        "}"
+        "QPushButton:hover {"
+        "   background-color: QLinearGradient(x1: 0, y1: 0, x2: 0, y2: 1,"
+        "                                     stop: 0 #795548, stop: 1 #666666);"
+        "}"
+        "QPushButton:pressed {"
+        "   background-color: #666666;"
+        "}"
+    );
+    connect(gridButton, &QPushButton::clicked, this, &MainWindow::handleGridView);
+    
     // Add control buttons to the grid
     controlButtonsLayout->addWidget(scrambleButton, 0, 0);
     controlButtonsLayout->addWidget(resetButton, 0, 1);
+    controlButtonsLayout->addWidget(gridButton, 0, 2);
     
     // Make control buttons take equal space
     controlButtonsLayout->setColumnStretch(0, 1);
     controlButtonsLayout->setColumnStretch(1, 1);
+    controlButtonsLayout->setColumnStretch(2, 1);
     
     // Add layouts to main container
     buttonContainer->addLayout(moveButtonLayout);
@@ -181,4 +212,58 @@ void MainWindow::handleScramble() {
 void MainWindow::handleReset() {
     cube.reset();
     cubeRenderer->update();
-} 
\ No newline at end of file
+} 
+
+// Largest batch opened in the grid view
+static const size_t MAX_GRID_CUBES = 100000;
+
+// Load a dataset file, or a text file with one 54-letter state per line
+static std::vector<Cube> loadCubes(const QString& path) {
+    std::vector<Cube> cubes;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw CubeException("Cannot open " + path.toStdString());
+    }
+    if (file.peek(sizeof(DATASET_MAGIC)) == QByteArray(DATASET_MAGIC, sizeof(DATASET_MAGIC))) {
+        file.close();
+        DatasetReader reader(path.toStdString());
+        uint64_t count = std::min<uint64_t>(reader.size(), MAX_GRID_CUBES);
+        cubes.reserve(count);
+        for (uint64_t i = 0; i < count; i++) {
+            cubes.push_back(reader.cube(i));
+        }
+        return cubes;
+    }
+    QTextStream in(&file);
+    while (!in.atEnd() && cubes.size() < MAX_GRID_CUBES) {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        Cube cube;
+        if (!cube.setState(line.section(' ', 0, 0).toStdString())) {
+            throw CubeException("Invalid state in " + path.toStdString() + ": " + line.toStdString());
+        }
+        cubes.push_back(cube);
+    }
+    return cubes;
+}
+
+void MainWindow::handleGridView() {
+    QString path = QFileDialog::getOpenFileName(this, "Open States", QString(),
+                                                "States (*.txt *.bin);;All Files (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+    try {
+        std::vector<Cube> cubes = loadCubes(path);
+        CubeGridView* grid = new CubeGridView();
+        grid->setAttribute(Qt::WA_DeleteOnClose);
+        grid->setWindowTitle(QString("%1 (%2 cubes)").arg(QFileInfo(path).fileName()).arg(cubes.size()));
+        grid->resize(1024, 768);
+        grid->setCubes(cubes);
+        grid->show();
+    } catch (const CubeException& e) {
+        QMessageBox::warning(this, "Grid View", e.what());
+    }
+}
@@ -14,10 +14,13 @@ class MainWindow : public QMainWindow {
 public:
     MainWindow(QWidget *parent = nullptr);
 
+    CubeRenderer* renderer() const { return cubeRenderer; }
+
 private slots:
     void handleTurn();
     void handleScramble();
     void handleReset();
+    void handleGridView();
 
 private:
     Cube cube;
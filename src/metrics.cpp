@@ -0,0 +1,138 @@
+#include "metrics.h"
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<metrics::ThreadCounters*> threads;
+    MetricsSnapshot retired;  // counts of threads that have exited
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry;  // outlives thread_local destructors
+    return *instance;
+}
+
+void accumulate(MetricsSnapshot& into, const metrics::ThreadCounters& from) {
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        into.counters[i] += from.counters[i].load(std::memory_order_relaxed);
+    }
+    for (int i = 0; i < METRICS_MAX_DEPTH; i++) {
+        into.nodesByDepth[i] += from.nodesByDepth[i].load(std::memory_order_relaxed);
+    }
+}
+
+struct CounterInfo {
+    const char* name;
+    const char* help;
+};
+
+const CounterInfo counterInfo[NUM_COUNTERS] = {
+    {"solves", "Solve calls"},
+    {"nodes", "Search nodes expanded"},
+    {"prune_lookups", "Pruning-table bound evaluations"},
+    {"prune_misses", "Pruning lookups that did not cut the branch"},
+    {"phase1_nanos", "Time spent in phase 1 search"},
+    {"phase2_nanos", "Time spent in phase 2 search"},
+    {"phase2_starts", "Phase 1 solutions handed to phase 2"},
+    {"facelet_moves", "Moves applied to facelet cubes"},
+    {"cubie_moves", "Moves applied to cubie cubes"},
+    {"cache_hits", "Table cache hits"},
+    {"cache_misses", "Table cache misses"}
+};
+
+double ratio(uint64_t part, uint64_t whole) {
+    return whole == 0 ? 0.0 : double(part) / double(whole);
+}
+
+} // namespace
+
+namespace metrics {
+
+ThreadCounters::ThreadCounters() {
+    for (auto& counter : counters) counter.store(0, std::memory_order_relaxed);
+    for (auto& counter : nodesByDepth) counter.store(0, std::memory_order_relaxed);
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.threads.push_back(this);
+}
+
+ThreadCounters::~ThreadCounters() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    accumulate(r.retired, *this);
+    r.threads.erase(std::remove(r.threads.begin(), r.threads.end(), this), r.threads.end());
+}
+
+MetricsSnapshot snapshot() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    MetricsSnapshot result = r.retired;
+    for (const ThreadCounters* counters : r.threads) {
+        accumulate(result, *counters);
+    }
+    return result;
+}
+
+// Counters of other threads are cleared with plain stores, so a reset that
+// races with a running solve may lose that solve's last few increments
+void reset() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.retired = MetricsSnapshot();
+    for (ThreadCounters* counters : r.threads) {
+        for (auto& counter : counters->counters) counter.store(0, std::memory_order_relaxed);
+        for (auto& counter : counters->nodesByDepth) counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace metrics
+
+std::string MetricsSnapshot::toText() const {
+    std::ostringstream out;
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        out << "# HELP cube_" << counterInfo[i].name << "_total " << counterInfo[i].help << "\n"
+            << "# TYPE cube_" << counterInfo[i].name << "_total counter\n"
+            << "cube_" << counterInfo[i].name << "_total " << counters[i] << "\n";
+    }
+    out << "# HELP cube_nodes_by_depth_total Search nodes expanded at each depth\n"
+        << "# TYPE cube_nodes_by_depth_total counter\n";
+    for (int depth = 0; depth < METRICS_MAX_DEPTH; depth++) {
+        if (nodesByDepth[depth] != 0) {
+            out << "cube_nodes_by_depth_total{depth=\"" << depth << "\"} " << nodesByDepth[depth] << "\n";
+        }
+    }
+    out << "# HELP cube_prune_miss_ratio Fraction of pruning lookups that did not cut\n"
+        << "# TYPE cube_prune_miss_ratio gauge\n"
+        << "cube_prune_miss_ratio " << ratio((*this)[Counter::PRUNE_MISSES], (*this)[Counter::PRUNE_LOOKUPS]) << "\n"
+        << "# HELP cube_cache_hit_ratio Fraction of table cache lookups that hit\n"
+        << "# TYPE cube_cache_hit_ratio gauge\n"
+        << "cube_cache_hit_ratio "
+        << ratio((*this)[Counter::CACHE_HITS], (*this)[Counter::CACHE_HITS] + (*this)[Counter::CACHE_MISSES]) << "\n";
+    return out.str();
+}
+
+std::string MetricsSnapshot::toJson() const {
+    std::ostringstream out;
+    out << "{";
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        out << "\"" << counterInfo[i].name << "\":" << counters[i] << ",";
+    }
+    out << "\"nodes_by_depth\":[";
+    int last = METRICS_MAX_DEPTH - 1;
+    while (last > 0 && nodesByDepth[last] == 0) {
+        last--;
+    }
+    for (int depth = 0; depth <= last; depth++) {
+        out << (depth > 0 ? "," : "") << nodesByDepth[depth];
+    }
+    out << "],\"prune_miss_ratio\":" << ratio((*this)[Counter::PRUNE_MISSES], (*this)[Counter::PRUNE_LOOKUPS])
+        << ",\"cache_hit_ratio\":"
+        << ratio((*this)[Counter::CACHE_HITS], (*this)[Counter::CACHE_HITS] + (*this)[Counter::CACHE_MISSES])
+        << "}";
+    return out.str();
+}
@@ -0,0 +1,103 @@
+#ifndef RUBIKSCUBE_METRICS_H
+#define RUBIKSCUBE_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Hot-path counters for the solver and move engines. Each thread bumps its
+// own counters without locked instructions; snapshot() sums every thread.
+// Build with CUBE_METRICS undefined and the CUBE_METRIC_* macros compile
+// away entirely.
+
+enum class Counter {
+    SOLVES,
+    NODES,
+    PRUNE_LOOKUPS,    // pruning-table bound evaluations
+    PRUNE_MISSES,     // lookups whose bound did not cut the branch
+    PHASE1_NANOS,
+    PHASE2_NANOS,
+    PHASE2_STARTS,    // phase 1 solutions handed to phase 2
+    FACELET_MOVES,
+    CUBIE_MOVES,
+    CACHE_HITS,
+    CACHE_MISSES,
+    COUNT
+};
+
+constexpr int NUM_COUNTERS = static_cast<int>(Counter::COUNT);
+constexpr int METRICS_MAX_DEPTH = 32;
+
+struct MetricsSnapshot {
+    std::array<uint64_t, NUM_COUNTERS> counters{};
+    std::array<uint64_t, METRICS_MAX_DEPTH> nodesByDepth{};
+
+    uint64_t operator[](Counter counter) const { return counters[static_cast<int>(counter)]; }
+
+    std::string toText() const;  // Prometheus text exposition format
+    std::string toJson() const;  // single line
+};
+
+namespace metrics {
+
+struct ThreadCounters {
+    ThreadCounters();
+    ~ThreadCounters();
+
+    // Only the owning thread writes; atomics keep snapshot() reads defined
+    std::array<std::atomic<uint64_t>, NUM_COUNTERS> counters;
+    std::array<std::atomic<uint64_t>, METRICS_MAX_DEPTH> nodesByDepth;
+};
+
+inline ThreadCounters& local() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+inline void bump(std::atomic<uint64_t>& slot, uint64_t amount) {
+    slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+inline void add(Counter counter, uint64_t amount = 1) {
+    bump(local().counters[static_cast<int>(counter)], amount);
+}
+
+inline void node(int depth) {
+    ThreadCounters& counters = local();
+    bump(counters.counters[static_cast<int>(Counter::NODES)], 1);
+    bump(counters.nodesByDepth[depth < METRICS_MAX_DEPTH ? depth : METRICS_MAX_DEPTH - 1], 1);
+}
+
+// Adds the elapsed nanoseconds to a counter when it goes out of scope
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Counter counter) : counter(counter), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        add(counter, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start).count()));
+    }
+
+private:
+    Counter counter;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Sum of all live threads plus those that have exited
+MetricsSnapshot snapshot();
+void reset();
+
+} // namespace metrics
+
+#ifdef CUBE_METRICS
+#define CUBE_METRIC_ADD(counter, amount) metrics::add(counter, amount)
+#define CUBE_METRIC_NODE(depth) metrics::node(depth)
+#define CUBE_METRIC_TIMER(name, counter) metrics::ScopedTimer name(counter)
+#else
+#define CUBE_METRIC_ADD(counter, amount) ((void)0)
+#define CUBE_METRIC_NODE(depth) ((void)(depth))
+#define CUBE_METRIC_TIMER(name, counter) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+#include "movesequence.h"
+#include "searchtables.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+constexpr int QUARTER_TURNS[3] = {1, 3, 2};    // by move % 3
+constexpr int MOVE_OF_TURNS[4] = {-1, 0, 2, 1};  // quarter turns -> move % 3
+
+// Merge move into the turn of the same face at slot; false if they cancel
+bool mergeInto(uint8_t& slot, int move) {
+    int turns = (QUARTER_TURNS[slot % 3] + QUARTER_TURNS[move % 3]) % 4;
+    if (turns == 0) {
+        return false;
+    }
+    slot = static_cast<uint8_t>(move / 3 * 3 + MOVE_OF_TURNS[turns]);
+    return true;
+}
+
+int opposite(int face) {
+    return face ^ 1;  // F/B, L/R and U/D are adjacent in Face order
+}
+
+constexpr int MOVE_BITS = 5;
+constexpr int LENGTH_BITS = 3;
+
+} // namespace
+
+// moves[0..top) is the simplified prefix, kept as a stack. Two adjacent
+// entries never share a face, and at most the top two are on one axis, so
+// each move only has to look at those two.
+int simplifyMoves(uint8_t* moves, int length) {
+    int top = 0;
+    for (int read = 0; read < length; read++) {
+        int move = moves[read];
+        int face = move / 3;
+        if (top > 0 && moves[top - 1] / 3 == face) {
+            if (!mergeInto(moves[top - 1], move)) {
+                top--;
+            }
+            continue;
+        }
+        if (top > 0 && moves[top - 1] / 3 == opposite(face)) {
+            if (top > 1 && moves[top - 2] / 3 == face) {
+                if (!mergeInto(moves[top - 2], move)) {
+                    moves[top - 2] = moves[top - 1];
+                    top--;
+                }
+                continue;
+            }
+            if (face < moves[top - 1] / 3) {
+                moves[top] = moves[top - 1];
+                moves[top - 1] = static_cast<uint8_t>(move);
+                top++;
+                continue;
+            }
+        }
+        moves[top++] = static_cast<uint8_t>(move);
+    }
+    return top;
+}
+
+bool parseMoves(const std::string& text, std::vector<uint8_t>& moves) {
+    moves.clear();
+    std::istringstream tokens(text);
+    std::string token;
+    while (tokens >> token) {
+        int move = Cube::parseMove(token);
+        if (move < 0) {
+            return false;
+        }
+        moves.push_back(static_cast<uint8_t>(move));
+    }
+    return true;
+}
+
+std::string movesToString(const uint8_t* moves, int length) {
+    std::string result;
+    for (int i = 0; i < length; i++) {
+        if (i > 0) {
+            result += ' ';
+        }
+        result += Cube::moveName(moves[i]);
+    }
+    return result;
+}
+
+SequenceOptimizer::SequenceOptimizer(int depth) : tableDepth(depth) {
+    if (depth < 1 || depth > MAX_WINDOW_DEPTH) {
+        throw CubeException("Window table depth must be 1-" + std::to_string(MAX_WINDOW_DEPTH));
+    }
+
+    // Every sequence without a redundant pair of turns, shortest first;
+    // after a stable sort the first entry of each state is optimal
+    struct Frame {
+        CubieCube cube;
+        uint32_t moves;
+        uint8_t last;
+    };
+    std::vector<Frame> frontier = {{CubieCube(), 0, NO_MOVE}};
+    entries.push_back(key(CubieCube()));
+    for (int length = 1; length <= depth; length++) {
+        std::vector<Frame> next;
+        for (const Frame& frame : frontier) {
+            for (int m = 0; m < NUM_MOVES; m++) {
+                if (!canFollow(frame.last, m)) {
+                    continue;
+                }
+                Frame child = frame;
+                child.cube.multiply(moveCube(m));
+                child.moves = ((frame.moves >> LENGTH_BITS) | static_cast<uint32_t>(m) << (MOVE_BITS * (length - 1)))
+                              << LENGTH_BITS | length;
+                child.last = static_cast<uint8_t>(m);
+                Entry entry = key(child.cube);
+                entry.moves = child.moves;
+                entries.push_back(entry);
+                if (length < depth) {
+                    next.push_back(child);
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.edges != b.edges ? a.edges < b.edges : a.corners < b.corners;
+    });
+    entries.erase(std::unique(entries.begin(), entries.end(),
+                              [](const Entry& a, const Entry& b) {
+                                  return a.edges == b.edges && a.corners == b.corners;
+                              }),
+                  entries.end());
+    entries.shrink_to_fit();
+}
+
+SequenceOptimizer::Entry SequenceOptimizer::key(const CubieCube& cube) {
+    Entry entry;
+    entry.edges = static_cast<uint64_t>(cube.edgePerm()) * NUM_FLIP + cube.flip();
+    entry.corners = static_cast<uint32_t>(cube.cornerPerm()) * NUM_TWIST + cube.twist();
+    entry.moves = 0;
+    return entry;
+}
+
+const SequenceOptimizer::Entry* SequenceOptimizer::find(const CubieCube& cube) const {
+    Entry target = key(cube);
+    auto it = std::lower_bound(entries.begin(), entries.end(), target, [](const Entry& a, const Entry& b) {
+        return a.edges != b.edges ? a.edges < b.edges : a.corners < b.corners;
+    });
+    if (it == entries.end() || it->edges != target.edges || it->corners != target.corners) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+int SequenceOptimizer::optimize(uint8_t* moves, int length, int window) const {
+    const int maxWindow = window > 0 ? window : 2 * tableDepth;
+    length = simplifyMoves(moves, length);
+    int start = 0;
+    while (start < length) {
+        // The window from start that the table shortens the most
+        CubieCube product;
+        const Entry* best = nullptr;
+        int bestWindow = 0;
+        int bestSaving = 0;
+        for (int size = 1; size <= maxWindow && start + size <= length; size++) {
+            product.multiply(moveCube(moves[start + size - 1]));
+            const Entry* entry = size > 1 ? find(product) : nullptr;
+            if (entry && size - static_cast<int>(entry->moves & ((1 << LENGTH_BITS) - 1)) > bestSaving) {
+                best = entry;
+                bestWindow = size;
+                bestSaving = size - static_cast<int>(entry->moves & ((1 << LENGTH_BITS) - 1));
+            }
+        }
+        if (!best) {
+            start++;
+            continue;
+        }
+
+        int replacement = bestWindow - bestSaving;
+        std::copy(moves + start + bestWindow, moves + length, moves + start + replacement);
+        for (int i = 0; i < replacement; i++) {
+            moves[start + i] = static_cast<uint8_t>(best->moves >> (LENGTH_BITS + MOVE_BITS * i) & 31);
+        }
+        length = simplifyMoves(moves, length - bestSaving);
+        // The new moves may open up windows that start a little earlier
+        start = std::max(0, start - maxWindow);
+    }
+    return length;
+}
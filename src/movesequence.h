@@ -0,0 +1,56 @@
+#ifndef RUBIKSCUBE_MOVESEQUENCE_H
+#define RUBIKSCUBE_MOVESEQUENCE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cubie.h"
+
+// Rewrite a move sequence in place into an equivalent one without
+// redundant turns: moves on the same face merge (R R R -> R', R R' -> ),
+// and moves on opposite faces commute so they can merge across each other
+// (R L R' -> L, U D U' -> D). Opposite-face pairs come out in the order
+// the solver uses (F B, not B F). Linear time, no allocation. Returns the
+// new length.
+int simplifyMoves(uint8_t* moves, int length);
+
+// Parse "R U2 F' ..." into move numbers; false if a token is not a move
+bool parseMoves(const std::string& text, std::vector<uint8_t>& moves);
+std::string movesToString(const uint8_t* moves, int length);
+
+constexpr int MAX_WINDOW_DEPTH = 5;
+
+// Peephole optimizer: a table of one optimal sequence for every state
+// within depth moves of solved (about 620,000 states at depth 5), and a
+// pass that replaces each window of a sequence by the table's sequence
+// for the same state when that is shorter.
+class SequenceOptimizer {
+public:
+    // Builds the table; throws CubeException unless 1 <= depth <=
+    // MAX_WINDOW_DEPTH
+    explicit SequenceOptimizer(int depth = MAX_WINDOW_DEPTH);
+
+    int depth() const { return tableDepth; }
+    size_t tableSize() const { return entries.size(); }
+
+    // Simplify, then shorten windows of up to window moves (0 = twice the
+    // depth) until none shortens further. Each replacement saves a move,
+    // so this ends after at most length rounds. Returns the new length.
+    int optimize(uint8_t* moves, int length, int window = 0) const;
+
+private:
+    struct Entry {
+        uint64_t edges;    // edge permutation * 2048 + flip
+        uint32_t corners;  // corner permutation * 2187 + twist
+        uint32_t moves;    // length, then 5 bits per move
+    };
+
+    static Entry key(const CubieCube& cube);
+    // Table entry of the state, or null if it is beyond the depth
+    const Entry* find(const CubieCube& cube) const;
+
+    int tableDepth;
+    std::vector<Entry> entries;  // sorted by state
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef RUBIKSCUBE_MOVETABLES_H
+#define RUBIKSCUBE_MOVETABLES_H
+
+#include <array>
+#include <cstdint>
+#include "cubie.h"
+
+// Every move and symmetry table of the cube models, computed at compile
+// time from the definition of the six clockwise quarter turns below and
+// stored in read-only data. The facelet and cubie engines both read these,
+// so they cannot disagree, and nothing is built at startup.
+
+// A clockwise quarter turn cycles four corners and four edges: the piece
+// in slot corners[k] moves to corners[k + 1] (and the last to the first),
+// and the piece arriving in corners[k] gains cornerTwist[k], likewise for
+// the edges
+struct FaceTurn {
+    Corner corners[4];
+    uint8_t cornerTwist[4];
+    Edge edges[4];
+    uint8_t edgeFlip[4];
+};
+
+// In Face order
+constexpr FaceTurn FACE_TURNS[6] = {
+    {{Corner::URF, Corner::DFR, Corner::DLF, Corner::UFL}, {1, 2, 1, 2},
+     {Edge::UF, Edge::FR, Edge::DF, Edge::FL}, {1, 1, 1, 1}},  // F
+    {{Corner::UBR, Corner::ULB, Corner::DBL, Corner::DRB}, {2, 1, 2, 1},
+     {Edge::UB, Edge::BL, Edge::DB, Edge::BR}, {1, 1, 1, 1}},  // B
+    {{Corner::UFL, Corner::DLF, Corner::DBL, Corner::ULB}, {1, 2, 1, 2},
+     {Edge::UL, Edge::FL, Edge::DL, Edge::BL}, {0, 0, 0, 0}},  // L
+    {{Corner::URF, Corner::UBR, Corner::DRB, Corner::DFR}, {2, 1, 2, 1},
+     {Edge::UR, Edge::BR, Edge::DR, Edge::FR}, {0, 0, 0, 0}},  // R
+    {{Corner::URF, Corner::UFL, Corner::ULB, Corner::UBR}, {0, 0, 0, 0},
+     {Edge::UR, Edge::UF, Edge::UL, Edge::UB}, {0, 0, 0, 0}},  // U
+    {{Corner::DFR, Corner::DRB, Corner::DBL, Corner::DLF}, {0, 0, 0, 0},
+     {Edge::DR, Edge::DB, Edge::DL, Edge::DF}, {0, 0, 0, 0}}   // D
+};
+
+namespace movetables {
+
+constexpr CubieCube quarterTurn(const FaceTurn& turn) {
+    CubieCube cube;
+    for (int k = 0; k < 4; k++) {
+        int to = static_cast<int>(turn.corners[(k + 1) % 4]);
+        cube.cp[to] = static_cast<uint8_t>(turn.corners[k]);
+        cube.co[to] = turn.cornerTwist[(k + 1) % 4];
+        to = static_cast<int>(turn.edges[(k + 1) % 4]);
+        cube.ep[to] = static_cast<uint8_t>(turn.edges[k]);
+        cube.eo[to] = turn.edgeFlip[(k + 1) % 4];
+    }
+    return cube;
+}
+
+constexpr std::array<CubieCube, NUM_MOVES> buildMoveCubes() {
+    std::array<CubieCube, NUM_MOVES> moves{};
+    for (int face = 0; face < 6; face++) {
+        const CubieCube quarter = quarterTurn(FACE_TURNS[face]);
+        CubieCube power = quarter;
+        for (int turns = 1; turns <= 3; turns++) {
+            moves[face * 3 + (turns == 1 ? 0 : turns == 2 ? 2 : 1)] = power;
+            power.multiply(quarter);
+        }
+    }
+    return moves;
+}
+
+} // namespace movetables
+
+// Cubie effect of each move, numbered as in Cube::applyMove()
+inline constexpr std::array<CubieCube, NUM_MOVES> MOVE_CUBES = movetables::buildMoveCubes();
+
+// FACELET_MOVES[m][i] is the facelet whose sticker move m carries to
+// facelet i, so applying m is one gather over the 54 facelets
+using FaceletPermutation = std::array<uint8_t, 54>;
+
+namespace movetables {
+
+// Facelet form of a cubie state, as cubieToFacelets() paints it
+constexpr FaceletPermutation faceletPermutation(const CubieCube& cube) {
+    FaceletPermutation perm{};
+    for (int i = 0; i < 54; i++) {
+        perm[i] = static_cast<uint8_t>(i);  // centres stay put
+    }
+    for (int i = 0; i < NUM_CORNERS; i++) {
+        for (int n = 0; n < 3; n++) {
+            perm[cornerFacelet[i][(n + cube.co[i]) % 3]] = static_cast<uint8_t>(cornerFacelet[cube.cp[i]][n]);
+        }
+    }
+    for (int i = 0; i < NUM_EDGES; i++) {
+        for (int n = 0; n < 2; n++) {
+            perm[edgeFacelet[i][(n + cube.eo[i]) % 2]] = static_cast<uint8_t>(edgeFacelet[cube.ep[i]][n]);
+        }
+    }
+    return perm;
+}
+
+constexpr std::array<FaceletPermutation, NUM_MOVES> buildFaceletMoves() {
+    std::array<FaceletPermutation, NUM_MOVES> moves{};
+    for (int m = 0; m < NUM_MOVES; m++) {
+        moves[m] = faceletPermutation(MOVE_CUBES[m]);
+    }
+    return moves;
+}
+
+} // namespace movetables
+
+inline constexpr std::array<FaceletPermutation, NUM_MOVES> FACELET_MOVES = movetables::buildFaceletMoves();
+
+// A piece coordinate is slot * 3 + twist for a corner and slot * 2 + flip
+// for an edge, 0-23 either way. CORNER_COORD_MOVE[c][m] and
+// EDGE_COORD_MOVE[c][m] are the coordinate after move m.
+constexpr int NUM_PIECE_COORDS = 24;
+
+namespace movetables {
+
+constexpr std::array<std::array<uint8_t, NUM_MOVES>, NUM_PIECE_COORDS> buildCornerCoordMoves() {
+    std::array<std::array<uint8_t, NUM_MOVES>, NUM_PIECE_COORDS> table{};
+    for (int m = 0; m < NUM_MOVES; m++) {
+        // Slot i receives the piece that was in slot cp[i]
+        for (int i = 0; i < NUM_CORNERS; i++) {
+            for (int twist = 0; twist < 3; twist++) {
+                table[MOVE_CUBES[m].cp[i] * 3 + twist][m] =
+                    static_cast<uint8_t>(i * 3 + (twist + MOVE_CUBES[m].co[i]) % 3);
+            }
+        }
+    }
+    return table;
+}
+
+constexpr std::array<std::array<uint8_t, NUM_MOVES>, NUM_PIECE_COORDS> buildEdgeCoordMoves() {
+    std::array<std::array<uint8_t, NUM_MOVES>, NUM_PIECE_COORDS> table{};
+    for (int m = 0; m < NUM_MOVES; m++) {
+        for (int i = 0; i < NUM_EDGES; i++) {
+            for (int flip = 0; flip < 2; flip++) {
+                table[MOVE_CUBES[m].ep[i] * 2 + flip][m] =
+                    static_cast<uint8_t>(i * 2 + (flip + MOVE_CUBES[m].eo[i]) % 2);
+            }
+        }
+    }
+    return table;
+}
+
+} // namespace movetables
+
+inline constexpr std::array<std::array<uint8_t, NUM_MOVES>, NUM_PIECE_COORDS> CORNER_COORD_MOVE =
+    movetables::buildCornerCoordMoves();
+inline constexpr std::array<std::array<uint8_t, NUM_MOVES>, NUM_PIECE_COORDS> EDGE_COORD_MOVE =
+    movetables::buildEdgeCoordMoves();
+
+// Reflection through the plane between L and R. It swaps the L and R
+// faces and mirrors every face left to right.
+constexpr int mirrorFacelet(int facelet) {
+    int face = facelet / 9;
+    if (face == static_cast<int>(Face::LEFT) || face == static_cast<int>(Face::RIGHT)) {
+        face ^= 1;
+    }
+    return face * 9 + facelet % 9 / 3 * 3 + 2 - facelet % 3;
+}
+
+namespace movetables {
+
+// The slot whose facelets are the mirror images of slot's
+template <int N, int S>
+constexpr uint8_t mirrorSlot(const int (&facelets)[N][S], int slot) {
+    for (int other = 0; other < N; other++) {
+        int matched = 0;
+        for (int a = 0; a < S; a++) {
+            for (int b = 0; b < S; b++) {
+                matched += mirrorFacelet(facelets[slot][a]) == facelets[other][b];
+            }
+        }
+        if (matched == S) {
+            return static_cast<uint8_t>(other);
+        }
+    }
+    return 0xFF;
+}
+
+template <int N, int S>
+constexpr std::array<uint8_t, N> buildMirrorSlots(const int (&facelets)[N][S]) {
+    std::array<uint8_t, N> slots{};
+    for (int i = 0; i < N; i++) {
+        slots[i] = mirrorSlot(facelets, i);
+    }
+    return slots;
+}
+
+// The move whose facelet permutation is the mirror image of move's
+constexpr std::array<uint8_t, NUM_MOVES> buildMirrorMoves() {
+    std::array<uint8_t, NUM_MOVES> mirrored{};
+    for (int m = 0; m < NUM_MOVES; m++) {
+        for (int candidate = 0; candidate < NUM_MOVES; candidate++) {
+            bool same = true;
+            for (int i = 0; i < 54; i++) {
+                same = same && FACELET_MOVES[candidate][i] == mirrorFacelet(FACELET_MOVES[m][mirrorFacelet(i)]);
+            }
+            if (same) {
+                mirrored[m] = static_cast<uint8_t>(candidate);
+            }
+        }
+    }
+    return mirrored;
+}
+
+// A clockwise turn carries each sticker of the turning face a quarter
+// turn around its centre
+constexpr bool turnsFacesClockwise() {
+    constexpr int source[9] = {6, 3, 0, 7, 4, 1, 8, 5, 2};
+    for (int face = 0; face < 6; face++) {
+        for (int k = 0; k < 9; k++) {
+            if (FACELET_MOVES[face * 3][face * 9 + k] != face * 9 + source[k]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace movetables
+
+static_assert(movetables::turnsFacesClockwise(), "FACE_TURNS must describe clockwise turns");
+
+// Slot images under the mirror: corners and edges keep their U/D (or F/B)
+// sticker, and corner twists change direction
+inline constexpr std::array<uint8_t, NUM_CORNERS> MIRROR_CORNER = movetables::buildMirrorSlots(cornerFacelet);
+inline constexpr std::array<uint8_t, NUM_EDGES> MIRROR_EDGE = movetables::buildMirrorSlots(edgeFacelet);
+
+// The mirror image of each move: L and R swap, and every quarter turn
+// changes direction
+inline constexpr std::array<uint8_t, NUM_MOVES> MIRROR_MOVE = movetables::buildMirrorMoves();
+
+#endif
@@ -0,0 +1,446 @@
+#include "patternsearch.h"
+#include "metrics.h"
+#include "movetables.h"
+#include "searchtables.h"
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+// Colour letters of Cube::getState(), indexed by Color
+constexpr char COLOR_LETTERS[6] = {'G', 'B', 'O', 'R', 'W', 'Y'};
+constexpr char ANY_LETTER = '.';
+
+// Every slot and orientation of a piece, for corners and edges alike
+constexpr uint32_t ALL_COORDS = (1u << NUM_PIECE_COORDS) - 1;
+constexpr int MAX_GROUP_SIZE = 4;
+
+// Patterns searched at most this many at a time keep their tables cached;
+// each takes up to a few megabytes
+constexpr size_t PATTERN_CACHE_SIZE = 32;
+
+Cube applied(const char* moves) {
+    Cube cube;
+    std::istringstream tokens(moves);
+    std::string token;
+    while (tokens >> token) {
+        cube.applyMove(Cube::parseMove(token));
+    }
+    return cube;
+}
+
+// Whether piece, at the slot and twist or flip of coord, shows the
+// pattern's colours on every facelet the pattern cares about
+template <int S>
+bool fits(const Pattern& pattern, const int (*facelets)[S], int piece, int coord) {
+    int slot = coord / S;
+    int orientation = coord % S;
+    for (int n = 0; n < S; n++) {
+        int want = pattern.colors[facelets[slot][(n + orientation) % S]];
+        if (want != Pattern::ANY && want != facelets[piece][n] / 9) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <int S>
+uint32_t fittingCoords(const Pattern& pattern, const int (*facelets)[S], int numSlots, int piece) {
+    uint32_t coords = 0;
+    for (int coord = 0; coord < numSlots * S; coord++) {
+        if (fits(pattern, facelets, piece, coord)) {
+            coords |= 1u << coord;
+        }
+    }
+    return coords;
+}
+
+} // namespace
+
+// A group's coordinate is its pieces' coordinates as base-24 digits, the
+// first piece most significant
+struct PatternGroup {
+    int first;  // offset of the first piece in the search coordinates
+    int size;
+    bool edges;
+    std::vector<uint8_t> prune;
+};
+
+// The pieces a pattern constrains, corners first, and the pruning tables
+// of their groups. Together the groups cover every constrained piece, so
+// a state matches the pattern exactly when every table reads zero.
+struct PatternTables {
+    Pattern pattern;
+    std::array<int8_t, NUM_CORNERS> cornerIndex;  // search coordinate of each piece, or -1
+    std::array<int8_t, NUM_EDGES> edgeIndex;
+    int numPieces = 0;
+    int numCorners = 0;
+    std::vector<PatternGroup> groups;
+    // A pattern without ANY is one state, reached by solving target^-1 *
+    // state with the two-phase solver instead of through the groups
+    bool fullState = false;
+    CubieCube targetInverse;
+};
+
+namespace {
+
+// Every tuple of fitting coordinates of the group's pieces with each piece
+// in its own slot
+void addRoots(const std::vector<uint32_t>& fitting, int slotSize, int piece, uint32_t index, uint32_t usedSlots,
+              std::vector<uint32_t>& roots) {
+    if (piece == static_cast<int>(fitting.size())) {
+        roots.push_back(index);
+        return;
+    }
+    for (int coord = 0; coord < NUM_PIECE_COORDS; coord++) {
+        uint32_t slot = 1u << (coord / slotSize);
+        if ((fitting[piece] >> coord & 1) && !(usedSlots & slot)) {
+            addRoots(fitting, slotSize, piece + 1, index * NUM_PIECE_COORDS + coord, usedSlots | slot, roots);
+        }
+    }
+}
+
+void buildGroup(PatternGroup& group, const std::vector<uint32_t>& fitting) {
+    std::vector<uint32_t> roots;
+    addRoots(fitting, group.edges ? 2 : 3, 0, 0, 0, roots);
+    if (roots.empty()) {
+        throw CubeException("No state matches the pattern: its pieces cannot all be placed");
+    }
+
+    static const int moves[NUM_MOVES] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17};
+    const auto* coordMove = group.edges ? &EDGE_COORD_MOVE : &CORNER_COORD_MOVE;
+    uint32_t size = 1;
+    for (int k = 0; k < group.size; k++) {
+        size *= NUM_PIECE_COORDS;
+    }
+    buildPruneTable(group.prune, size, moves, NUM_MOVES,
+                    [=](uint32_t index, int m) {
+                        uint32_t result = 0;
+                        for (uint32_t scale = size / NUM_PIECE_COORDS; scale > 0; scale /= NUM_PIECE_COORDS) {
+                            result += (*coordMove)[index / scale % NUM_PIECE_COORDS][m] * scale;
+                        }
+                        return result;
+                    },
+                    roots);
+}
+
+std::shared_ptr<const PatternTables> buildTables(const Pattern& pattern) {
+    auto tables = std::make_shared<PatternTables>();
+    tables->pattern = pattern;
+    tables->cornerIndex.fill(-1);
+    tables->edgeIndex.fill(-1);
+
+    if (std::find(pattern.colors.begin(), pattern.colors.end(), Pattern::ANY) == pattern.colors.end()) {
+        Cube::Facelets facelets;
+        for (int i = 0; i < 54; i++) {
+            facelets[i / 9][i % 9] = static_cast<Color>(pattern.colors[i]);
+        }
+        CubieCube target;
+        StateValidation validation = faceletsToCubie(facelets, target);
+        if (!validation.ok()) {
+            throw CubeException(std::string("No state matches the pattern: ") + validation.message());
+        }
+        tables->fullState = true;
+        tables->targetInverse = target.inverse();
+        return tables;
+    }
+
+    std::vector<uint32_t> cornerFits;
+    for (int piece = 0; piece < NUM_CORNERS; piece++) {
+        uint32_t fitting = fittingCoords(pattern, cornerFacelet, NUM_CORNERS, piece);
+        if (fitting == 0) {
+            throw CubeException("No state matches the pattern: no corner fits some slot");
+        }
+        if (fitting != ALL_COORDS) {
+            tables->cornerIndex[piece] = static_cast<int8_t>(tables->numPieces++);
+            cornerFits.push_back(fitting);
+        }
+    }
+    tables->numCorners = tables->numPieces;
+    std::vector<uint32_t> edgeFits;
+    for (int piece = 0; piece < NUM_EDGES; piece++) {
+        uint32_t fitting = fittingCoords(pattern, edgeFacelet, NUM_EDGES, piece);
+        if (fitting == 0) {
+            throw CubeException("No state matches the pattern: no edge fits some slot");
+        }
+        if (fitting != ALL_COORDS) {
+            tables->edgeIndex[piece] = static_cast<int8_t>(tables->numPieces++);
+            edgeFits.push_back(fitting);
+        }
+    }
+
+    for (int edges = 0; edges < 2; edges++) {
+        const std::vector<uint32_t>& fits = edges ? edgeFits : cornerFits;
+        for (size_t first = 0; first < fits.size(); first += MAX_GROUP_SIZE) {
+            PatternGroup group;
+            group.first = static_cast<int>(first) + (edges ? tables->numCorners : 0);
+            group.size = static_cast<int>(std::min<size_t>(MAX_GROUP_SIZE, fits.size() - first));
+            group.edges = edges != 0;
+            buildGroup(group, std::vector<uint32_t>(fits.begin() + first, fits.begin() + first + group.size));
+            tables->groups.push_back(std::move(group));
+        }
+    }
+    return tables;
+}
+
+struct CacheEntry {
+    std::shared_ptr<const PatternTables> tables;
+    uint64_t lastUse;
+};
+
+// Built under the lock, so threads asking for the same new pattern build
+// its tables once
+std::shared_ptr<const PatternTables> cachedTables(const Pattern& pattern) {
+    static std::mutex mutex;
+    static std::unordered_map<uint64_t, CacheEntry> entries;
+    static uint64_t clock = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const uint64_t hash = pattern.hash();
+    auto it = entries.find(hash);
+    if (it != entries.end() && it->second.tables->pattern == pattern) {
+        CUBE_METRIC_ADD(Counter::CACHE_HITS, 1);
+        it->second.lastUse = ++clock;
+        return it->second.tables;
+    }
+    CUBE_METRIC_ADD(Counter::CACHE_MISSES, 1);
+    std::shared_ptr<const PatternTables> tables = buildTables(pattern);
+    if (it != entries.end()) {
+        it->second = {tables, ++clock};  // a hash collision; the newer pattern wins
+        return tables;
+    }
+    if (entries.size() >= PATTERN_CACHE_SIZE) {
+        entries.erase(std::min_element(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+            return a.second.lastUse < b.second.lastUse;
+        }));
+    }
+    entries.emplace(hash, CacheEntry{tables, ++clock});
+    return tables;
+}
+
+} // namespace
+
+Pattern::Pattern() {
+    colors.fill(ANY);
+}
+
+Pattern Pattern::parse(const std::string& text) {
+    if (text.size() != 54) {
+        throw CubeException("A pattern must have exactly 54 facelets");
+    }
+    Pattern pattern;
+    for (int i = 0; i < 54; i++) {
+        if (text[i] == ANY_LETTER) {
+            continue;
+        }
+        const char* letter = std::find(COLOR_LETTERS, COLOR_LETTERS + 6, text[i]);
+        if (letter == COLOR_LETTERS + 6) {
+            throw CubeException(std::string("Unknown pattern colour '") + text[i] + "'");
+        }
+        pattern.colors[i] = static_cast<int8_t>(letter - COLOR_LETTERS);
+    }
+    for (int face = 0; face < 6; face++) {
+        int center = pattern.colors[face * 9 + 4];
+        if (center != ANY && center != face) {
+            throw CubeException("Pattern centres do not match the colour scheme");
+        }
+    }
+    return pattern;
+}
+
+Pattern Pattern::of(const Cube& cube) {
+    Pattern pattern;
+    for (int i = 0; i < 54; i++) {
+        pattern.colors[i] = static_cast<int8_t>(cube.getFacelets()[i / 9][i % 9]);
+    }
+    return pattern;
+}
+
+Pattern Pattern::named(const std::string& name) {
+    if (name == "solved") {
+        return of(Cube());
+    }
+    if (name == "checkerboard") {
+        return of(applied("U2 D2 F2 B2 L2 R2"));
+    }
+    if (name == "superflip") {
+        return of(applied("U R2 F B R B2 R U2 L B2 R U' D' R2 F R' L B2 U2 F2"));
+    }
+    if (name == "cross") {
+        Pattern pattern;
+        for (int face = 0; face < 6; face++) {
+            pattern.colors[face * 9 + 4] = static_cast<int8_t>(face);
+        }
+        for (int edge = static_cast<int>(Edge::DR); edge <= static_cast<int>(Edge::DB); edge++) {
+            for (int facelet : edgeFacelet[edge]) {
+                pattern.colors[facelet] = static_cast<int8_t>(facelet / 9);
+            }
+        }
+        return pattern;
+    }
+    return parse(name);
+}
+
+std::string Pattern::toString() const {
+    std::string text(54, ANY_LETTER);
+    for (int i = 0; i < 54; i++) {
+        if (colors[i] != ANY) {
+            text[i] = COLOR_LETTERS[colors[i]];
+        }
+    }
+    return text;
+}
+
+// FNV-1a over the colours, don't cares included
+uint64_t Pattern::hash() const {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int8_t color : colors) {
+        hash = (hash ^ static_cast<uint8_t>(color)) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool Pattern::matches(const Cube::Facelets& facelets) const {
+    for (int i = 0; i < 54; i++) {
+        if (colors[i] != ANY && colors[i] != static_cast<int>(facelets[i / 9][i % 9])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+PatternSearch::PatternSearch(const Pattern& target)
+    : tables(cachedTables(target))
+    , stack()
+    , path()
+    , solutions(nullptr)
+    , maxSolutions(0)
+    , maxNodes(0)
+    , nodeCount(0)
+    , aborted(false)
+{
+    if (tables->fullState) {
+        solver.reset(new Solver);
+    }
+}
+
+const Pattern& PatternSearch::target() const {
+    return tables->pattern;
+}
+
+bool PatternSearch::search(const Cube& cube, const PatternSearchOptions& options, std::vector<Solution>& out) {
+    CubieCube cubies;
+    StateValidation validation = faceletsToCubie(cube.getFacelets(), cubies);
+    if (!validation.ok()) {
+        throw CubeException(std::string("Cannot search: ") + validation.message());
+    }
+    return search(cubies, options, out);
+}
+
+bool PatternSearch::search(const CubieCube& cube, const PatternSearchOptions& options, std::vector<Solution>& out) {
+    out.clear();
+    if (tables->fullState) {
+        // cube * moves = target exactly when target^-1 * cube * moves is solved
+        CubieCube relative = tables->targetInverse;
+        relative.multiply(cube);
+        SolveOptions solveOptions;
+        solveOptions.maxLength = std::min(options.maxLength, MAX_SOLUTION_LENGTH);
+        solveOptions.maxNodes = options.maxNodes;
+        Solution solution;
+        bool found = solver->solve(relative, solveOptions, solution);
+        nodeCount = solution.nodes;
+        aborted = !found && options.maxNodes != 0 && nodeCount >= options.maxNodes;
+        if (found) {
+            out.push_back(solution);
+        }
+        return found;
+    }
+
+    uint8_t* root = stack[0].data();
+    for (int i = 0; i < NUM_CORNERS; i++) {
+        int index = tables->cornerIndex[cube.cp[i]];
+        if (index >= 0) {
+            root[index] = static_cast<uint8_t>(i * 3 + cube.co[i]);
+        }
+    }
+    for (int i = 0; i < NUM_EDGES; i++) {
+        int index = tables->edgeIndex[cube.ep[i]];
+        if (index >= 0) {
+            root[index] = static_cast<uint8_t>(i * 2 + cube.eo[i]);
+        }
+    }
+
+    solutions = &out;
+    maxSolutions = std::max(1, options.maxSolutions);
+    maxNodes = options.maxNodes;
+    nodeCount = 0;
+    aborted = false;
+    const int maxLength = std::min(options.maxLength, MAX_SOLUTION_LENGTH);
+    for (int depth = bound(root); depth <= maxLength && out.empty() && !aborted; depth++) {
+        searchDepth(0, depth, NO_MOVE);
+    }
+    solutions = nullptr;
+    return !out.empty();
+}
+
+int PatternSearch::bound(const uint8_t* coords) const {
+    int result = 0;
+    for (const PatternGroup& group : tables->groups) {
+        uint32_t index = 0;
+        for (int k = 0; k < group.size; k++) {
+            index = index * NUM_PIECE_COORDS + coords[group.first + k];
+        }
+        result = std::max<int>(result, group.prune[index]);
+    }
+    return result;
+}
+
+// Collects every sequence of exactly togo more moves that ends on the
+// pattern; true once there are enough
+bool PatternSearch::searchDepth(int depth, int togo, uint8_t previous) {
+    if (togo == 0) {
+        Solution solution;
+        solution.length = depth;
+        std::copy(path.begin(), path.begin() + depth, solution.moves.begin());
+        solution.nodes = nodeCount;
+        solutions->push_back(solution);
+        return static_cast<int>(solutions->size()) >= maxSolutions;
+    }
+
+    const uint8_t* coords = stack[depth].data();
+    uint8_t* child = stack[depth + 1].data();
+    const int numCorners = tables->numCorners;
+    const int numPieces = tables->numPieces;
+    for (int m = 0; m < NUM_MOVES; m++) {
+        if (!canFollow(previous, m)) {
+            continue;
+        }
+        CUBE_METRIC_NODE(depth + 1);
+        if (maxNodes != 0 && nodeCount >= maxNodes) {
+            aborted = true;
+            return false;
+        }
+        nodeCount++;
+        for (int k = 0; k < numCorners; k++) {
+            child[k] = CORNER_COORD_MOVE[coords[k]][m];
+        }
+        for (int k = numCorners; k < numPieces; k++) {
+            child[k] = EDGE_COORD_MOVE[coords[k]][m];
+        }
+        CUBE_METRIC_ADD(Counter::PRUNE_LOOKUPS, 1);
+        if (bound(child) >= togo) {
+            continue;
+        }
+        CUBE_METRIC_ADD(Counter::PRUNE_MISSES, 1);
+        path[depth] = static_cast<uint8_t>(m);
+        if (searchDepth(depth + 1, togo - 1, static_cast<uint8_t>(m))) {
+            return true;
+        }
+        if (aborted) {
+            return false;
+        }
+    }
+    return false;
+}
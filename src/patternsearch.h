@@ -0,0 +1,95 @@
+#ifndef RUBIKSCUBE_PATTERNSEARCH_H
+#define RUBIKSCUBE_PATTERNSEARCH_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "solver.h"
+
+// A target for pattern search: a colour for each of the 54 facelets, or
+// ANY where any colour will do. A full state (checkerboard, superflip) is
+// a pattern without ANY; "cross solved" cares only about a few stickers.
+struct Pattern {
+    static constexpr int8_t ANY = -1;
+
+    std::array<int8_t, 54> colors;  // Color values, or ANY
+
+    Pattern();  // every facelet ANY
+
+    // State-string form: colour letters as in Cube::getState(), with '.'
+    // for don't care. Throws CubeException on a bad length or letter, or
+    // centres that are neither '.' nor in the fixed colour scheme.
+    static Pattern parse(const std::string& text);
+    // Every facelet as on cube
+    static Pattern of(const Cube& cube);
+    // "solved", "checkerboard", "superflip", "cross" (the D cross), or a
+    // state string as for parse(). The first three are full states, which
+    // PatternSearch reaches with the two-phase solver rather than optimally.
+    static Pattern named(const std::string& name);
+
+    std::string toString() const;
+    uint64_t hash() const;
+    bool matches(const Cube::Facelets& facelets) const;
+
+    bool operator==(const Pattern& other) const { return colors == other.colors; }
+};
+
+struct PatternSearchOptions {
+    int maxLength = 20;
+    uint64_t maxNodes = 0;  // give up after this many nodes, 0 = no limit
+    int maxSolutions = 1;   // how many of the shortest sequences to return
+};
+
+struct PatternTables;
+
+// Optimal search towards a partial pattern. Every piece that the pattern
+// constrains may sit only in some slots, in some orientations; the
+// pruning tables are breadth-first distances to those for groups of up to
+// four such pieces. Tables are built on first use and cached by pattern
+// hash for the life of the process, so later searches with the same
+// pattern, from any thread, reuse them. Use one PatternSearch per thread.
+//
+// These tables are too weak for a full-state target (no ANY) more than
+// about 12 moves away, so such a target is reached by solving
+// target^-1 * cube with the two-phase Solver instead: one sequence, usually
+// within a move or two of the shortest but not proven so.
+class PatternSearch {
+public:
+    // Throws CubeException if no reachable state matches the pattern's
+    // pieces one by one
+    explicit PatternSearch(const Pattern& target);
+
+    const Pattern& target() const;
+
+    // Shortest move sequences that take cube to a state matching the
+    // target, all of the same length, at most options.maxSolutions of
+    // them (one for a full-state target). False if there is none within
+    // maxLength moves, or maxNodes ran out first (see wasAborted()); out
+    // then holds what was found.
+    bool search(const CubieCube& cube, const PatternSearchOptions& options, std::vector<Solution>& out);
+    // Throws CubeException if the cube is not in a reachable state
+    bool search(const Cube& cube, const PatternSearchOptions& options, std::vector<Solution>& out);
+
+    uint64_t nodes() const { return nodeCount; }
+    // Whether the last search stopped because maxNodes ran out
+    bool wasAborted() const { return aborted; }
+
+private:
+    bool searchDepth(int depth, int togo, uint8_t previous);
+    int bound(const uint8_t* coords) const;
+
+    std::shared_ptr<const PatternTables> tables;
+    std::unique_ptr<Solver> solver;  // full-state targets only
+    // Coordinates of the constrained pieces at each depth of the search
+    std::array<std::array<uint8_t, NUM_CORNERS + NUM_EDGES>, MAX_SOLUTION_LENGTH + 1> stack;
+    std::array<uint8_t, MAX_SOLUTION_LENGTH> path;
+    std::vector<Solution>* solutions;
+    int maxSolutions;
+    uint64_t maxNodes;
+    uint64_t nodeCount;
+    bool aborted;
+};
+
+#endif
@@ -0,0 +1,449 @@
+#include "photoimport.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+// Colour letters of Cube::getState(), indexed by Color
+const char COLOR_LETTERS[6] = {'G', 'B', 'O', 'R', 'W', 'Y'};
+
+constexpr int WORK_SIZE = 160;           // long side of the image the grid is fitted to
+constexpr float MIN_GRID_SCORE = 0.15f;  // a weaker grid flags its face
+constexpr float MAX_SPREAD = 0.3f;       // a noisier sticker flags its face
+constexpr float LIGHTNESS_WEIGHT = 0.5f;
+
+// Box-filtered planar copy of a photo: the grid search and sampling then
+// run over short contiguous float rows, whatever the photo's size
+struct Planes {
+    int width = 0;
+    int height = 0;
+    std::vector<float> r;
+    std::vector<float> g;
+    std::vector<float> b;
+};
+
+Planes downsample(const RgbImage& image) {
+    const int factor = std::max(1, (std::max(image.width, image.height) + WORK_SIZE - 1) / WORK_SIZE);
+    Planes planes;
+    planes.width = std::max(1, image.width / factor);
+    planes.height = std::max(1, image.height / factor);
+    const size_t size = size_t(planes.width) * planes.height;
+    planes.r.assign(size, 0.0f);
+    planes.g.assign(size, 0.0f);
+    planes.b.assign(size, 0.0f);
+    const int boxWidth = std::min(factor, image.width);
+    const int boxHeight = std::min(factor, image.height);
+    const float scale = 1.0f / float(boxWidth * boxHeight);
+    for (int y = 0; y < planes.height; y++) {
+        float* r = &planes.r[size_t(y) * planes.width];
+        float* g = &planes.g[size_t(y) * planes.width];
+        float* b = &planes.b[size_t(y) * planes.width];
+        for (int dy = 0; dy < boxHeight; dy++) {
+            const uint8_t* in = image.rgb.data() + (size_t(y) * factor + dy) * image.width * 3;
+            for (int x = 0; x < planes.width; x++) {
+                const uint8_t* p = in + size_t(x) * factor * 3;
+                uint32_t sumR = 0;
+                uint32_t sumG = 0;
+                uint32_t sumB = 0;
+                for (int k = 0; k < boxWidth; k++) {
+                    sumR += p[3 * k];
+                    sumG += p[3 * k + 1];
+                    sumB += p[3 * k + 2];
+                }
+                r[x] += float(sumR);
+                g[x] += float(sumG);
+                b[x] += float(sumB);
+            }
+        }
+        for (int x = 0; x < planes.width; x++) {
+            r[x] *= scale;
+            g[x] *= scale;
+            b[x] *= scale;
+        }
+    }
+    return planes;
+}
+
+// Brightness of each pixel relative to the brightest tenth of the photo,
+// capped at 1
+std::vector<float> relativeBrightness(const Planes& planes) {
+    const size_t size = planes.r.size();
+    std::vector<float> value(size);
+    for (size_t i = 0; i < size; i++) {
+        value[i] = std::max(planes.r[i], std::max(planes.g[i], planes.b[i]));
+    }
+    std::vector<float> sorted = value;
+    auto top = sorted.begin() + static_cast<std::ptrdiff_t>(size * 9 / 10);
+    std::nth_element(sorted.begin(), top, sorted.end());
+    const float scale = 1.0f / std::max(*top, 1.0f);
+    for (float& v : value) {
+        v = std::min(1.0f, v * scale);
+    }
+    return value;
+}
+
+// How much darker each pixel is than both its neighbours a few pixels away
+// along one axis: high on the black lines between stickers whatever the
+// colours either side, and near 0 on flat stickers, flat background and
+// plain edges. Unlike brightness itself,
+// this cannot be matched by a background as bright as the stickers.
+std::vector<float> valleys(const std::vector<float>& value, int width, int height, bool alongX) {
+    std::vector<float> out(value.size(), 0.0f);
+    const int length = alongX ? width : height;
+    const size_t step = alongX ? 1 : size_t(width);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const int at = alongX ? x : y;
+            const size_t i = size_t(y) * width + x;
+            float depth = 0.0f;
+            for (int d = 2; d <= 5; d++) {
+                // At the photo's edges, the one neighbour inside it, so a
+                // face cut off right after its outer line still has it
+                float before = at - d >= 0 ? value[i - d * step] : 1.0f;
+                float after = at + d < length ? value[i + d * step] : 1.0f;
+                depth = std::max(depth, std::min(before, after) - value[i]);
+            }
+            out[i] = depth;
+        }
+    }
+    return out;
+}
+
+// Mean of each column over rows [y0, y1)
+std::vector<float> columnProfile(const std::vector<float>& plane, int width, int y0, int y1) {
+    std::vector<float> profile(width, 0.0f);
+    for (int y = y0; y < y1; y++) {
+        const float* row = &plane[size_t(y) * width];
+        for (int x = 0; x < width; x++) {
+            profile[x] += row[x];
+        }
+    }
+    for (float& value : profile) {
+        value /= float(std::max(1, y1 - y0));
+    }
+    return profile;
+}
+
+// Mean of each row over columns [x0, x1)
+std::vector<float> rowProfile(const std::vector<float>& plane, int width, int height, int x0, int x1) {
+    std::vector<float> profile(height, 0.0f);
+    for (int y = 0; y < height; y++) {
+        const float* row = &plane[size_t(y) * width];
+        float sum = 0.0f;
+        for (int x = x0; x < x1; x++) {
+            sum += row[x];
+        }
+        profile[y] = sum / float(std::max(1, x1 - x0));
+    }
+    return profile;
+}
+
+struct GridFit {
+    int start = 0;
+    int size = 0;
+    float score = -1.0f;
+};
+
+// Mean of a profile over [from, to) from its prefix sums, counting
+// anything beyond the photo's edges as 0
+float meanOver(const std::vector<double>& prefix, double from, double to) {
+    const int n = static_cast<int>(prefix.size()) - 1;
+    int a = static_cast<int>(std::lround(from));
+    int b = std::max(a + 1, static_cast<int>(std::lround(to)));
+    double sum = prefix[std::clamp(b, 0, n)] - prefix[std::clamp(a, 0, n)];
+    return static_cast<float>(sum / (b - a));
+}
+
+// Three equal cells along one axis: the placement where a valley profile
+// is highest on the four lines around and between the cells and lowest in
+// their middles. Against a dark background the outer two lines may not
+// show, but the inner two still fix the grid.
+GridFit fitGrid(const std::vector<float>& profile) {
+    const int n = static_cast<int>(profile.size());
+    std::vector<double> prefix(n + 1, 0.0);
+    for (int i = 0; i < n; i++) {
+        prefix[i + 1] = prefix[i] + profile[i];
+    }
+    GridFit best;
+    for (int size = std::max(3, n / 4); size <= n; size++) {
+        const double cell = size / 3.0;
+        const double line = std::max(1.0, size * 0.015);  // half the width of a line
+        const double inset = cell * 0.2;
+        const int margin = static_cast<int>(line);
+        for (int start = -margin; start + size <= n + margin; start++) {
+            float middles = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                middles += meanOver(prefix, start + k * cell + inset, start + (k + 1) * cell - inset);
+            }
+            float lines = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                lines += meanOver(prefix, start + k * cell - line, start + k * cell + line);
+            }
+            float score = lines / 4.0f - middles / 3.0f;
+            if (score > best.score) {
+                best = {start, size, score};
+            }
+        }
+    }
+    return best;
+}
+
+// Colour features that ignore brightness but for a small lightness term:
+// white sits at the origin, and red, orange, yellow, green and blue lie
+// around it
+struct Features {
+    std::array<float, 54> a;
+    std::array<float, 54> b;
+    std::array<float, 54> lightness;
+};
+
+void setFeature(Features& features, int i, float r, float g, float b) {
+    float mean = (r + g + b) / 3.0f + 1.0f;
+    features.a[i] = (r - g) / mean;
+    features.b[i] = ((r + g) * 0.5f - b) / mean;
+    features.lightness[i] = std::log(mean);
+}
+
+// distances[c][i]: squared feature distance from sticker i to colour c
+void colorDistances(const Features& features, const float (&ref)[6][3], float (&distances)[6][54]) {
+    for (int c = 0; c < 6; c++) {
+        for (int i = 0; i < 54; i++) {
+            float da = features.a[i] - ref[c][0];
+            float db = features.b[i] - ref[c][1];
+            float dl = features.lightness[i] - ref[c][2];
+            distances[c][i] = da * da + db * db + LIGHTNESS_WEIGHT * dl * dl;
+        }
+    }
+}
+
+} // namespace
+
+FaceSample sampleFace(const RgbImage& image) {
+    FaceSample sample;
+    if (image.width < 3 || image.height < 3) {
+        sample.spread.fill(1.0f);
+        return sample;
+    }
+    const Planes planes = downsample(image);
+    const int width = planes.width;
+    const int height = planes.height;
+    const std::vector<float> brightness = relativeBrightness(planes);
+    const std::vector<float> valleysX = valleys(brightness, width, height, true);
+    const std::vector<float> valleysY = valleys(brightness, width, height, false);
+
+    // Fit each axis to the other's band, and refit, so that clutter beside the
+    // face drops out of the profiles
+    GridFit fitX = fitGrid(columnProfile(valleysX, width, 0, height));
+    GridFit fitY;
+    for (int pass = 0; pass < 3; pass++) {
+        if (pass > 0) {
+            fitX = fitGrid(columnProfile(valleysX, width, std::max(0, fitY.start),
+                                         std::min(height, fitY.start + fitY.size)));
+        }
+        fitY = fitGrid(rowProfile(valleysY, width, height, std::max(0, fitX.start),
+                                  std::min(width, fitX.start + fitX.size)));
+    }
+    float squareness = float(std::min(fitX.size, fitY.size)) / float(std::max(1, std::max(fitX.size, fitY.size)));
+    sample.gridScore = std::clamp(std::min(fitX.score, fitY.score), 0.0f, 1.0f) * std::min(1.0f, squareness / 0.85f);
+
+    // The middle half of each cell, clear of the lines and rounded corners
+    const double cellX = fitX.size / 3.0;
+    const double cellY = fitY.size / 3.0;
+    for (int cell = 0; cell < 9; cell++) {
+        int x0 = std::clamp(int(fitX.start + (cell % 3 + 0.25) * cellX), 0, width);
+        int x1 = std::clamp(int(fitX.start + (cell % 3 + 0.75) * cellX + 0.5), 0, width);
+        int y0 = std::clamp(int(fitY.start + (cell / 3 + 0.25) * cellY), 0, height);
+        int y1 = std::clamp(int(fitY.start + (cell / 3 + 0.75) * cellY + 0.5), 0, height);
+        if (x1 <= x0 || y1 <= y0) {
+            sample.spread[cell] = 1.0f;
+            continue;
+        }
+        float sum[3] = {0.0f, 0.0f, 0.0f};
+        for (int y = y0; y < y1; y++) {
+            const size_t row = size_t(y) * width;
+            for (int x = x0; x < x1; x++) {
+                sum[0] += planes.r[row + x];
+                sum[1] += planes.g[row + x];
+                sum[2] += planes.b[row + x];
+            }
+        }
+        const float count = float((x1 - x0) * (y1 - y0));
+        const float mean[3] = {sum[0] / count, sum[1] / count, sum[2] / count};
+        float deviation = 0.0f;
+        for (int y = y0; y < y1; y++) {
+            const size_t row = size_t(y) * width;
+            for (int x = x0; x < x1; x++) {
+                deviation += std::fabs(planes.r[row + x] - mean[0]) + std::fabs(planes.g[row + x] - mean[1]) +
+                             std::fabs(planes.b[row + x] - mean[2]);
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            sample.rgb[cell][c] = mean[c];
+        }
+        sample.spread[cell] = deviation / (3.0f * count) / ((mean[0] + mean[1] + mean[2]) / 3.0f + 1.0f);
+    }
+    return sample;
+}
+
+std::string CubeReading::state() const {
+    std::string state(54, ' ');
+    for (int face = 0; face < 6; face++) {
+        for (int i = 0; i < 9; i++) {
+            state[face * 9 + i] = COLOR_LETTERS[static_cast<int>(facelets[face][i])];
+        }
+    }
+    return state;
+}
+
+CubeReading classifyCube(const std::array<FaceSample, 6>& faces, const PhotoImportOptions& options) {
+    // White balance on the white centre, unless it is too dark or coloured
+    // to be trusted
+    const std::array<float, 3>& white = faces[static_cast<int>(Face::UP)].rgb[4];
+    const float top = std::max(white[0], std::max(white[1], white[2]));
+    const float bottom = std::min(white[0], std::min(white[1], white[2]));
+    float gain[3] = {1.0f, 1.0f, 1.0f};
+    if (top >= 16.0f && bottom >= 0.5f * top) {
+        for (int c = 0; c < 3; c++) {
+            gain[c] = top / white[c];
+        }
+    }
+    Features features;
+    for (int face = 0; face < 6; face++) {
+        for (int i = 0; i < 9; i++) {
+            const std::array<float, 3>& rgb = faces[face].rgb[i];
+            setFeature(features, face * 9 + i, rgb[0] * gain[0], rgb[1] * gain[1], rgb[2] * gain[2]);
+        }
+    }
+
+    // Each centre is its face's colour in the fixed scheme and seeds it;
+    // then each colour moves to the mean of the stickers nearest to it
+    float ref[6][3];
+    for (int c = 0; c < 6; c++) {
+        ref[c][0] = features.a[c * 9 + 4];
+        ref[c][1] = features.b[c * 9 + 4];
+        ref[c][2] = features.lightness[c * 9 + 4];
+    }
+    float distances[6][54];
+    colorDistances(features, ref, distances);
+    float sums[6][3] = {};
+    int members[6] = {};
+    for (int i = 0; i < 54; i++) {
+        int nearest = i % 9 == 4 ? i / 9 : 0;
+        for (int c = 1; c < 6 && i % 9 != 4; c++) {
+            if (distances[c][i] < distances[nearest][i]) {
+                nearest = c;
+            }
+        }
+        sums[nearest][0] += features.a[i];
+        sums[nearest][1] += features.b[i];
+        sums[nearest][2] += features.lightness[i];
+        members[nearest]++;
+    }
+    for (int c = 0; c < 6; c++) {
+        for (int k = 0; k < 3; k++) {
+            ref[c][k] = sums[c][k] / float(members[c]);  // the centre is always a member
+        }
+    }
+    colorDistances(features, ref, distances);
+
+    // Nine of each colour: the closest sticker-colour pairs first
+    std::vector<std::pair<float, int>> candidates;
+    candidates.reserve(48 * 6);
+    for (int i = 0; i < 54; i++) {
+        for (int c = 0; c < 6 && i % 9 != 4; c++) {
+            candidates.emplace_back(distances[c][i], i * 6 + c);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    int assigned[54];
+    int counts[6];
+    std::fill(assigned, assigned + 54, -1);
+    for (int c = 0; c < 6; c++) {
+        assigned[c * 9 + 4] = c;
+        counts[c] = 1;
+    }
+    for (const auto& candidate : candidates) {
+        int i = candidate.second / 6;
+        int c = candidate.second % 6;
+        if (assigned[i] < 0 && counts[c] < 9) {
+            assigned[i] = c;
+            counts[c]++;
+        }
+    }
+
+    CubeReading reading;
+    for (int i = 0; i < 54; i++) {
+        const int face = i / 9;
+        reading.facelets[face][i % 9] = static_cast<Color>(assigned[i]);
+        float other = -1.0f;
+        for (int c = 0; c < 6; c++) {
+            if (c != assigned[i] && (other < 0.0f || distances[c][i] < other)) {
+                other = distances[c][i];
+            }
+        }
+        // 1 for a sticker right on its colour, 0 halfway to another and
+        // for one moved off its nearest colour
+        float confidence = i % 9 == 4 ? 1.0f
+                         : other > 0.0f ? std::clamp(1.0f - std::sqrt(distances[assigned[i]][i] / other), 0.0f, 1.0f)
+                                        : 0.0f;
+        reading.confidence[i] = confidence;
+        if (confidence < options.minConfidence || faces[face].spread[i % 9] > MAX_SPREAD ||
+            faces[face].gridScore < MIN_GRID_SCORE) {
+            reading.lowConfidenceFaces |= 1 << face;
+        }
+    }
+
+    StateValidation validation = Cube::validate(reading.facelets);
+    if (!validation.ok()) {
+        reading.error = reading.state() + ": " + validation.message();
+    }
+    return reading;
+}
+
+std::vector<CubeReading> importPhotos(const std::vector<std::array<std::string, 6>>& cubes,
+                                      const PhotoImportOptions& options,
+                                      const std::function<void(uint64_t, uint64_t)>& progress) {
+    const uint64_t count = cubes.size();
+    std::vector<CubeReading> readings(count);
+    std::atomic<uint64_t> next{0};
+    std::atomic<uint64_t> done{0};
+    auto worker = [&] {
+        std::array<FaceSample, 6> samples;
+        for (uint64_t i = next++; i < count; i = next++) {
+            int face = 0;
+            try {
+                for (; face < 6; face++) {
+                    samples[face] = sampleFace(readImage(cubes[i][face]));
+                }
+                readings[i] = classifyCube(samples, options);
+            } catch (const CubeException& e) {
+                readings[i].error = e.what();
+            } catch (const std::exception& e) {
+                // Out of memory on one photo must not end the whole batch
+                readings[i].error = cubes[i][std::min(face, 5)] + ": " + e.what();
+            }
+            done++;
+        }
+    };
+
+    int threadCount = options.threads > 0 ? options.threads
+                                          : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back(worker);
+    }
+    if (progress) {
+        while (done < count) {
+            progress(done, count);
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+        progress(done, count);
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    return readings;
+}
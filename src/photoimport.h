@@ -0,0 +1,60 @@
+#ifndef RUBIKSCUBE_PHOTOIMPORT_H
+#define RUBIKSCUBE_PHOTOIMPORT_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "cube.h"
+#include "imagereader.h"
+
+// Colours read from the photo of one face, before classification
+struct FaceSample {
+    // Mean colour of the middle of each sticker, row by row, 0-255
+    std::array<std::array<float, 3>, 9> rgb{};
+    // Mean deviation within each sticker's middle relative to its
+    // brightness; high where glare or a grid line falls on it
+    std::array<float, 9> spread{};
+    // How well a 3x3 grid of bright stickers between dark lines fits the
+    // photo, 0-1
+    float gridScore = 0.0f;
+};
+
+// Locate the stickers in a photo of one face and sample their colours. The
+// face should be seen roughly square-on and upright, with its rows as
+// Cube::getState() lists them, and span at least a quarter of the
+// photo's longer side, with its outline in view.
+FaceSample sampleFace(const RgbImage& image);
+
+struct PhotoImportOptions {
+    int threads = 0;              // 0 = one per hardware thread
+    float minConfidence = 0.25f;  // stickers below this flag their face
+};
+
+struct CubeReading {
+    Cube::Facelets facelets{};
+    std::array<float, 54> confidence{};  // per facelet, 0-1
+    int lowConfidenceFaces = 0;          // bit (1 << Face) per doubtful face
+    std::string error;                   // unreadable photo or invalid state
+
+    bool ok() const { return error.empty(); }
+    std::string state() const;  // 54 colour letters as Cube::getState()
+};
+
+// Classify the stickers of a cube's six faces, given in Face order. The
+// white centre sets the white balance, each centre seeds its colour, and
+// the colours are then refined from all stickers and assigned nine of
+// each. Stickers that are ambiguous, noisy or were moved to another colour
+// to keep nine of each mark their face as low confidence. The result is
+// checked with Cube::validate().
+CubeReading classifyCube(const std::array<FaceSample, 6>& faces, const PhotoImportOptions& options);
+
+// Read and classify the six photos of each cube (paths in Face order) on
+// every core; results are in input order. progress, if set, is called
+// from the calling thread with (done, count).
+std::vector<CubeReading> importPhotos(const std::vector<std::array<std::string, 6>>& cubes,
+                                      const PhotoImportOptions& options,
+                                      const std::function<void(uint64_t, uint64_t)>& progress = nullptr);
+
+#endif
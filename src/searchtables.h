@@ -0,0 +1,149 @@
+#ifndef RUBIKSCUBE_SEARCHTABLES_H
+#define RUBIKSCUBE_SEARCHTABLES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#include "cubie.h"
+
+#if defined(CUBE_HUGE_PAGES) && defined(__linux__)
+#include <sys/mman.h>
+#define CUBE_TABLE_MMAP 1
+#endif
+
+// Building blocks shared by the searches: coordinate move tables,
+// breadth-first pruning tables and move-sequence pruning.
+
+constexpr uint8_t NO_MOVE = 0xFF;
+constexpr uint8_t UNVISITED = 0xFF;
+
+// Moves that keep the cube in the phase 2 subgroup <U, D, F2, B2, L2, R2>
+inline bool isPhase2Move(int move) {
+    return move >= 12 || move % 3 == 2;
+}
+
+// Skip turning the same face twice in a row, and only allow opposite faces
+// in one order (F B, not B F), since both orders give the same state
+inline bool canFollow(uint8_t previous, int move) {
+    if (previous == NO_MOVE) {
+        return true;
+    }
+    int face = move / 3;
+    int previousFace = previous / 3;
+    return face != previousFace && !(face / 2 == previousFace / 2 && face < previousFace);
+}
+
+// Allocator for the large tables that searches probe at random. Built with
+// CUBE_HUGE_PAGES on Linux, each table is a mapping of whole 2 MB pages:
+// explicit huge pages where some are reserved (vm.nr_hugepages), otherwise
+// ordinary pages marked for transparent huge pages. Either way a probe is
+// far less likely to miss the TLB, at the cost of rounding every table up
+// to 2 MB. Without it, this is std::allocator.
+template <typename T>
+struct TableAllocator {
+    using value_type = T;
+
+    TableAllocator() = default;
+    template <typename U>
+    TableAllocator(const TableAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+#ifdef CUBE_TABLE_MMAP
+        size_t bytes = mappedBytes(n);
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) {
+            p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            madvise(p, bytes, MADV_HUGEPAGE);
+        }
+        return static_cast<T*>(p);
+#else
+        return std::allocator<T>().allocate(n);
+#endif
+    }
+
+    void deallocate(T* p, size_t n) {
+#ifdef CUBE_TABLE_MMAP
+        munmap(p, mappedBytes(n));
+#else
+        std::allocator<T>().deallocate(p, n);
+#endif
+    }
+
+#ifdef CUBE_TABLE_MMAP
+    static size_t mappedBytes(size_t n) {
+        constexpr size_t HUGE_PAGE = size_t(2) << 20;
+        return (n * sizeof(T) + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    }
+#endif
+};
+
+template <typename T, typename U>
+bool operator==(const TableAllocator<T>&, const TableAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const TableAllocator<T>&, const TableAllocator<U>&) { return false; }
+
+template <typename T>
+using TableVector = std::vector<T, TableAllocator<T>>;
+
+// Start loading the cache line at address for a probe shortly after, so
+// that the misses of several probes overlap
+inline void prefetchTable(const void* address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+// table[i * NUM_MOVES + m] = coordinate after move m from coordinate i
+template <typename Index, typename Allocator, typename Get, typename Set>
+void buildMoveTable(std::vector<Index, Allocator>& table, int size, Get get, Set set, bool phase2Only) {
+    table.assign(static_cast<size_t>(size) * NUM_MOVES, 0);
+    for (int i = 0; i < size; i++) {
+        CubieCube cube;
+        set(cube, i);
+        for (int m = 0; m < NUM_MOVES; m++) {
+            if (phase2Only && !isPhase2Move(m)) {
+                continue;
+            }
+            CubieCube next = cube;
+            next.multiply(moveCube(m));
+            table[static_cast<size_t>(i) * NUM_MOVES + m] = static_cast<Index>(get(next));
+        }
+    }
+}
+
+// Breadth-first search outwards from the roots: table[i] is the number of
+// moves from index i to the nearest root in the projection that next()
+// describes
+template <typename Allocator, typename Next>
+void buildPruneTable(std::vector<uint8_t, Allocator>& table, uint32_t size, const int* moves, int numMoves, Next next,
+                     const std::vector<uint32_t>& roots = {0}) {
+    table.assign(size, UNVISITED);
+    std::vector<uint32_t> queue(size);
+    size_t head = 0;
+    size_t tail = 0;
+    for (uint32_t root : roots) {
+        if (table[root] == UNVISITED) {
+            table[root] = 0;
+            queue[tail++] = root;
+        }
+    }
+    while (head < tail) {
+        uint32_t index = queue[head++];
+        for (int i = 0; i < numMoves; i++) {
+            uint32_t child = next(index, moves[i]);
+            if (table[child] == UNVISITED) {
+                table[child] = static_cast<uint8_t>(table[index] + 1);
+                queue[tail++] = child;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,327 @@
+#include "shardedjob.h"
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr char JOB_MAGIC[] = "CUBEJOB1";
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+
+using File = std::unique_ptr<std::FILE, FileCloser>;
+
+File openFile(const std::string& path, const char* mode) {
+    File file(std::fopen(path.c_str(), mode));
+    if (!file) {
+        throw CubeException("Cannot open " + path + ": " + std::strerror(errno));
+    }
+    return file;
+}
+
+// Flush to disk and close, so a rename that follows publishes the whole file
+void closeDurably(File file, const std::string& path) {
+    bool ok = std::fflush(file.get()) == 0 && fsync(fileno(file.get())) == 0;
+    ok = std::fclose(file.release()) == 0 && ok;
+    if (!ok) {
+        throw CubeException("Cannot write " + path + ": " + std::strerror(errno));
+    }
+}
+
+void makeDirectory(const std::string& path) {
+    if (mkdir(path.c_str(), 0777) != 0) {
+        throw CubeException("Cannot create " + path + ": " + std::strerror(errno));
+    }
+}
+
+void renameFile(const std::string& from, const std::string& to) {
+    if (std::rename(from.c_str(), to.c_str()) != 0) {
+        throw CubeException("Cannot rename " + from + " to " + to + ": " + std::strerror(errno));
+    }
+}
+
+bool exists(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+// Names in a directory, skipping dot files, sorted
+std::vector<std::string> listDirectory(const std::string& path) {
+    std::unique_ptr<DIR, int (*)(DIR*)> dir(opendir(path.c_str()), closedir);
+    if (!dir) {
+        throw CubeException("Cannot read " + path + ": " + std::strerror(errno));
+    }
+    std::vector<std::string> names;
+    while (dirent* entry = readdir(dir.get())) {
+        if (entry->d_name[0] != '.') {
+            names.push_back(entry->d_name);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Make the directory of a new job, or reset one that an interrupted
+// create() left without a job file. Such a directory holds only the job's
+// subdirectories, with nothing in running or done, since workers cannot
+// open a job before its job file exists. Anything else is refused rather
+// than cleared.
+void prepareJobDirectory(const std::string& directory) {
+    const std::vector<std::string> subdirectories = {"todo", "running", "done", "tmp"};
+    if (!exists(directory)) {
+        makeDirectory(directory);
+    }
+    for (const std::string& name : listDirectory(directory)) {
+        if (std::find(subdirectories.begin(), subdirectories.end(), name) == subdirectories.end()) {
+            throw CubeException(directory + " exists and is not a solve job");
+        }
+    }
+    for (const char* started : {"/running", "/done"}) {
+        if (exists(directory + started) && !listDirectory(directory + started).empty()) {
+            throw CubeException(directory + " exists and is not a solve job");
+        }
+    }
+    for (const std::string& sub : subdirectories) {
+        std::string path = directory + "/" + sub;
+        if (!exists(path)) {
+            makeDirectory(path);
+            continue;
+        }
+        for (const std::string& name : listDirectory(path)) {
+            if (std::remove((path + "/" + name).c_str()) != 0) {
+                throw CubeException("Cannot remove " + path + "/" + name + ": " + std::strerror(errno));
+            }
+        }
+    }
+}
+
+std::string shardName(int shard) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "%06d", shard);
+    return name;
+}
+
+bool readLine(std::FILE* file, std::string& line) {
+    line.clear();
+    int c;
+    while ((c = std::fgetc(file)) != EOF && c != '\n') {
+        line += static_cast<char>(c);
+    }
+    return c != EOF || !line.empty();
+}
+
+std::string hostName() {
+    char name[256] = {};
+    gethostname(name, sizeof(name) - 1);
+    return name;
+}
+
+// A claim's worker is on this host and its process is gone
+bool localWorkerExited(const std::string& worker) {
+    size_t dot = worker.rfind('.');
+    if (dot == std::string::npos || worker.compare(0, dot, hostName()) != 0) {
+        return false;
+    }
+    pid_t pid = static_cast<pid_t>(std::atol(worker.c_str() + dot + 1));
+    return pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+} // namespace
+
+std::string localWorkerId(int pid) {
+    return hostName() + "." + std::to_string(pid);
+}
+
+ShardedJob ShardedJob::create(const std::string& directory, const std::string& inputPath, int shardStates) {
+    if (exists(directory + "/job")) {
+        return open(directory);
+    }
+    if (shardStates <= 0) {
+        throw CubeException("Shards must hold at least one state");
+    }
+    prepareJobDirectory(directory);
+
+    // Shards are written under tmp and renamed into todo once complete,
+    // and the job file last, so a job file means the job is complete
+    File input = openFile(inputPath, "r");
+    uint64_t states = 0;
+    int shards = 0;
+    File shard;
+    std::string shardPath;
+    std::string line;
+    while (readLine(input.get(), line)) {
+        if (line.empty()) {
+            continue;
+        }
+        if (!shard) {
+            shardPath = directory + "/tmp/" + shardName(shards);
+            shard = openFile(shardPath, "w");
+        }
+        std::fprintf(shard.get(), "%s\n", line.c_str());
+        if (++states % shardStates == 0) {
+            closeDurably(std::move(shard), shardPath);
+            renameFile(shardPath, directory + "/todo/" + shardName(shards++));
+        }
+    }
+    if (std::ferror(input.get())) {
+        throw CubeException("Cannot read " + inputPath);
+    }
+    if (shard) {
+        closeDurably(std::move(shard), shardPath);
+        renameFile(shardPath, directory + "/todo/" + shardName(shards++));
+    }
+
+    std::string jobPath = directory + "/tmp/job";
+    File job = openFile(jobPath, "w");
+    std::fprintf(job.get(), "%s %llu %d\n", JOB_MAGIC, static_cast<unsigned long long>(states), shards);
+    closeDurably(std::move(job), jobPath);
+    renameFile(jobPath, directory + "/job");
+    return ShardedJob(directory, states, shards);
+}
+
+ShardedJob ShardedJob::open(const std::string& directory) {
+    File job = openFile(directory + "/job", "r");
+    char magic[16] = {};
+    unsigned long long states = 0;
+    int shards = 0;
+    if (std::fscanf(job.get(), "%15s %llu %d", magic, &states, &shards) != 3 || std::strcmp(magic, JOB_MAGIC) != 0 ||
+        shards < 0) {
+        throw CubeException(directory + " is not a solve job");
+    }
+    return ShardedJob(directory, states, shards);
+}
+
+JobProgress ShardedJob::progress() const {
+    JobProgress progress;
+    progress.shards = shards;
+    progress.todo = static_cast<int>(listDirectory(directory + "/todo").size());
+    progress.running = static_cast<int>(listDirectory(directory + "/running").size());
+    progress.done = static_cast<int>(listDirectory(directory + "/done").size());
+    return progress;
+}
+
+int ShardedJob::work(const SolveOptions& options, const std::string& workerId) {
+    int solved = 0;
+    std::string shard;
+    while (claim(workerId, shard)) {
+        solveShard(shard, workerId, options);
+        solved++;
+    }
+    return solved;
+}
+
+// Only one of several workers renaming the same shard succeeds; the others
+// see ENOENT and try the next one
+bool ShardedJob::claim(const std::string& workerId, std::string& shard) {
+    for (const std::string& name : listDirectory(directory + "/todo")) {
+        std::string from = directory + "/todo/" + name;
+        std::string to = directory + "/running/" + name + "." + workerId;
+        if (std::rename(from.c_str(), to.c_str()) == 0) {
+            shard = name;
+            return true;
+        }
+        if (errno != ENOENT) {
+            throw CubeException("Cannot claim " + from + ": " + std::strerror(errno));
+        }
+    }
+    return false;
+}
+
+void ShardedJob::solveShard(const std::string& shard, const std::string& workerId, const SolveOptions& options) {
+    const std::string claimPath = directory + "/running/" + shard + "." + workerId;
+    const std::string outPath = directory + "/tmp/" + shard + "." + workerId;
+    File input = openFile(claimPath, "r");
+    File output = openFile(outPath, "w");
+
+    Solver solver;
+    Solution solution;
+    std::string line;
+    auto renewed = std::chrono::steady_clock::now();
+    while (readLine(input.get(), line)) {
+        Cube cube;
+        if (!cube.setState(line)) {
+            std::fprintf(output.get(), "error: %s\n", Cube::validate(line).message());
+        } else if (solver.solve(cube, options, solution)) {
+            std::fprintf(output.get(), "%s\n", solution.toString().c_str());
+        } else {
+            std::fprintf(output.get(), "no solution within %d moves\n", options.maxLength);
+        }
+        // Renew the lease; if the claim was requeued meanwhile, finishing
+        // is still harmless, since both results are the same
+        if (std::chrono::steady_clock::now() - renewed > std::chrono::seconds(1)) {
+            utime(claimPath.c_str(), nullptr);
+            renewed = std::chrono::steady_clock::now();
+        }
+    }
+    if (std::ferror(input.get())) {
+        throw CubeException("Cannot read " + claimPath);
+    }
+    input.reset();
+    closeDurably(std::move(output), outPath);
+    renameFile(outPath, directory + "/done/" + shard);
+    std::remove(claimPath.c_str());
+}
+
+int ShardedJob::requeue(double leaseSeconds) {
+    int requeued = 0;
+    for (const std::string& name : listDirectory(directory + "/running")) {
+        size_t dot = name.find('.');
+        if (dot == std::string::npos) {
+            continue;
+        }
+        std::string shard = name.substr(0, dot);
+        std::string claimPath = directory + "/running/" + name;
+        if (exists(directory + "/done/" + shard)) {
+            // Finished, but the worker stopped before removing its claim
+            std::remove(claimPath.c_str());
+            continue;
+        }
+        struct stat info;
+        if (stat(claimPath.c_str(), &info) != 0) {
+            continue;  // finished or requeued meanwhile
+        }
+        bool expired = leaseSeconds > 0 && std::difftime(std::time(nullptr), info.st_mtime) > leaseSeconds;
+        if ((expired || localWorkerExited(name.substr(dot + 1))) &&
+            std::rename(claimPath.c_str(), (directory + "/todo/" + shard).c_str()) == 0) {
+            requeued++;
+        }
+    }
+    return requeued;
+}
+
+void ShardedJob::merge(const std::string& outPath) const {
+    for (int i = 0; i < shards; i++) {
+        if (!exists(directory + "/done/" + shardName(i))) {
+            throw CubeException("Shard " + shardName(i) + " of " + directory + " is not done");
+        }
+    }
+    File output = openFile(outPath, "w");
+    std::vector<char> buffer(1 << 16);
+    for (int i = 0; i < shards; i++) {
+        std::string path = directory + "/done/" + shardName(i);
+        File input = openFile(path, "r");
+        size_t read;
+        while ((read = std::fread(buffer.data(), 1, buffer.size(), input.get())) > 0) {
+            if (std::fwrite(buffer.data(), 1, read, output.get()) != read) {
+                throw CubeException("Cannot write " + outPath + ": " + std::strerror(errno));
+            }
+        }
+        if (std::ferror(input.get())) {
+            throw CubeException("Cannot read " + path);
+        }
+    }
+    closeDurably(std::move(output), outPath);
+}
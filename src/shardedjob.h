@@ -0,0 +1,75 @@
+#ifndef RUBIKSCUBE_SHARDEDJOB_H
+#define RUBIKSCUBE_SHARDEDJOB_H
+
+#include <cstdint>
+#include <string>
+#include "solver.h"
+
+// A solve job split into shard files in a directory, which any number of
+// worker processes on machines sharing the filesystem work through with
+// no coordinating service. Every state change is a rename(), which is
+// atomic:
+//
+//   todo/NNNNNN              a shard of input states, one per line
+//   running/NNNNNN.WORKER    claimed by a worker, which renews the
+//                            claim's mtime as a lease while solving
+//   done/NNNNNN              the shard's results, one line per state
+//
+// A worker claims a shard by renaming it from todo to running, writes the
+// results under tmp and renames them into done. A crashed worker leaves
+// only its claim behind, which requeue() renames back to todo, so it loses
+// at most the shard it was solving.
+
+struct JobProgress {
+    int shards = 0;
+    int todo = 0;
+    int running = 0;
+    int done = 0;
+};
+
+class ShardedJob {
+public:
+    // Split the states in inputPath (one per line) into shards of
+    // shardStates lines under a new directory. If the directory already
+    // holds a job, opens it instead so an interrupted job resumes; if it
+    // holds a split that was interrupted before the job file was written,
+    // splits again. Throws CubeException on I/O errors, or if the
+    // directory exists and is neither.
+    static ShardedJob create(const std::string& directory, const std::string& inputPath, int shardStates);
+    // Throws CubeException if directory is not a complete job
+    static ShardedJob open(const std::string& directory);
+
+    uint64_t stateCount() const { return states; }
+    int shardCount() const { return shards; }
+    JobProgress progress() const;
+
+    // Claim and solve shards until there are none left to claim; returns
+    // the number solved. Throws CubeException on I/O errors, leaving the
+    // current claim for requeue().
+    int work(const SolveOptions& options, const std::string& workerId);
+
+    // Move claims back to todo: those of workers on this host that are no
+    // longer running, and those whose lease is older than leaseSeconds
+    // (if > 0), for workers elsewhere. Returns the number requeued.
+    int requeue(double leaseSeconds);
+
+    // Write all results in input order; throws CubeException unless every
+    // shard is done
+    void merge(const std::string& outPath) const;
+
+private:
+    ShardedJob(const std::string& directory, uint64_t states, int shards)
+        : directory(directory), states(states), shards(shards) {}
+
+    bool claim(const std::string& workerId, std::string& shard);
+    void solveShard(const std::string& shard, const std::string& workerId, const SolveOptions& options);
+
+    std::string directory;
+    uint64_t states;
+    int shards;
+};
+
+// "host.pid", unique among the workers sharing a job
+std::string localWorkerId(int pid);
+
+#endif
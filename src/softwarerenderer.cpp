@@ -0,0 +1,304 @@
+#include "softwarerenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <string>
+
+namespace {
+
+const float PI = 3.14159265358979f;
+const float FIELD_OF_VIEW = 45.0f;
+
+// Piece geometry of CubeRenderer: half-size of a piece and the gap between pieces
+const float PIECE_SIZE = 0.2f;
+const float PIECE_GAP = 0.05f;
+const float PIECE_SPACING = 2 * PIECE_SIZE + PIECE_GAP;
+
+const uint8_t BACKGROUND[3] = {25, 25, 25};
+const uint8_t BODY[3] = {25, 25, 25};
+
+// CubeRenderer's colours, indexed by Color
+const uint8_t PALETTE[6][3] = {
+    {0, 255, 0},      // GREEN
+    {0, 0, 255},      // BLUE
+    {255, 128, 0},    // ORANGE
+    {255, 0, 0},      // RED
+    {255, 255, 255},  // WHITE
+    {255, 255, 0}     // YELLOW
+};
+
+// Outward normal of each face, in Face order
+const int FACE_NORMALS[6][3] = {
+    {0, 0, 1}, {0, 0, -1}, {-1, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, -1, 0}
+};
+
+// Sticker of piece (x, y, z) on face, using CubeRenderer's layout; false
+// if that side of the piece is inside the cube
+bool stickerAt(int face, int x, int y, int z, int& row, int& col) {
+    switch (static_cast<Face>(face)) {
+        case Face::FRONT: row = 2 - y; col = x; return z == 2;
+        case Face::BACK: row = 2 - y; col = 2 - x; return z == 0;
+        case Face::LEFT: row = 2 - y; col = z; return x == 0;
+        case Face::RIGHT: row = 2 - y; col = 2 - z; return x == 2;
+        case Face::UP: row = z; col = x; return y == 2;
+        case Face::DOWN: row = 2 - z; col = x; return y == 0;
+    }
+    return false;
+}
+
+// Rotation of angle radians about a coordinate axis, as a 3x3 matrix
+void axisRotation(int axis, float angle, float (&m)[3][3]) {
+    const float c = std::cos(angle);
+    const float s = std::sin(angle);
+    const int a = (axis + 1) % 3;
+    const int b = (axis + 2) % 3;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            m[i][j] = i == j ? 1.0f : 0.0f;
+        }
+    }
+    m[a][a] = c;
+    m[a][b] = -s;
+    m[b][a] = s;
+    m[b][b] = c;
+}
+
+} // namespace
+
+SoftwareRenderer::SoftwareRenderer(const RenderOptions& options)
+    : options(options)
+    , bufferWidth(0)
+    , bufferHeight(0)
+    , focal(1.0f / std::tan(FIELD_OF_VIEW * 0.5f * PI / 180.0f))
+{
+    if (options.width <= 0 || options.height <= 0) {
+        throw CubeException("Render size must be positive");
+    }
+    const int samples = std::max(1, options.samples);
+    if (samples > MAX_RENDER_SAMPLES) {
+        throw CubeException("At most " + std::to_string(MAX_RENDER_SAMPLES) + " samples per pixel side");
+    }
+    // Checked by division so that width * samples cannot overflow
+    if (options.width > MAX_RENDER_SIDE / samples || options.height > MAX_RENDER_SIDE / samples) {
+        throw CubeException("Render size times samples must be at most " + std::to_string(MAX_RENDER_SIDE) +
+                            " pixels on a side");
+    }
+    this->options.samples = samples;
+    bufferWidth = options.width * samples;
+    bufferHeight = options.height * samples;
+    try {
+        color.resize(size_t(bufferWidth) * bufferHeight * 3);
+        depth.resize(size_t(bufferWidth) * bufferHeight);
+    } catch (const std::bad_alloc&) {
+        throw CubeException("Not enough memory for a " + std::to_string(bufferWidth) + "x" +
+                            std::to_string(bufferHeight) + " render buffer");
+    }
+
+    // Pitch about x after yaw about y
+    float yaw[3][3];
+    float pitch[3][3];
+    axisRotation(1, options.yaw * PI / 180.0f, yaw);
+    axisRotation(0, options.pitch * PI / 180.0f, pitch);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            view[i][j] = pitch[i][0] * yaw[0][j] + pitch[i][1] * yaw[1][j] + pitch[i][2] * yaw[2][j];
+        }
+    }
+}
+
+void SoftwareRenderer::render(const Cube& cube, int move, float progress, uint8_t* rgb) {
+    for (size_t i = 0; i < depth.size(); i++) {
+        std::copy(BACKGROUND, BACKGROUND + 3, &color[i * 3]);
+    }
+    std::fill(depth.begin(), depth.end(), 0.0f);
+
+    // The turning layer rotates about the outward normal of its face;
+    // clockwise seen from outside is a negative angle
+    int turnFace = -1;
+    float turn[3][3];
+    if (move >= 0 && move < NUM_MOVES) {
+        static const int quarterTurns[3] = {1, -1, 2};
+        turnFace = move / 3;
+        const int* normal = FACE_NORMALS[turnFace];
+        int axis = normal[0] != 0 ? 0 : normal[1] != 0 ? 1 : 2;
+        int sign = normal[axis];
+        axisRotation(axis, -sign * quarterTurns[move % 3] * 0.5f * PI * progress, turn);
+    }
+
+    for (int x = 0; x < 3; x++) {
+        for (int y = 0; y < 3; y++) {
+            for (int z = 0; z < 3; z++) {
+                const int piece[3] = {x, y, z};
+                bool turning = false;
+                if (turnFace >= 0) {
+                    const int* normal = FACE_NORMALS[turnFace];
+                    int axis = normal[0] != 0 ? 0 : normal[1] != 0 ? 1 : 2;
+                    turning = piece[axis] == (normal[axis] > 0 ? 2 : 0);
+                }
+
+                for (int face = 0; face < 6; face++) {
+                    int row;
+                    int col;
+                    const uint8_t* faceColor = BODY;
+                    if (stickerAt(face, x, y, z, row, col)) {
+                        faceColor = PALETTE[static_cast<int>(cube.getFaceColor(face, row, col))];
+                    }
+
+                    // Face centre and in-plane axes in model space
+                    const int* n = FACE_NORMALS[face];
+                    float center[3];
+                    float u[3] = {0, 0, 0};
+                    float v[3];
+                    for (int i = 0; i < 3; i++) {
+                        center[i] = (piece[i] - 1) * PIECE_SPACING + n[i] * PIECE_SIZE;
+                    }
+                    u[n[1] != 0 ? 0 : 1] = PIECE_SIZE;
+                    v[0] = n[1] * u[2] - n[2] * u[1];
+                    v[1] = n[2] * u[0] - n[0] * u[2];
+                    v[2] = n[0] * u[1] - n[1] * u[0];
+
+                    static const float cornerSigns[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+                    Vec3 corners[4];
+                    for (int k = 0; k < 4; k++) {
+                        float p[3];
+                        for (int i = 0; i < 3; i++) {
+                            p[i] = center[i] + cornerSigns[k][0] * u[i] + cornerSigns[k][1] * v[i];
+                        }
+                        if (turning) {
+                            float q[3] = {p[0], p[1], p[2]};
+                            for (int i = 0; i < 3; i++) {
+                                p[i] = turn[i][0] * q[0] + turn[i][1] * q[1] + turn[i][2] * q[2];
+                            }
+                        }
+                        corners[k] = {view[0][0] * p[0] + view[0][1] * p[1] + view[0][2] * p[2],
+                                      view[1][0] * p[0] + view[1][1] * p[1] + view[1][2] * p[2],
+                                      view[2][0] * p[0] + view[2][1] * p[1] + view[2][2] * p[2] - options.distance};
+                    }
+
+                    float m[3] = {float(n[0]), float(n[1]), float(n[2])};
+                    if (turning) {
+                        float q[3] = {m[0], m[1], m[2]};
+                        for (int i = 0; i < 3; i++) {
+                            m[i] = turn[i][0] * q[0] + turn[i][1] * q[1] + turn[i][2] * q[2];
+                        }
+                    }
+                    Vec3 normal = {view[0][0] * m[0] + view[0][1] * m[1] + view[0][2] * m[2],
+                                   view[1][0] * m[0] + view[1][1] * m[1] + view[1][2] * m[2],
+                                   view[2][0] * m[0] + view[2][1] * m[1] + view[2][2] * m[2]};
+                    drawQuad(corners, normal, faceColor);
+                }
+            }
+        }
+    }
+
+    // Box-filter the supersampled buffer down to the output size
+    const int s = options.samples;
+    for (int py = 0; py < options.height; py++) {
+        for (int px = 0; px < options.width; px++) {
+            int sum[3] = {0, 0, 0};
+            for (int sy = 0; sy < s; sy++) {
+                const uint8_t* src = &color[((size_t(py) * s + sy) * bufferWidth + size_t(px) * s) * 3];
+                for (int sx = 0; sx < s * 3; sx += 3) {
+                    sum[0] += src[sx];
+                    sum[1] += src[sx + 1];
+                    sum[2] += src[sx + 2];
+                }
+            }
+            uint8_t* out = rgb + (size_t(py) * options.width + px) * 3;
+            for (int i = 0; i < 3; i++) {
+                out[i] = static_cast<uint8_t>(sum[i] / (s * s));
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::drawQuad(const Vec3 (&corners)[4], const Vec3& normal, const uint8_t* faceColor) {
+    // The eye is at the origin, so a face points away from it when its
+    // normal and any of its points agree
+    if (normal.x * corners[0].x + normal.y * corners[0].y + normal.z * corners[0].z >= 0.0f) {
+        return;
+    }
+
+    // Light from above and behind the camera, as in CubeRenderer's 0.3 + 0.7 N.L
+    const float lx = 0.27f, ly = 0.45f, lz = 0.85f;
+    float shade = 0.3f + 0.7f * std::max(0.0f, normal.x * lx + normal.y * ly + normal.z * lz);
+    uint8_t shaded[3];
+    for (int i = 0; i < 3; i++) {
+        shaded[i] = static_cast<uint8_t>(std::min(255.0f, faceColor[i] * shade));
+    }
+
+    // Project to supersampled pixels; z holds 1 / distance
+    const float scale = 0.5f * bufferHeight * focal;
+    Vec3 projected[4];
+    for (int k = 0; k < 4; k++) {
+        float w = -1.0f / corners[k].z;
+        projected[k] = {0.5f * bufferWidth + corners[k].x * w * scale,
+                        0.5f * bufferHeight - corners[k].y * w * scale, w};
+    }
+    drawTriangle(projected[0], projected[1], projected[2], shaded);
+    drawTriangle(projected[0], projected[2], projected[3], shaded);
+}
+
+void SoftwareRenderer::drawTriangle(const Vec3& a, const Vec3& b, const Vec3& c, const uint8_t* faceColor) {
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (area == 0.0f) {
+        return;
+    }
+    const float inverseArea = 1.0f / area;
+
+    int minX = std::max(0, int(std::floor(std::min({a.x, b.x, c.x}))));
+    int maxX = std::min(bufferWidth - 1, int(std::ceil(std::max({a.x, b.x, c.x}))));
+    int minY = std::max(0, int(std::floor(std::min({a.y, b.y, c.y}))));
+    int maxY = std::min(bufferHeight - 1, int(std::ceil(std::max({a.y, b.y, c.y}))));
+
+    for (int y = minY; y <= maxY; y++) {
+        const float py = y + 0.5f;
+        for (int x = minX; x <= maxX; x++) {
+            const float px = x + 0.5f;
+            // Barycentric weights, positive inside for either winding
+            float wa = ((b.x - px) * (c.y - py) - (b.y - py) * (c.x - px)) * inverseArea;
+            float wb = ((c.x - px) * (a.y - py) - (c.y - py) * (a.x - px)) * inverseArea;
+            float wc = 1.0f - wa - wb;
+            if (wa < 0.0f || wb < 0.0f || wc < 0.0f) {
+                continue;
+            }
+            // 1 / distance is linear in screen space
+            float z = wa * a.z + wb * b.z + wc * c.z;
+            size_t pixel = size_t(y) * bufferWidth + x;
+            if (z > depth[pixel]) {
+                depth[pixel] = z;
+                std::copy(faceColor, faceColor + 3, &color[pixel * 3]);
+            }
+        }
+    }
+}
+
+int renderAnimation(SoftwareRenderer& renderer, const Cube& start, const std::vector<int>& moves,
+                    const AnimationOptions& options, const std::function<void(std::vector<uint8_t>&&)>& frame) {
+    Cube cube = start;
+    int frames = 0;
+    auto emit = [&](int move, float progress) {
+        std::vector<uint8_t> image(renderer.frameBytes());
+        renderer.render(cube, move, progress, image.data());
+        frame(std::move(image));
+        frames++;
+    };
+
+    for (int i = 0; i < options.holdFrames; i++) {
+        emit(-1, 0.0f);
+    }
+    const int steps = std::max(1, options.framesPerMove);
+    for (int move : moves) {
+        for (int step = 1; step < steps; step++) {
+            // Ease in and out
+            float t = float(step) / steps;
+            emit(move, t * t * (3.0f - 2.0f * t));
+        }
+        cube.applyMove(move);
+        emit(-1, 0.0f);
+    }
+    for (int i = 0; i < options.holdFrames; i++) {
+        emit(-1, 0.0f);
+    }
+    return frames;
+}
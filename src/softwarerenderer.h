@@ -0,0 +1,69 @@
+#ifndef RUBIKSCUBE_SOFTWARERENDERER_H
+#define RUBIKSCUBE_SOFTWARERENDERER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "cube.h"
+
+// Largest supersampled buffer side, width or height times samples
+constexpr int MAX_RENDER_SIDE = 16384;
+constexpr int MAX_RENDER_SAMPLES = 16;
+
+struct RenderOptions {
+    int width = 640;
+    int height = 480;
+    int samples = 2;        // supersampling factor along each axis
+    float yaw = -40.0f;     // view angles in degrees; the defaults show F, R and U
+    float pitch = 30.0f;
+    float distance = 7.0f;  // camera distance, as in CubeRenderer
+};
+
+// CPU rasterizer drawing the same 27-piece cube as CubeRenderer into an
+// RGB buffer. Needs no display or GL context, so it runs on headless
+// machines. Not thread-safe; use one instance per thread.
+class SoftwareRenderer {
+public:
+    // Throws CubeException if the size is not positive, samples is over
+    // MAX_RENDER_SAMPLES, the supersampled buffer would be over
+    // MAX_RENDER_SIDE on a side, or it cannot be allocated
+    explicit SoftwareRenderer(const RenderOptions& options);
+
+    int width() const { return options.width; }
+    int height() const { return options.height; }
+    size_t frameBytes() const { return size_t(options.width) * options.height * 3; }
+
+    // Draw cube into rgb (frameBytes() bytes, rows top to bottom) with the
+    // layer of move turned progress (0..1) of the way; move -1 draws the
+    // cube at rest
+    void render(const Cube& cube, int move, float progress, uint8_t* rgb);
+
+private:
+    struct Vec3 {
+        float x, y, z;
+    };
+
+    void drawQuad(const Vec3 (&corners)[4], const Vec3& normal, const uint8_t* faceColor);
+    void drawTriangle(const Vec3& a, const Vec3& b, const Vec3& c, const uint8_t* faceColor);
+
+    RenderOptions options;
+    int bufferWidth;   // supersampled size
+    int bufferHeight;
+    float view[3][3];  // cube orientation in camera space
+    float focal;
+    std::vector<uint8_t> color;
+    std::vector<float> depth;  // 1 / distance, larger is nearer
+};
+
+struct AnimationOptions {
+    int framesPerMove = 12;
+    int holdFrames = 6;  // frames of the start and end states
+};
+
+// Render the animation of moves (as numbered by Cube::applyMove) played on
+// start, calling frame with each finished image in order. Returns the
+// number of frames.
+int renderAnimation(SoftwareRenderer& renderer, const Cube& start, const std::vector<int>& moves,
+                    const AnimationOptions& options, const std::function<void(std::vector<uint8_t>&&)>& frame);
+
+#endif
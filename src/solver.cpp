@@ -0,0 +1,384 @@
+#include "solver.h"
+#include "metrics.h"
+#include "searchtables.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Moves that keep the cube in the phase 2 subgroup <U, D, F2, B2, L2, R2>
+constexpr int PHASE2_MOVES[] = {12, 13, 14, 15, 16, 17, 2, 5, 8, 11};
+constexpr int NUM_PHASE2_MOVES = 10;
+
+struct SolverTables {
+    TableVector<uint16_t> twistMove;
+    TableVector<uint16_t> flipMove;
+    TableVector<uint16_t> sliceSortedMove;
+    TableVector<uint16_t> cornerMove;
+    TableVector<uint16_t> udEdgeMove;
+
+    // Exact distances in a projection of the cube, used as admissible
+    // lower bounds: (twist, slice) and (flip, slice) for phase 1,
+    // (corners, slice order) and (U/D edges, slice order) for phase 2
+    TableVector<uint8_t> twistSlicePrune;
+    TableVector<uint8_t> flipSlicePrune;
+    TableVector<uint8_t> cornerSlicePrune;
+    TableVector<uint8_t> edgeSlicePrune;
+};
+
+SolverTables buildTables() {
+    SolverTables t;
+    buildMoveTable(t.twistMove, NUM_TWIST,
+                   [](const CubieCube& c) { return c.twist(); },
+                   [](CubieCube& c, int i) { c.setTwist(i); }, false);
+    buildMoveTable(t.flipMove, NUM_FLIP,
+                   [](const CubieCube& c) { return c.flip(); },
+                   [](CubieCube& c, int i) { c.setFlip(i); }, false);
+    buildMoveTable(t.sliceSortedMove, NUM_SLICE_SORTED,
+                   [](const CubieCube& c) { return c.sliceSorted(); },
+                   [](CubieCube& c, int i) { c.setSliceSorted(i); }, false);
+    buildMoveTable(t.cornerMove, NUM_CORNER_PERM,
+                   [](const CubieCube& c) { return c.cornerPerm(); },
+                   [](CubieCube& c, int i) { c.setCornerPerm(i); }, false);
+    buildMoveTable(t.udEdgeMove, NUM_UD_EDGE_PERM,
+                   [](const CubieCube& c) { return c.udEdgePerm(); },
+                   [](CubieCube& c, int i) { c.setUdEdgePerm(i); }, true);
+
+    int allMoves[NUM_MOVES];
+    for (int m = 0; m < NUM_MOVES; m++) {
+        allMoves[m] = m;
+    }
+    const uint16_t* twistMove = t.twistMove.data();
+    const uint16_t* flipMove = t.flipMove.data();
+    const uint16_t* sliceMove = t.sliceSortedMove.data();
+    const uint16_t* cornerMove = t.cornerMove.data();
+    const uint16_t* udEdgeMove = t.udEdgeMove.data();
+
+    buildPruneTable(t.twistSlicePrune, NUM_TWIST * NUM_SLICE, allMoves, NUM_MOVES,
+                    [=](uint32_t index, int m) {
+                        uint32_t twist = index / NUM_SLICE;
+                        uint32_t slice = index % NUM_SLICE;
+                        return twistMove[twist * NUM_MOVES + m] * NUM_SLICE +
+                               sliceMove[slice * 24 * NUM_MOVES + m] / 24;
+                    });
+    buildPruneTable(t.flipSlicePrune, NUM_FLIP * NUM_SLICE, allMoves, NUM_MOVES,
+                    [=](uint32_t index, int m) {
+                        uint32_t flip = index / NUM_SLICE;
+                        uint32_t slice = index % NUM_SLICE;
+                        return flipMove[flip * NUM_MOVES + m] * NUM_SLICE +
+                               sliceMove[slice * 24 * NUM_MOVES + m] / 24;
+                    });
+    buildPruneTable(t.cornerSlicePrune, NUM_CORNER_PERM * NUM_SLICE_PERM, PHASE2_MOVES, NUM_PHASE2_MOVES,
+                    [=](uint32_t index, int m) {
+                        uint32_t corners = index / NUM_SLICE_PERM;
+                        uint32_t slice = index % NUM_SLICE_PERM;
+                        return cornerMove[corners * NUM_MOVES + m] * NUM_SLICE_PERM +
+                               sliceMove[slice * NUM_MOVES + m];
+                    });
+    buildPruneTable(t.edgeSlicePrune, NUM_UD_EDGE_PERM * NUM_SLICE_PERM, PHASE2_MOVES, NUM_PHASE2_MOVES,
+                    [=](uint32_t index, int m) {
+                        uint32_t edges = index / NUM_SLICE_PERM;
+                        uint32_t slice = index % NUM_SLICE_PERM;
+                        return udEdgeMove[edges * NUM_MOVES + m] * NUM_SLICE_PERM +
+                               sliceMove[slice * NUM_MOVES + m];
+                    });
+    return t;
+}
+
+const SolverTables& tables() {
+    static const SolverTables instance = buildTables();
+    return instance;
+}
+
+int phase1Bound(const SolverTables& t, int twist, int flip, int slice) {
+    int position = slice / 24;
+    return std::max(t.twistSlicePrune[twist * NUM_SLICE + position],
+                    t.flipSlicePrune[flip * NUM_SLICE + position]);
+}
+
+void prefetchPhase1Bound(const SolverTables& t, int twist, int flip, int slice) {
+    int position = slice / 24;
+    prefetchTable(&t.twistSlicePrune[twist * NUM_SLICE + position]);
+    prefetchTable(&t.flipSlicePrune[flip * NUM_SLICE + position]);
+}
+
+int phase2Bound(const SolverTables& t, int corners, int edges, int slice) {
+    return std::max(t.cornerSlicePrune[corners * NUM_SLICE_PERM + slice],
+                    t.edgeSlicePrune[edges * NUM_SLICE_PERM + slice]);
+}
+
+void prefetchPhase2Bound(const SolverTables& t, int corners, int edges, int slice) {
+    prefetchTable(&t.cornerSlicePrune[corners * NUM_SLICE_PERM + slice]);
+    prefetchTable(&t.edgeSlicePrune[edges * NUM_SLICE_PERM + slice]);
+}
+
+} // namespace
+
+std::string Solution::toString() const {
+    std::string result;
+    for (int i = 0; i < length; i++) {
+        if (i > 0) {
+            result += ' ';
+        }
+        result += Cube::moveName(moves[i]);
+    }
+    return result;
+}
+
+Solver::Solver()
+    : phase1Nodes()
+    , phase2Nodes()
+    , maxLength(0)
+    , phase1Length(0)
+    , phase2Length(0)
+    , maxNodes(0)
+    , nodes(0)
+    , aborted(false)
+    , prefetch(true)
+    , anytime(nullptr)
+    , improved(nullptr)
+    , best(nullptr)
+{
+}
+
+void Solver::warmUp() {
+    tables();
+}
+
+bool Solver::solve(const Cube& cube, const SolveOptions& options, Solution& out) {
+    CubieCube cubies;
+    StateValidation validation = faceletsToCubie(cube.getFacelets(), cubies);
+    if (!validation.ok()) {
+        throw CubeException(std::string("Cannot solve: ") + validation.message());
+    }
+    return solve(cubies, options, out);
+}
+
+bool Solver::solve(const CubieCube& cube, const SolveOptions& options, Solution& out) {
+    maxLength = std::min(options.maxLength, MAX_SOLUTION_LENGTH);
+    maxNodes = options.maxNodes;
+    prefetch = options.prefetch;
+    anytime = nullptr;
+    return search(cube, out);
+}
+
+// Every solution phase 2 completes lowers maxLength below it, so the rest
+// of the search only looks for shorter ones
+bool Solver::solveAnytime(const CubieCube& cube, const AnytimeOptions& options, Solution& out,
+                          const ImprovementCallback& improvedCallback) {
+    maxLength = std::min(options.maxLength, MAX_SOLUTION_LENGTH);
+    maxNodes = options.maxNodes;
+    prefetch = true;
+    anytime = &options;
+    improved = improvedCallback ? &improvedCallback : nullptr;
+    best = &out;
+    bool found = search(cube, out);
+    anytime = nullptr;
+    return found;
+}
+
+bool Solver::search(const CubieCube& cube, Solution& out) {
+    const SolverTables& t = tables();
+    CUBE_METRIC_ADD(Counter::SOLVES, 1);
+#ifdef CUBE_METRICS
+    // Phase 2 is timed where it starts; phase 1 gets the remainder
+    auto& phase2Nanos = metrics::local().counters[static_cast<int>(Counter::PHASE2_NANOS)];
+    uint64_t phase2Before = phase2Nanos.load(std::memory_order_relaxed);
+    auto solveStart = std::chrono::steady_clock::now();
+#endif
+    start = cube;
+    nodes = 0;
+    aborted = false;
+    out.length = -1;
+
+    Phase1Node& root = phase1Nodes[0];
+    root.twist = static_cast<uint16_t>(cube.twist());
+    root.flip = static_cast<uint16_t>(cube.flip());
+    root.slice = static_cast<uint16_t>(cube.sliceSorted());
+    root.move = NO_MOVE;
+
+    bool found = false;
+    for (int depth = phase1Bound(t, root.twist, root.flip, root.slice);
+         depth <= maxLength && !found && !aborted; depth++) {
+        found = searchPhase1(0, depth);
+    }
+
+#ifdef CUBE_METRICS
+    uint64_t total = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - solveStart).count());
+    uint64_t phase2 = phase2Nanos.load(std::memory_order_relaxed) - phase2Before;
+    metrics::add(Counter::PHASE1_NANOS, total > phase2 ? total - phase2 : 0);
+#endif
+
+    out.nodes = nodes;
+    if (anytime) {
+        return out.found();
+    }
+    if (found) {
+        int length = 0;
+        for (int i = 1; i <= phase1Length; i++) {
+            out.moves[length++] = phase1Nodes[i].move;
+        }
+        for (int i = 1; i <= phase2Length; i++) {
+            out.moves[length++] = phase2Nodes[i].move;
+        }
+        out.length = length;
+    }
+    return found;
+}
+
+bool Solver::countNode(int depth) {
+    CUBE_METRIC_NODE(depth);
+    nodes++;
+    if (maxNodes != 0 && nodes > maxNodes) {
+        aborted = true;
+    } else if (anytime && (nodes & 1023) == 0) {
+        aborted = std::chrono::steady_clock::now() >= anytime->deadline ||
+                  (anytime->cancel && anytime->cancel->load(std::memory_order_relaxed));
+    }
+    return !aborted;
+}
+
+bool Solver::searchPhase1(int depth, int togo) {
+    const Phase1Node& node = phase1Nodes[depth];
+    if (togo == 0) {
+        // A phase 1 solution ending in a phase 2 move is a longer version
+        // of one already tried at a smaller depth
+        if (depth > 0 && isPhase2Move(node.move)) {
+            return false;
+        }
+        return startPhase2(depth);
+    }
+
+    // Every child first, prefetching its pruning entries, then the probes:
+    // the cache misses of the children overlap instead of stalling the
+    // search one after another
+    const SolverTables& t = tables();
+    Phase1Node children[NUM_MOVES];
+    int count = 0;
+    for (int m = 0; m < NUM_MOVES; m++) {
+        if (!canFollow(node.move, m)) {
+            continue;
+        }
+        Phase1Node& child = children[count++];
+        child.twist = t.twistMove[node.twist * NUM_MOVES + m];
+        child.flip = t.flipMove[node.flip * NUM_MOVES + m];
+        child.slice = t.sliceSortedMove[node.slice * NUM_MOVES + m];
+        child.move = static_cast<uint8_t>(m);
+        if (prefetch) {
+            prefetchPhase1Bound(t, child.twist, child.flip, child.slice);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!countNode(depth + 1)) {
+            return false;
+        }
+        const Phase1Node& child = children[i];
+        CUBE_METRIC_ADD(Counter::PRUNE_LOOKUPS, 1);
+        if (phase1Bound(t, child.twist, child.flip, child.slice) >= togo) {
+            continue;
+        }
+        CUBE_METRIC_ADD(Counter::PRUNE_MISSES, 1);
+        phase1Nodes[depth + 1] = child;
+        if (searchPhase1(depth + 1, togo - 1)) {
+            return true;
+        }
+        if (aborted) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool Solver::startPhase2(int depth1) {
+    const SolverTables& t = tables();
+    CUBE_METRIC_ADD(Counter::PHASE2_STARTS, 1);
+    CUBE_METRIC_TIMER(timer, Counter::PHASE2_NANOS);
+    phase1Length = depth1;
+    CubieCube cube = start;
+    for (int i = 1; i <= depth1; i++) {
+        cube.applyMove(phase1Nodes[i].move);
+    }
+
+    Phase2Node& root = phase2Nodes[0];
+    root.corners = static_cast<uint16_t>(cube.cornerPerm());
+    root.edges = static_cast<uint16_t>(cube.udEdgePerm());
+    root.slice = static_cast<uint8_t>(phase1Nodes[depth1].slice);
+    root.move = phase1Nodes[depth1].move;
+
+    int maxDepth2 = maxLength - depth1;
+    for (int depth = phase2Bound(t, root.corners, root.edges, root.slice); depth <= maxDepth2; depth++) {
+        if (searchPhase2(0, depth)) {
+            phase2Length = depth;
+            return anytime ? improve() : true;
+        }
+        if (aborted) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// Keep the solution just found as the best so far; true if it is short
+// enough to stop
+bool Solver::improve() {
+    int length = 0;
+    for (int i = 1; i <= phase1Length; i++) {
+        best->moves[length++] = phase1Nodes[i].move;
+    }
+    for (int i = 1; i <= phase2Length; i++) {
+        best->moves[length++] = phase2Nodes[i].move;
+    }
+    best->length = length;
+    best->nodes = nodes;
+    maxLength = length - 1;
+    if (improved) {
+        (*improved)(*best);
+    }
+    return length <= anytime->targetLength;
+}
+
+bool Solver::searchPhase2(int depth, int togo) {
+    if (togo == 0) {
+        return true;
+    }
+
+    const SolverTables& t = tables();
+    const Phase2Node& node = phase2Nodes[depth];
+    Phase2Node children[NUM_PHASE2_MOVES];
+    int count = 0;
+    for (int m : PHASE2_MOVES) {
+        if (!canFollow(node.move, m)) {
+            continue;
+        }
+        Phase2Node& child = children[count++];
+        child.corners = t.cornerMove[node.corners * NUM_MOVES + m];
+        child.edges = t.udEdgeMove[node.edges * NUM_MOVES + m];
+        child.slice = static_cast<uint8_t>(t.sliceSortedMove[node.slice * NUM_MOVES + m]);
+        child.move = static_cast<uint8_t>(m);
+        if (prefetch) {
+            prefetchPhase2Bound(t, child.corners, child.edges, child.slice);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!countNode(phase1Length + depth + 1)) {
+            return false;
+        }
+        const Phase2Node& child = children[i];
+        CUBE_METRIC_ADD(Counter::PRUNE_LOOKUPS, 1);
+        if (phase2Bound(t, child.corners, child.edges, child.slice) >= togo) {
+            continue;
+        }
+        CUBE_METRIC_ADD(Counter::PRUNE_MISSES, 1);
+        phase2Nodes[depth + 1] = child;
+        if (searchPhase2(depth + 1, togo - 1)) {
+            return true;
+        }
+        if (aborted) {
+            return false;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,104 @@
+#ifndef RUBIKSCUBE_SOLVER_H
+#define RUBIKSCUBE_SOLVER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "cubie.h"
+
+constexpr int MAX_SOLUTION_LENGTH = 31;
+
+// Fixed-size solution record, so filling one never allocates
+struct Solution {
+    std::array<uint8_t, MAX_SOLUTION_LENGTH> moves{};
+    int length = -1;     // -1 when no solution was found
+    uint64_t nodes = 0;  // search nodes expanded
+
+    bool found() const { return length >= 0; }
+    std::string toString() const;  // "R U F2 ..."; allocates, display only
+};
+
+struct SolveOptions {
+    int maxLength = 22;     // return the first solution at most this long
+    uint64_t maxNodes = 0;  // give up after this many nodes, 0 = no limit
+    bool prefetch = true;   // prefetch pruning entries of all children before probing
+};
+
+// Anytime search: the first solution comes quickly and is usually 21-23
+// moves; the search then keeps looking for shorter ones until one is at
+// most targetLength, the deadline passes, the node budget runs out, or
+// cancel is set
+struct AnytimeOptions {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    uint64_t maxNodes = 0;           // 0 = no limit
+    int targetLength = 20;           // good enough; 0 = keep improving
+    int maxLength = MAX_SOLUTION_LENGTH;
+    const std::atomic<bool>* cancel = nullptr;
+};
+
+// Called on the searching thread with each shorter solution
+using ImprovementCallback = std::function<void(const Solution&)>;
+
+// Two-phase (Kociemba) solver. The move and pruning tables are shared by
+// all instances and built once. Each instance searches on its own
+// preallocated stack of fixed-size nodes, so use one Solver per thread:
+// solve() does no heap allocation after warmUp().
+class Solver {
+public:
+    Solver();
+
+    // Build the shared tables now instead of on the first solve
+    static void warmUp();
+
+    bool solve(const CubieCube& cube, const SolveOptions& options, Solution& out);
+    // Throws CubeException if the cube is not in a reachable state
+    bool solve(const Cube& cube, const SolveOptions& options, Solution& out);
+
+    // Shortest solution found within the options' budget; false if none
+    // was found in time. improved, if set, sees every solution found,
+    // each shorter than the last.
+    bool solveAnytime(const CubieCube& cube, const AnytimeOptions& options, Solution& out,
+                      const ImprovementCallback& improved = nullptr);
+
+private:
+    struct Phase1Node {
+        uint16_t twist;
+        uint16_t flip;
+        uint16_t slice;  // sliceSorted coordinate
+        uint8_t move;    // move that led here
+    };
+
+    struct Phase2Node {
+        uint16_t corners;
+        uint16_t edges;
+        uint8_t slice;
+        uint8_t move;
+    };
+
+    bool search(const CubieCube& cube, Solution& out);
+    bool improve();
+    bool searchPhase1(int depth, int togo);
+    bool startPhase2(int depth1);
+    bool searchPhase2(int depth, int togo);
+    bool countNode(int depth);
+
+    std::array<Phase1Node, MAX_SOLUTION_LENGTH + 1> phase1Nodes;
+    std::array<Phase2Node, MAX_SOLUTION_LENGTH + 1> phase2Nodes;
+    CubieCube start;
+    int maxLength;
+    int phase1Length;
+    int phase2Length;
+    uint64_t maxNodes;
+    uint64_t nodes;
+    bool aborted;
+    bool prefetch;
+    // Set during solveAnytime()
+    const AnytimeOptions* anytime;
+    const ImprovementCallback* improved;
+    Solution* best;
+};
+
+#endif
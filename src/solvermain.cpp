@@ -0,0 +1,997 @@
+// Headless command-line front end to the solver, step solver, datasets,
+// last-layer tables and renderer
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "anytimesolve.h"
+#include "dataset.h"
+#include "datasetreader.h"
+#include "framewriter.h"
+#include "lastlayer.h"
+#include "metrics.h"
+#include "movesequence.h"
+#include "patternsearch.h"
+#include "photoimport.h"
+#include "shardedjob.h"
+#include "softwarerenderer.h"
+#include "stepsolver.h"
+#include "solverservice.h"
+
+namespace {
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: RubiksCubeSolver <command> [options]\n"
+        "\n"
+        "commands:\n"
+        "  solve  [--max-length N] [--max-nodes N] [--metrics text|json]\n"
+        "         [state...]\n"
+        "         solve the given states, or one state per line of stdin\n"
+        "  anytime --budget-us N [--target N] [--improve-us N] [--max-nodes N]\n"
+        "         [state...]\n"
+        "         the shortest solution found within N microseconds, stopping\n"
+        "         early at --target moves (default 20); with --improve-us, also\n"
+        "         the best found by the end of that much more time\n"
+        "  anytime --budget-us N --count N [--target N] [--seed N] [--threads N]\n"
+        "         solve N random scrambles with that budget and print solution\n"
+        "         quality against time, and time-to-solution percentiles\n"
+        "  serve  (--socket PATH | --port N) [--workers N] [--queue N]\n"
+        "         [--connections N] [--max-length N] [--max-nodes N]\n"
+        "         run the solver service until interrupted\n"
+        "  generate --out FILE --count N [--chunk N] [--seed N] [--threads N]\n"
+        "         [--max-length N] [--max-nodes N]\n"
+        "         write random states and their solutions to a binary\n"
+        "         dataset, resuming FILE if it holds an earlier partial run\n"
+        "  distribute --in FILE --job DIR --out FILE [--workers N] [--shard N]\n"
+        "         [--lease SECONDS] [--max-length N] [--max-nodes N]\n"
+        "         split the states in FILE into shards under DIR, solve them\n"
+        "         with N local worker processes and merge the solutions into\n"
+        "         --out in input order; rerun to resume an interrupted job\n"
+        "  work   --job DIR [--max-length N] [--max-nodes N]\n"
+        "         solve shards of a job until none are left, e.g. on another\n"
+        "         machine that shares the job directory\n"
+        "  query  --in FILE (--histogram yes | --length N [--limit N])\n"
+        "         print the solution length histogram of a dataset, or the\n"
+        "         records with a given length (-1 = unsolved)\n"
+        "  lltable --set oll|pll|zbll --out FILE [--max-length N] [--threads N]\n"
+        "         search an optimal algorithm for every last-layer case of the\n"
+        "         set and save the table\n"
+        "  llsolve --table FILE [state...]\n"
+        "         look up the algorithm for states, or one per line of stdin,\n"
+        "         whose first two layers are solved\n"
+        "  steps  --oll FILE --pll FILE [state...]\n"
+        "         solve states, or one per line of stdin, step by step (CFOP)\n"
+        "         and print each step's moves\n"
+        "  steps  --oll FILE --pll FILE --count N [--seed N] [--threads N]\n"
+        "         [--csv FILE]\n"
+        "         solve N random scrambles step by step and print move count\n"
+        "         statistics per step, and optionally every scramble's counts\n"
+        "  simplify [--depth N] [--window N] [sequence...]\n"
+        "         merge and cancel redundant moves in sequences, or one per\n"
+        "         line of stdin; with --depth (1-5), also replace windows by\n"
+        "         shorter equivalents from an optimal table of that depth\n"
+        "  pattern --target PATTERN [--solutions N] [--max-length N] [--max-nodes N]\n"
+        "         [--metrics text|json] [state...]\n"
+        "         shortest move sequences from states, or one per line of stdin,\n"
+        "         to PATTERN: solved, checkerboard, superflip, cross, or 54\n"
+        "         colour letters with '.' for stickers that may be any colour;\n"
+        "         a full state (no '.') gets one two-phase solution instead,\n"
+        "         near-shortest but not proven shortest\n"
+        "  import [--threads N] [--min-confidence X]\n"
+        "         read cubes from photos, one line of six PNG or PPM paths per\n"
+        "         cube on stdin in face order F B L R U D, and print each state,\n"
+        "         followed by the faces to check if any sticker was doubtful\n"
+        "  render (--out PREFIX | --raw FILE) [--state S] [--moves \"R U ...\"]\n"
+        "         [--solve yes] [--width N] [--height N] [--samples N]\n"
+        "         [--frames-per-move N] [--hold N] [--threads N]\n"
+        "         animate the moves (or, with --solve, the solution) on the\n"
+        "         state without a display, as PREFIX00000.png... or raw RGB24\n"
+        "         frames to FILE ('-' = stdout)\n"
+        "  client (--socket PATH | --port N)\n"
+        "         send '<state> [maxLength=N] [maxNodes=N] [budgetUs=N] [target=N]'\n"
+        "         lines from stdin to a running service and print its replies\n"
+        "\n"
+        "--metrics prints the solver counters to stderr when done.\n");
+}
+
+// An option value that does not parse; main() reports it as a usage error
+struct UsageError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// Splits "--name value" pairs; anything else is a positional argument
+struct Arguments {
+    std::map<std::string, std::string> options;
+    std::vector<std::string> positional;
+
+    bool parse(int argc, char* argv[], int first) {
+        for (int i = first; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.compare(0, 2, "--") == 0) {
+                if (i + 1 >= argc) {
+                    std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+                    return false;
+                }
+                options[arg.substr(2)] = argv[++i];
+            } else {
+                positional.push_back(arg);
+            }
+        }
+        return true;
+    }
+
+    bool has(const std::string& name) const { return options.count(name) != 0; }
+
+    std::string get(const std::string& name, const std::string& fallback = "") const {
+        auto it = options.find(name);
+        return it == options.end() ? fallback : it->second;
+    }
+
+    // Throws UsageError unless the whole value is a number in range
+    long long getInt(const std::string& name, long long fallback) const {
+        auto it = options.find(name);
+        if (it == options.end()) {
+            return fallback;
+        }
+        const char* text = it->second.c_str();
+        char* end;
+        errno = 0;
+        long long value = std::strtoll(text, &end, 10);
+        if (end == text || *end != '\0' || errno == ERANGE) {
+            throw UsageError("--" + name + " expects an integer, not '" + it->second + "'");
+        }
+        return value;
+    }
+
+    double getDouble(const std::string& name, double fallback) const {
+        auto it = options.find(name);
+        if (it == options.end()) {
+            return fallback;
+        }
+        const char* text = it->second.c_str();
+        char* end;
+        errno = 0;
+        double value = std::strtod(text, &end);
+        if (end == text || *end != '\0' || errno == ERANGE) {
+            throw UsageError("--" + name + " expects a number, not '" + it->second + "'");
+        }
+        return value;
+    }
+};
+
+SolveOptions solveOptions(const Arguments& args) {
+    SolveOptions options;
+    options.maxLength = static_cast<int>(args.getInt("max-length", options.maxLength));
+    options.maxNodes = static_cast<uint64_t>(args.getInt("max-nodes", 0));
+    return options;
+}
+
+void printMetrics(const Arguments& args) {
+    std::string format = args.get("metrics");
+    if (format == "text") {
+        std::fprintf(stderr, "%s", metrics::snapshot().toText().c_str());
+    } else if (format == "json") {
+        std::fprintf(stderr, "%s\n", metrics::snapshot().toJson().c_str());
+    }
+}
+
+int runSolve(const Arguments& args) {
+    SolveOptions options = solveOptions(args);
+    Solver solver;
+    Solution solution;
+    int failures = 0;
+    auto solveOne = [&](const std::string& state) {
+        Cube cube;
+        if (!cube.setState(state)) {
+            std::printf("error: %s\n", Cube::validate(state).message());
+            failures++;
+        } else if (solver.solve(cube, options, solution)) {
+            std::printf("%s\n", solution.toString().c_str());
+        } else {
+            std::printf("no solution within %d moves\n", options.maxLength);
+            failures++;
+        }
+    };
+
+    if (!args.positional.empty()) {
+        for (const std::string& state : args.positional) {
+            solveOne(state);
+        }
+    } else {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty()) {
+                solveOne(line);
+            }
+        }
+    }
+    printMetrics(args);
+    return failures == 0 ? 0 : 1;
+}
+
+void printAnytimeProfile(const AnytimeProfile& profile, int targetLength) {
+    std::printf("%10s %7s %7s %7s\n", "us", "solved", "mean", ("<=" + std::to_string(targetLength)).c_str());
+    for (const AnytimeCheckpoint& checkpoint : profile.checkpoints) {
+        std::printf("%10llu %7.3f %7.2f %7.3f\n", static_cast<unsigned long long>(checkpoint.micros),
+                    checkpoint.solved, checkpoint.meanLength, checkpoint.atTarget);
+    }
+    std::printf("first solution p50 %llu us, p99 %llu us\n", static_cast<unsigned long long>(profile.firstP50),
+                static_cast<unsigned long long>(profile.firstP99));
+    std::printf("stopped        p50 %llu us, p99 %llu us, max %llu us\n",
+                static_cast<unsigned long long>(profile.stopP50), static_cast<unsigned long long>(profile.stopP99),
+                static_cast<unsigned long long>(profile.stopMax));
+}
+
+// The solution found within --budget-us per state and, with --improve-us,
+// a second line with the best found by the end of the extra time
+int runAnytime(const Arguments& args) {
+    if (!args.has("budget-us")) {
+        usage();
+        return 2;
+    }
+    std::chrono::microseconds budget(args.getInt("budget-us", 0));
+    int targetLength = static_cast<int>(args.getInt("target", 20));
+    uint64_t maxNodes = static_cast<uint64_t>(args.getInt("max-nodes", 0));
+
+    if (args.has("count")) {
+        AnytimeProfileOptions options;
+        options.count = static_cast<uint64_t>(args.getInt("count", 0));
+        options.seed = static_cast<uint64_t>(args.getInt("seed", static_cast<long long>(options.seed)));
+        options.threads = static_cast<int>(args.getInt("threads", 0));
+        options.budget = budget;
+        options.targetLength = targetLength;
+        options.maxNodes = maxNodes;
+        AnytimeProfile profile = profileAnytime(options, [](uint64_t done, uint64_t total) {
+            std::fprintf(stderr, "\r%llu / %llu scrambles", static_cast<unsigned long long>(done),
+                         static_cast<unsigned long long>(total));
+        });
+        std::fprintf(stderr, "\n");
+        printAnytimeProfile(profile, targetLength);
+        printMetrics(args);
+        return 0;
+    }
+
+    AnytimeSolveOptions options;
+    options.budget = budget;
+    options.improveFor = std::chrono::microseconds(args.getInt("improve-us", 0));
+    options.targetLength = targetLength;
+    options.maxNodes = maxNodes;
+    Solver::warmUp();
+    Solution solution;
+    int failures = 0;
+    auto solveOne = [&](const std::string& state) {
+        Cube cube;
+        if (!cube.setState(state)) {
+            std::printf("error: %s\n", Cube::validate(state).message());
+            failures++;
+            return;
+        }
+        CubieCube cubie;
+        faceletsToCubie(cube.getFacelets(), cubie);
+        AnytimeSolve solve(cubie, options);
+        if (solve.answer(solution)) {
+            std::printf("%s\n", solution.toString().c_str());
+        } else {
+            std::printf("no solution within %lld us\n", static_cast<long long>(budget.count()));
+            failures++;
+        }
+        if (options.improveFor.count() > 0) {
+            solve.finish(solution);
+            std::printf("improved: %s\n", solution.toString().c_str());
+        }
+    };
+
+    if (!args.positional.empty()) {
+        for (const std::string& state : args.positional) {
+            solveOne(state);
+        }
+    } else {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty()) {
+                solveOne(line);
+            }
+        }
+    }
+    printMetrics(args);
+    return failures == 0 ? 0 : 1;
+}
+
+int runServe(const Arguments& args) {
+    ServiceOptions options;
+    options.socketPath = args.get("socket");
+    options.port = static_cast<int>(args.getInt("port", 0));
+    options.workers = static_cast<int>(args.getInt("workers", 0));
+    options.queueCapacity = static_cast<size_t>(args.getInt("queue", static_cast<long long>(options.queueCapacity)));
+    options.maxConnections = static_cast<int>(args.getInt("connections", options.maxConnections));
+    options.solveDefaults = solveOptions(args);
+    if (options.socketPath.empty() && !args.has("port")) {
+        usage();
+        return 2;
+    }
+
+    // Block the shutdown signals in every thread and take them here
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    SolverService service(options);
+    service.start();
+    if (options.socketPath.empty()) {
+        std::fprintf(stderr, "listening on 127.0.0.1:%d\n", service.boundPort());
+    } else {
+        std::fprintf(stderr, "listening on %s\n", options.socketPath.c_str());
+    }
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    service.stop();
+    return 0;
+}
+
+int runGenerate(const Arguments& args) {
+    DatasetOptions options;
+    options.path = args.get("out");
+    options.records = static_cast<uint64_t>(args.getInt("count", 0));
+    options.chunkRecords = static_cast<uint32_t>(args.getInt("chunk", options.chunkRecords));
+    options.seed = static_cast<uint64_t>(args.getInt("seed", static_cast<long long>(options.seed)));
+    options.threads = static_cast<int>(args.getInt("threads", 0));
+    options.solve = solveOptions(args);
+    if (options.path.empty() || options.records == 0) {
+        usage();
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t generated = generateDataset(options, [&](uint64_t done, uint64_t total) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::fprintf(stderr, "\r%llu / %llu records (%.0f/s)", static_cast<unsigned long long>(done),
+                     static_cast<unsigned long long>(total), seconds > 0 ? done / seconds : 0.0);
+    });
+    std::fprintf(stderr, "\n%llu records generated\n", static_cast<unsigned long long>(generated));
+    printMetrics(args);
+    return 0;
+}
+
+int runWork(const Arguments& args) {
+    if (!args.has("job")) {
+        usage();
+        return 2;
+    }
+    ShardedJob job = ShardedJob::open(args.get("job"));
+    int solved = job.work(solveOptions(args), localWorkerId(getpid()));
+    std::fprintf(stderr, "%d shards solved\n", solved);
+    return 0;
+}
+
+// Worker processes are forked from the coordinator. When one dies, its
+// claim goes back to todo and, while there is work left, a new worker
+// takes its place; workers on other machines can join with "work".
+int runDistribute(const Arguments& args) {
+    if (!args.has("in") || !args.has("job") || !args.has("out")) {
+        usage();
+        return 2;
+    }
+    const int workers = static_cast<int>(args.getInt("workers", std::max(1u, std::thread::hardware_concurrency())));
+    const double lease = static_cast<double>(args.getInt("lease", 600));
+    const SolveOptions options = solveOptions(args);
+    ShardedJob job = ShardedJob::create(args.get("job"), args.get("in"), static_cast<int>(args.getInt("shard", 1000)));
+    // Built once here, the tables are shared copy-on-write by every worker
+    Solver::warmUp();
+
+    std::vector<pid_t> children;
+    int crashes = 0;
+    auto spawn = [&] {
+        std::fflush(nullptr);
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw CubeException(std::string("Cannot start a worker: ") + std::strerror(errno));
+        }
+        if (pid == 0) {
+            int status = 0;
+            try {
+                job.work(options, localWorkerId(getpid()));
+            } catch (const CubeException& e) {
+                std::fprintf(stderr, "\nworker %d: %s\n", getpid(), e.what());
+                status = 1;
+            }
+            std::fflush(nullptr);
+            _exit(status);
+        }
+        children.push_back(pid);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        int status = 0;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            children.erase(std::remove(children.begin(), children.end(), pid), children.end());
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::fprintf(stderr, "\nworker %d failed; requeueing its shard\n", pid);
+                crashes++;
+            }
+        }
+        job.requeue(lease);
+        JobProgress progress = job.progress();
+        std::fprintf(stderr, "\r%d / %d shards done, %d running", progress.done, progress.shards, progress.running);
+        if (progress.done == progress.shards) {
+            break;
+        }
+        // A worker that fails every time would otherwise be restarted forever
+        if (progress.todo > 0 && crashes <= 3 * workers) {
+            while (static_cast<int>(children.size()) < workers) {
+                spawn();
+            }
+        }
+        if (children.empty() && progress.running == 0 && crashes > 3 * workers) {
+            throw CubeException("Workers keep failing; giving up");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    for (pid_t child : children) {
+        waitpid(child, nullptr, 0);
+    }
+
+    job.merge(args.get("out"));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "\n%llu states solved in %.1f s\n", static_cast<unsigned long long>(job.stateCount()), seconds);
+    return 0;
+}
+
+int runQuery(const Arguments& args) {
+    if (!args.has("in") || (!args.has("histogram") && !args.has("length"))) {
+        usage();
+        return 2;
+    }
+    DatasetReader reader(args.get("in"));
+    int threads = static_cast<int>(args.getInt("threads", 0));
+
+    if (args.has("histogram")) {
+        auto histogram = reader.lengthHistogram(threads);
+        for (size_t length = 0; length + 1 < histogram.size(); length++) {
+            if (histogram[length] != 0) {
+                std::printf("%2zu %llu\n", length, static_cast<unsigned long long>(histogram[length]));
+            }
+        }
+        if (histogram.back() != 0) {
+            std::printf("unsolved %llu\n", static_cast<unsigned long long>(histogram.back()));
+        }
+        return 0;
+    }
+
+    std::vector<uint64_t> matches = reader.findByLength(static_cast<int>(args.getInt("length", 0)), threads);
+    uint64_t limit = static_cast<uint64_t>(args.getInt("limit", static_cast<long long>(matches.size())));
+    std::fprintf(stderr, "%zu matching records\n", matches.size());
+    Solution solution;
+    for (uint64_t i = 0; i < matches.size() && i < limit; i++) {
+        DatasetRecord record = reader.record(matches[i]);
+        solution.length = record.length;
+        std::copy(record.moves.begin(), record.moves.end(), solution.moves.begin());
+        std::printf("%llu %s %s\n", static_cast<unsigned long long>(matches[i]),
+                    reader.cube(matches[i]).getState().c_str(), solution.toString().c_str());
+    }
+    return 0;
+}
+
+int runLastLayerTable(const Arguments& args) {
+    LastLayerSet set;
+    if (!args.has("out") || !parseLastLayerSet(args.get("set"), set)) {
+        usage();
+        return 2;
+    }
+    LastLayerOptions options;
+    options.maxLength = static_cast<int>(args.getInt("max-length", options.maxLength));
+    options.threads = static_cast<int>(args.getInt("threads", 0));
+
+    auto start = std::chrono::steady_clock::now();
+    LastLayerTable table = LastLayerTable::generate(set, options, [](int done, int total) {
+        std::fprintf(stderr, "\r%d / %d cases", done, total);
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "\r%d cases, %d states in %.1f s\n", table.caseCount(), table.stateCount(), seconds);
+    table.save(args.get("out"));
+    return 0;
+}
+
+int runLastLayerSolve(const Arguments& args) {
+    if (!args.has("table")) {
+        usage();
+        return 2;
+    }
+    LastLayerTable table = LastLayerTable::load(args.get("table"));
+    Solution solution;
+    int failures = 0;
+    auto solveOne = [&](const std::string& state) {
+        Cube cube;
+        if (!cube.setState(state)) {
+            std::printf("error: %s\n", Cube::validate(state).message());
+            failures++;
+        } else if (table.lookup(cube, solution) >= 0) {
+            std::printf("%s\n", solution.toString().c_str());
+        } else {
+            std::printf("not a %s case\n", lastLayerSetName(table.set()));
+            failures++;
+        }
+    };
+
+    if (!args.positional.empty()) {
+        for (const std::string& state : args.positional) {
+            solveOne(state);
+        }
+    } else {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty()) {
+                solveOne(line);
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// Statistics over the solved scrambles; returns the number that failed
+uint64_t printStepStatistics(const std::vector<uint8_t>& lengths, uint64_t count) {
+    uint64_t failed = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        failed += lengths[i * NUM_CFOP_STEPS] == STEP_FAILED ? 1 : 0;
+    }
+    const uint64_t solved = count - failed;
+    std::printf("%-6s %7s %4s %4s\n", "step", "mean", "min", "max");
+    for (int step = 0; step <= NUM_CFOP_STEPS; step++) {
+        uint64_t sum = 0;
+        int least = 255;
+        int most = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            if (lengths[i * NUM_CFOP_STEPS] == STEP_FAILED) {
+                continue;
+            }
+            int length = 0;
+            if (step < NUM_CFOP_STEPS) {
+                length = lengths[i * NUM_CFOP_STEPS + step];
+            } else {
+                for (int k = 0; k < NUM_CFOP_STEPS; k++) {
+                    length += lengths[i * NUM_CFOP_STEPS + k];
+                }
+            }
+            sum += length;
+            least = std::min(least, length);
+            most = std::max(most, length);
+        }
+        std::printf("%-6s %7.2f %4d %4d\n", step < NUM_CFOP_STEPS ? cfopStepName(static_cast<CfopStep>(step)) : "total",
+                    solved ? double(sum) / solved : 0.0, solved ? least : 0, most);
+    }
+    if (failed > 0) {
+        std::printf("failed %llu scrambles\n", static_cast<unsigned long long>(failed));
+    }
+    return failed;
+}
+
+int runSteps(const Arguments& args) {
+    if (!args.has("oll") || !args.has("pll")) {
+        usage();
+        return 2;
+    }
+    LastLayerTable oll = LastLayerTable::load(args.get("oll"));
+    LastLayerTable pll = LastLayerTable::load(args.get("pll"));
+
+    if (args.has("count")) {
+        StepBatchOptions options;
+        options.count = static_cast<uint64_t>(args.getInt("count", 0));
+        options.seed = static_cast<uint64_t>(args.getInt("seed", static_cast<long long>(options.seed)));
+        options.threads = static_cast<int>(args.getInt("threads", 0));
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint8_t> lengths = solveStepBatch(oll, pll, options, [](uint64_t done, uint64_t total) {
+            std::fprintf(stderr, "\r%llu / %llu scrambles", static_cast<unsigned long long>(done),
+                         static_cast<unsigned long long>(total));
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::fprintf(stderr, "\n%llu scrambles in %.1f s (%.0f/s)\n", static_cast<unsigned long long>(options.count),
+                     seconds, seconds > 0 ? options.count / seconds : 0.0);
+
+        if (args.has("csv")) {
+            std::FILE* csv = std::fopen(args.get("csv").c_str(), "w");
+            if (!csv) {
+                throw CubeException("Cannot open " + args.get("csv") + ": " + std::strerror(errno));
+            }
+            for (int step = 0; step < NUM_CFOP_STEPS; step++) {
+                std::fprintf(csv, "%s,", cfopStepName(static_cast<CfopStep>(step)));
+            }
+            std::fprintf(csv, "total\n");
+            for (uint64_t i = 0; i < options.count; i++) {
+                if (lengths[i * NUM_CFOP_STEPS] == STEP_FAILED) {
+                    std::fprintf(csv, "%sfailed\n", std::string(NUM_CFOP_STEPS, ',').c_str());
+                    continue;
+                }
+                int total = 0;
+                for (int step = 0; step < NUM_CFOP_STEPS; step++) {
+                    total += lengths[i * NUM_CFOP_STEPS + step];
+                    std::fprintf(csv, "%d,", lengths[i * NUM_CFOP_STEPS + step]);
+                }
+                std::fprintf(csv, "%d\n", total);
+            }
+            if (std::fclose(csv) != 0) {
+                throw CubeException("Cannot write " + args.get("csv"));
+            }
+        }
+        return printStepStatistics(lengths, options.count) == 0 ? 0 : 1;
+    }
+
+    StepSolver solver(oll, pll);
+    StepSolution solution;
+    int failures = 0;
+    auto solveOne = [&](const std::string& state) {
+        Cube cube;
+        if (!cube.setState(state)) {
+            std::printf("error: %s\n", Cube::validate(state).message());
+            failures++;
+        } else if (solver.solve(cube, solution)) {
+            std::printf("%s\n", solution.toString().c_str());
+        } else {
+            std::printf("step solver failed\n");
+            failures++;
+        }
+    };
+
+    if (!args.positional.empty()) {
+        for (const std::string& state : args.positional) {
+            solveOne(state);
+        }
+    } else {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty()) {
+                solveOne(line);
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+int runSimplify(const Arguments& args) {
+    std::unique_ptr<SequenceOptimizer> optimizer;
+    if (args.has("depth")) {
+        optimizer.reset(new SequenceOptimizer(static_cast<int>(args.getInt("depth", MAX_WINDOW_DEPTH))));
+    }
+    int window = static_cast<int>(args.getInt("window", 0));
+    std::vector<uint8_t> moves;
+    int failures = 0;
+    auto simplifyOne = [&](const std::string& sequence) {
+        if (!parseMoves(sequence, moves)) {
+            std::printf("error: not a move sequence: %s\n", sequence.c_str());
+            failures++;
+            return;
+        }
+        int length = static_cast<int>(moves.size());
+        length = optimizer ? optimizer->optimize(moves.data(), length, window) : simplifyMoves(moves.data(), length);
+        std::printf("%s\n", movesToString(moves.data(), length).c_str());
+    };
+
+    if (!args.positional.empty()) {
+        for (const std::string& sequence : args.positional) {
+            simplifyOne(sequence);
+        }
+    } else {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            simplifyOne(line);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// Up to --solutions shortest sequences per state, separated by "; "
+int runPattern(const Arguments& args) {
+    if (!args.has("target")) {
+        usage();
+        return 2;
+    }
+    PatternSearchOptions options;
+    options.maxLength = static_cast<int>(args.getInt("max-length", options.maxLength));
+    options.maxNodes = static_cast<uint64_t>(args.getInt("max-nodes", 0));
+    options.maxSolutions = static_cast<int>(args.getInt("solutions", 1));
+    PatternSearch search(Pattern::named(args.get("target")));
+    std::vector<Solution> solutions;
+    int failures = 0;
+    auto searchOne = [&](const std::string& state) {
+        Cube cube;
+        if (!cube.setState(state)) {
+            std::printf("error: %s\n", Cube::validate(state).message());
+            failures++;
+            return;
+        }
+        if (!search.search(cube, options, solutions)) {
+            if (search.wasAborted()) {
+                std::printf("node budget exhausted\n");
+            } else {
+                std::printf("no sequence within %d moves\n", options.maxLength);
+            }
+            failures++;
+            return;
+        }
+        std::string line;
+        for (const Solution& solution : solutions) {
+            line += (line.empty() ? "" : "; ") + solution.toString();
+        }
+        std::printf("%s\n", line.c_str());
+    };
+
+    if (!args.positional.empty()) {
+        for (const std::string& state : args.positional) {
+            searchOne(state);
+        }
+    } else {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty()) {
+                searchOne(line);
+            }
+        }
+    }
+    printMetrics(args);
+    return failures == 0 ? 0 : 1;
+}
+
+// One line per cube: the state, "<state> low-confidence F U" when some
+// faces are worth a second look, or "error: <reason>"
+int runImport(const Arguments& args) {
+    PhotoImportOptions options;
+    options.threads = static_cast<int>(args.getInt("threads", 0));
+    options.minConfidence = static_cast<float>(args.getDouble("min-confidence", options.minConfidence));
+    std::vector<std::array<std::string, 6>> cubes;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream paths(line);
+        std::array<std::string, 6> cube;
+        int count = 0;
+        std::string path;
+        while (paths >> path) {
+            if (count < 6) {
+                cube[count] = path;
+            }
+            count++;
+        }
+        if (count == 0) {
+            continue;
+        }
+        if (count != 6) {
+            std::fprintf(stderr, "expected six photo paths per line, got %d: %s\n", count, line.c_str());
+            return 2;
+        }
+        cubes.push_back(cube);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<CubeReading> readings = importPhotos(cubes, options, [](uint64_t done, uint64_t total) {
+        std::fprintf(stderr, "\r%llu / %llu cubes", static_cast<unsigned long long>(done),
+                     static_cast<unsigned long long>(total));
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const char* const faceNames[6] = {"F", "B", "L", "R", "U", "D"};
+    int flagged = 0;
+    int failures = 0;
+    for (const CubeReading& reading : readings) {
+        if (!reading.ok()) {
+            std::printf("error: %s\n", reading.error.c_str());
+            failures++;
+            continue;
+        }
+        std::string text = reading.state();
+        if (reading.lowConfidenceFaces != 0) {
+            text += " low-confidence";
+            for (int face = 0; face < 6; face++) {
+                if (reading.lowConfidenceFaces & (1 << face)) {
+                    text += std::string(" ") + faceNames[face];
+                }
+            }
+            flagged++;
+        }
+        std::printf("%s\n", text.c_str());
+    }
+    std::fprintf(stderr, "\n%zu cubes in %.1f s (%.0f photos/s), %d low confidence, %d errors\n", readings.size(),
+                 seconds, seconds > 0 ? readings.size() * 6 / seconds : 0.0, flagged, failures);
+    return failures == 0 ? 0 : 1;
+}
+
+int runRender(const Arguments& args) {
+    if (args.has("out") == args.has("raw")) {
+        usage();
+        return 2;
+    }
+    Cube cube;
+    if (args.has("state") && !cube.setState(args.get("state"))) {
+        std::fprintf(stderr, "error: %s\n", Cube::validate(args.get("state")).message());
+        return 1;
+    }
+
+    std::vector<int> moves;
+    std::istringstream tokens(args.get("moves"));
+    std::string token;
+    while (tokens >> token) {
+        int move = Cube::parseMove(token);
+        if (move < 0) {
+            std::fprintf(stderr, "error: not a move: %s\n", token.c_str());
+            return 1;
+        }
+        moves.push_back(move);
+    }
+    if (args.has("solve")) {
+        Cube solved = cube;
+        for (int move : moves) {
+            solved.applyMove(move);
+        }
+        Solver solver;
+        Solution solution;
+        if (!solver.solve(solved, solveOptions(args), solution)) {
+            std::fprintf(stderr, "error: no solution within %d moves\n", solveOptions(args).maxLength);
+            return 1;
+        }
+        moves.insert(moves.end(), solution.moves.begin(), solution.moves.begin() + solution.length);
+    }
+
+    RenderOptions renderOptions;
+    renderOptions.width = static_cast<int>(args.getInt("width", renderOptions.width));
+    renderOptions.height = static_cast<int>(args.getInt("height", renderOptions.height));
+    renderOptions.samples = static_cast<int>(args.getInt("samples", renderOptions.samples));
+    SoftwareRenderer renderer(renderOptions);
+
+    AnimationOptions animation;
+    animation.framesPerMove = static_cast<int>(args.getInt("frames-per-move", animation.framesPerMove));
+    animation.holdFrames = static_cast<int>(args.getInt("hold", animation.holdFrames));
+
+    FrameWriterOptions output;
+    output.format = args.has("raw") ? FrameFormat::RAW : FrameFormat::PNG;
+    output.path = args.has("raw") ? args.get("raw") : args.get("out");
+    output.width = renderOptions.width;
+    output.height = renderOptions.height;
+    output.threads = static_cast<int>(args.getInt("threads", 0));
+    FrameWriter writer(output);
+
+    // Frames are rendered here while the writer encodes earlier ones
+    auto start = std::chrono::steady_clock::now();
+    int frames = renderAnimation(renderer, cube, moves, animation,
+                                 [&](std::vector<uint8_t>&& rgb) { writer.write(std::move(rgb)); });
+    writer.finish();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%d frames of %dx%d for %zu moves in %.2f s (%.0f frames/s)\n", frames,
+                 renderOptions.width, renderOptions.height, moves.size(), seconds,
+                 seconds > 0 ? frames / seconds : 0.0);
+    if (output.format == FrameFormat::RAW && output.path != "-") {
+        std::fprintf(stderr, "play with: ffplay -f rawvideo -pixel_format rgb24 -video_size %dx%d %s\n",
+                     renderOptions.width, renderOptions.height, output.path.c_str());
+    }
+    return 0;
+}
+
+int connectToService(const Arguments& args) {
+    std::string socketPath = args.get("socket");
+    int fd;
+    if (!socketPath.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            return fd;
+        }
+    } else {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(args.getInt("port", 0)));
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            return fd;
+        }
+    }
+    std::perror("connect");
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    return -1;
+}
+
+int runClient(const Arguments& args) {
+    if (!args.has("socket") && !args.has("port")) {
+        usage();
+        return 2;
+    }
+    int fd = connectToService(args);
+    if (fd < 0) {
+        return 1;
+    }
+
+    // Replies are printed as they arrive while requests are still going out
+    std::thread printer([fd] {
+        char chunk[4096];
+        ssize_t received;
+        while ((received = ::recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+            std::fwrite(chunk, 1, static_cast<size_t>(received), stdout);
+        }
+        std::fflush(stdout);
+    });
+
+    std::string line;
+    long long id = 0;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::string request = std::to_string(++id) + " " + line + "\n";
+        const char* data = request.data();
+        size_t remaining = request.size();
+        while (remaining > 0) {
+            ssize_t written = ::send(fd, data, remaining, 0);
+            if (written <= 0) {
+                break;
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+    }
+    ::shutdown(fd, SHUT_WR);
+    printer.join();
+    ::close(fd);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+    std::string command = argv[1];
+    Arguments args;
+    if (!args.parse(argc, argv, 2)) {
+        return 2;
+    }
+
+    try {
+        if (command == "solve") return runSolve(args);
+        if (command == "anytime") return runAnytime(args);
+        if (command == "serve") return runServe(args);
+        if (command == "client") return runClient(args);
+        if (command == "generate") return runGenerate(args);
+        if (command == "distribute") return runDistribute(args);
+        if (command == "work") return runWork(args);
+        if (command == "query") return runQuery(args);
+        if (command == "lltable") return runLastLayerTable(args);
+        if (command == "llsolve") return runLastLayerSolve(args);
+        if (command == "steps") return runSteps(args);
+        if (command == "simplify") return runSimplify(args);
+        if (command == "pattern") return runPattern(args);
+        if (command == "import") return runImport(args);
+        if (command == "render") return runRender(args);
+    } catch (const UsageError& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    } catch (const CubeException& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+    usage();
+    return 2;
+}
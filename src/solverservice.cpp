@@ -0,0 +1,387 @@
+#include "solverservice.h"
+#include "metrics.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sstream>
+
+struct SolverService::Connection {
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { ::close(fd); }
+
+    // Write one reply line; replies from different workers never interleave
+    void reply(const std::string& line, bool finishesRequest) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        const char* data = line.data();
+        size_t remaining = line.size();
+        while (remaining > 0) {
+            ssize_t written = ::send(fd, data, remaining, 0);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                break;  // client went away; nothing left to tell it
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+        if (finishesRequest) {
+            pending--;
+            closeWriteIfDone();
+        }
+    }
+
+    // Caller holds writeMutex
+    void closeWriteIfDone() {
+        if (readDone && pending == 0) {
+            ::shutdown(fd, SHUT_WR);
+        }
+    }
+
+    const int fd;
+    std::mutex writeMutex;
+    int pending = 0;        // accepted requests not yet answered
+    bool readDone = false;  // client half-closed or the read failed
+};
+
+namespace {
+
+// Far longer than any request; a client sending more without a newline is
+// not speaking the protocol and is cut off rather than buffered forever
+constexpr size_t MAX_LINE_BYTES = 4096;
+
+// Pause after an accept() failure other than EINTR, which is mostly
+// running out of descriptors and would otherwise fail again at once
+constexpr auto ACCEPT_BACKOFF = std::chrono::milliseconds(100);
+
+// Closes the descriptor on scope exit unless released
+class FdGuard {
+public:
+    explicit FdGuard(int fd) : fd(fd) {}
+    ~FdGuard() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    FdGuard(const FdGuard&) = delete;
+    FdGuard& operator=(const FdGuard&) = delete;
+
+    int get() const { return fd; }
+    int release() {
+        int result = fd;
+        fd = -1;
+        return result;
+    }
+
+private:
+    int fd;
+};
+
+// A socket file left by a service that died is removed; anything else at
+// the path, including the socket of a live service, is left alone
+void removeStaleSocket(const sockaddr_un& address) {
+    const std::string path = address.sun_path;
+    struct stat info;
+    if (::lstat(path.c_str(), &info) != 0) {
+        if (errno == ENOENT) {
+            return;
+        }
+        throw CubeException("Cannot stat " + path + ": " + std::strerror(errno));
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        throw CubeException(path + " exists and is not a socket");
+    }
+    FdGuard probe(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (probe.get() < 0) {
+        throw CubeException(std::string("Cannot create socket: ") + std::strerror(errno));
+    }
+    if (::connect(probe.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+        throw CubeException("A service is already listening on " + path);
+    }
+    if (errno != ECONNREFUSED) {
+        throw CubeException("Cannot probe " + path + ": " + std::strerror(errno));
+    }
+    ::unlink(path.c_str());
+}
+
+std::string errorReply(const std::string& id, const char* reason) {
+    return id + " ERR " + reason + "\n";
+}
+
+long long microseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+} // namespace
+
+SolverService::SolverService(const ServiceOptions& options)
+    : options(options)
+    , queue(options.queueCapacity)
+    , listenFd(-1)
+    , port(options.port)
+    , running(false)
+    , activeReaders(0)
+{
+}
+
+SolverService::~SolverService() {
+    stop();
+}
+
+void SolverService::start() {
+    Solver::warmUp();
+
+    // Replies to vanished clients must fail with EPIPE, not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (!options.socketPath.empty()) {
+        sockaddr_un address{};
+        if (options.socketPath.size() >= sizeof(address.sun_path)) {
+            throw CubeException("Socket path too long: " + options.socketPath);
+        }
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, options.socketPath.c_str(), sizeof(address.sun_path) - 1);
+        removeStaleSocket(address);
+        FdGuard fd(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (fd.get() < 0 || ::bind(fd.get(), reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            throw CubeException("Cannot bind " + options.socketPath + ": " + std::strerror(errno));
+        }
+        if (::listen(fd.get(), 64) < 0) {
+            ::unlink(options.socketPath.c_str());
+            throw CubeException(std::string("Cannot listen: ") + std::strerror(errno));
+        }
+        listenFd = fd.release();
+    } else {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(options.port));
+        FdGuard fd(::socket(AF_INET, SOCK_STREAM, 0));
+        int reuse = 1;
+        if (fd.get() >= 0) {
+            ::setsockopt(fd.get(), SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        }
+        if (fd.get() < 0 || ::bind(fd.get(), reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            throw CubeException("Cannot bind 127.0.0.1:" + std::to_string(options.port) + ": " + std::strerror(errno));
+        }
+        if (::listen(fd.get(), 64) < 0) {
+            throw CubeException(std::string("Cannot listen: ") + std::strerror(errno));
+        }
+        socklen_t length = sizeof(address);
+        ::getsockname(fd.get(), reinterpret_cast<sockaddr*>(&address), &length);
+        port = ntohs(address.sin_port);
+        listenFd = fd.release();
+    }
+
+    running = true;
+    int workerCount = options.workers > 0 ? options.workers
+                                          : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&SolverService::workerLoop, this);
+    }
+    acceptThread = std::thread(&SolverService::acceptLoop, this);
+}
+
+void SolverService::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+
+    ::shutdown(listenFd, SHUT_RDWR);
+    acceptThread.join();
+    ::close(listenFd);
+    if (!options.socketPath.empty()) {
+        ::unlink(options.socketPath.c_str());
+    }
+
+    // Unblock every reader, then let the workers drain what was accepted
+    {
+        std::unique_lock<std::mutex> lock(connectionsMutex);
+        for (auto& weak : connections) {
+            if (auto connection = weak.lock()) {
+                ::shutdown(connection->fd, SHUT_RD);
+            }
+        }
+        connectionsDone.wait(lock, [this] { return activeReaders == 0; });
+        connections.clear();
+    }
+    queue.close();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void SolverService::acceptLoop() {
+    while (running) {
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (!running) {
+                break;
+            }
+            if (errno != EINTR) {
+                std::this_thread::sleep_for(ACCEPT_BACKOFF);
+            }
+            continue;
+        }
+        auto connection = std::make_shared<Connection>(fd);
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            if (activeReaders >= options.maxConnections) {
+                connection->reply(errorReply("-", "busy"), false);
+                continue;
+            }
+            connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                             [](const std::weak_ptr<Connection>& weak) { return weak.expired(); }),
+                              connections.end());
+            connections.push_back(connection);
+            activeReaders++;
+        }
+        std::thread(&SolverService::readLoop, this, connection).detach();
+    }
+}
+
+void SolverService::readLoop(std::shared_ptr<Connection> connection) {
+    std::string buffer;
+    char chunk[4096];
+    while (true) {
+        ssize_t received = ::recv(connection->fd, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            break;
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+        size_t begin = 0;
+        size_t end;
+        while ((end = buffer.find('\n', begin)) != std::string::npos) {
+            // Blocks here while the queue is full, so a client that sends
+            // faster than we solve stops being read
+            handleLine(connection, buffer.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        buffer.erase(0, begin);
+        if (buffer.size() > MAX_LINE_BYTES) {
+            connection->reply(errorReply("-", "line too long"), false);
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(connection->writeMutex);
+        connection->readDone = true;
+        connection->closeWriteIfDone();
+    }
+    connection.reset();
+
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    activeReaders--;
+    connectionsDone.notify_all();
+}
+
+void SolverService::handleLine(const std::shared_ptr<Connection>& connection, const std::string& line) {
+    std::istringstream fields(line);
+    std::string id;
+    std::string state;
+    if (!(fields >> id)) {
+        return;  // blank line
+    }
+    if (!(fields >> state)) {
+        connection->reply(errorReply(id, "missing state"), false);
+        return;
+    }
+    if (state == "METRICS") {
+        connection->reply(id + " METRICS " + metrics::snapshot().toJson() + "\n", false);
+        return;
+    }
+
+    Job job;
+    job.options = options.solveDefaults;
+    std::string option;
+    while (fields >> option) {
+        size_t equals = option.find('=');
+        std::string key = option.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : option.substr(equals + 1);
+        try {
+            if (key == "maxLength") {
+                job.options.maxLength = std::stoi(value);
+            } else if (key == "maxNodes") {
+                job.options.maxNodes = std::stoull(value);
+            } else if (key == "budgetUs") {
+                job.budget = std::chrono::microseconds(std::stoll(value));
+            } else if (key == "target") {
+                job.targetLength = std::stoi(value);
+            } else {
+                connection->reply(errorReply(id, "unknown option"), false);
+                return;
+            }
+        } catch (const std::exception&) {
+            connection->reply(errorReply(id, "bad option value"), false);
+            return;
+        }
+    }
+
+    Cube cube;
+    if (!cube.setState(state)) {
+        connection->reply(errorReply(id, Cube::validate(state).message()), false);
+        return;
+    }
+    faceletsToCubie(cube.getFacelets(), job.cube);
+    job.connection = connection;
+    job.id = id;
+    job.received = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(connection->writeMutex);
+        connection->pending++;
+    }
+    if (!queue.push(std::move(job))) {
+        connection->reply(errorReply(id, "shutting down"), true);
+    }
+}
+
+void SolverService::workerLoop() {
+    Solver solver;
+    Solution solution;
+    Job job;
+    AnytimeOptions anytime;
+    std::string reply;
+    // One request per visit: a worker holding several would make the later
+    // ones wait behind its solves while other workers sit idle
+    while (queue.pop(job)) {
+        auto started = std::chrono::steady_clock::now();
+        bool found;
+        if (job.budget.count() > 0) {
+            anytime.deadline = job.received + job.budget;
+            anytime.maxNodes = job.options.maxNodes;
+            anytime.targetLength = job.targetLength;
+            anytime.maxLength = job.options.maxLength;
+            found = solver.solveAnytime(job.cube, anytime, solution);
+        } else {
+            found = solver.solve(job.cube, job.options, solution);
+        }
+        auto finished = std::chrono::steady_clock::now();
+
+        reply = job.id;
+        reply += found ? " OK " + std::to_string(solution.length) + " " : " FAIL ";
+        reply += std::to_string(solution.nodes) + " " +
+                 std::to_string(microseconds(started - job.received)) + " " +
+                 std::to_string(microseconds(finished - started));
+        for (int i = 0; i < solution.length; i++) {
+            reply += ' ';
+            reply += Cube::moveName(solution.moves[i]);
+        }
+        reply += '\n';
+        job.connection->reply(reply, true);
+        // Drop the connection now rather than when the next job replaces it
+        job.connection.reset();
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef RUBIKSCUBE_SOLVERSERVICE_H
+#define RUBIKSCUBE_SOLVERSERVICE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "boundedqueue.h"
+#include "solver.h"
+
+// Line protocol, one request per line:
+//
+//   <id> <54 colour letters> [maxLength=N] [maxNodes=N] [budgetUs=N] [target=N]
+//   <id> METRICS
+//
+// budgetUs makes the solve anytime: the reply comes within N microseconds
+// of the request arriving (queueing included) with the shortest solution
+// found by then, or sooner once one is at most target moves (default 20).
+//
+// and one reply per request, in completion order:
+//
+//   <id> OK <length> <nodes> <queue_us> <solve_us> <moves...>
+//   <id> FAIL <nodes> <queue_us> <solve_us>
+//   <id> ERR <reason>
+//   <id> METRICS <counters as one line of JSON>
+//
+// The server half-closes a connection once the client has half-closed it
+// and every reply has been written, and stops reading from a client that
+// sends a line over 4096 bytes (after replying "- ERR line too long").
+// A client connecting while ServiceOptions::maxConnections are open gets
+// "- ERR busy" and is disconnected.
+
+struct ServiceOptions {
+    std::string socketPath;      // listen on this Unix socket if set...
+    int port = 0;                // ...otherwise on 127.0.0.1:port (0 = any)
+    int workers = 0;             // 0 = one per hardware thread
+    size_t queueCapacity = 1024; // readers block when this many are waiting
+    int maxConnections = 256;    // clients beyond this get "- ERR busy"
+    SolveOptions solveDefaults;
+};
+
+// Long-lived solver process: keeps the solver tables warm and solves
+// requests from any number of local clients on a fixed worker pool
+class SolverService {
+public:
+    explicit SolverService(const ServiceOptions& options);
+    ~SolverService();
+
+    // Build the tables, bind the socket and start the worker threads.
+    // Throws CubeException if the socket cannot be set up, or if the Unix
+    // socket path exists and is not a socket left by a service that died.
+    void start();
+    void stop();
+
+    // Bound TCP port, useful when started with port 0
+    int boundPort() const { return port; }
+
+private:
+    struct Connection;
+    struct Job {
+        std::shared_ptr<Connection> connection;
+        std::string id;
+        CubieCube cube;
+        SolveOptions options;
+        std::chrono::microseconds budget{0};  // anytime solve if set
+        int targetLength = 20;
+        std::chrono::steady_clock::time_point received;
+    };
+
+    void acceptLoop();
+    void readLoop(std::shared_ptr<Connection> connection);
+    void workerLoop();
+    void handleLine(const std::shared_ptr<Connection>& connection, const std::string& line);
+
+    ServiceOptions options;
+    BoundedQueue<Job> queue;
+    int listenFd;
+    int port;
+    std::atomic<bool> running;
+    std::thread acceptThread;
+    std::vector<std::thread> workers;
+
+    // Connection readers are detached; stop() shuts their sockets down and
+    // waits for them here
+    std::mutex connectionsMutex;
+    std::condition_variable connectionsDone;
+    std::vector<std::weak_ptr<Connection>> connections;
+    int activeReaders;
+};
+
+#endif
@@ -0,0 +1,397 @@
+#include "stepsolver.h"
+#include "movetables.h"
+#include "searchtables.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+constexpr int FIRST_D_CORNER = static_cast<int>(Corner::DFR);
+constexpr int FIRST_D_EDGE = static_cast<int>(Edge::DR);
+constexpr int FIRST_SLICE_EDGE = static_cast<int>(Edge::FR);
+
+// Cross edges: their placement and, bit k, the flip of piece DR + k
+constexpr int NUM_CROSS = NUM_EDGE_PLACEMENT * 16;
+
+// Longest step searched for; no F2L pair needs more than about 11 moves
+constexpr int MAX_STEP_LENGTH = 16;
+
+int crossIndex(const CubieCube& cube) {
+    int flips = 0;
+    for (int i = 0; i < NUM_EDGES; i++) {
+        int k = cube.ep[i] - FIRST_D_EDGE;
+        if (k >= 0 && k < 4) {
+            flips |= cube.eo[i] << k;
+        }
+    }
+    return cube.edgePlacement(FIRST_D_EDGE) * 16 + flips;
+}
+
+void setCrossIndex(CubieCube& cube, int index) {
+    cube.setEdgePlacement(FIRST_D_EDGE, index / 16);
+    for (int i = 0; i < NUM_EDGES; i++) {
+        int k = cube.ep[i] - FIRST_D_EDGE;
+        cube.eo[i] = static_cast<uint8_t>(k >= 0 && k < 4 ? index >> k & 1 : 0);
+    }
+}
+
+constexpr int SLOT_PRUNE_STRIDE = 4 * 2 * NUM_PIECE_COORDS;
+
+size_t slotPruneIndex(uint32_t cross, int slot, int edge) {
+    return size_t(cross) * SLOT_PRUNE_STRIDE + (slot * 2 + edge) * NUM_PIECE_COORDS;
+}
+
+// Pairs of F2L slots, numbered for the two-slot tables
+constexpr int NUM_SLOT_PAIRS = 6;
+constexpr int SLOT_PAIR[4][4] = {{-1, 0, 1, 2}, {0, -1, 3, 4}, {1, 3, -1, 5}, {2, 4, 5, -1}};
+
+// Move tables and the pruning tables of each step: the cross edges alone,
+// for every F2L slot the cross with the slot's corner and with its edge,
+// and for every two slots their four pieces. The first two layers are
+// solved exactly when the cross and all eight single-slot tables read
+// zero; the two-slot tables see how filling one slot disturbs another.
+struct StepTables {
+    std::vector<uint32_t> crossMove;
+    std::vector<uint8_t> crossPrune;
+    // [cross * 192 + slot * 48 + corner] and [... + 24 + edge]: every
+    // single-slot bound of a node is in the same few cache lines
+    std::vector<uint8_t> slotPrune;
+    // [SLOT_PAIR[a][b]][((corner a * 24 + edge a) * 24 + corner b) * 24 + edge b], a < b
+    std::vector<uint8_t> slotPairPrune[NUM_SLOT_PAIRS];
+};
+
+StepTables buildTables() {
+    StepTables t;
+    buildMoveTable(t.crossMove, NUM_CROSS, crossIndex, setCrossIndex, false);
+
+    static const int moves[NUM_MOVES] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17};
+    const uint32_t crossRoot = static_cast<uint32_t>(crossIndex(CubieCube()));
+    const uint32_t* crossMove = t.crossMove.data();
+    buildPruneTable(t.crossPrune, NUM_CROSS, moves, NUM_MOVES,
+                    [=](uint32_t index, int m) { return crossMove[index * NUM_MOVES + m]; }, {crossRoot});
+    t.slotPrune.resize(size_t(NUM_CROSS) * SLOT_PRUNE_STRIDE);
+    std::vector<uint8_t> prune;
+    for (int slot = 0; slot < 4; slot++) {
+        for (int edge = 0; edge < 2; edge++) {
+            const auto* pieceMove = edge ? &EDGE_COORD_MOVE : &CORNER_COORD_MOVE;
+            uint32_t piece = edge ? (FIRST_SLICE_EDGE + slot) * 2 : (FIRST_D_CORNER + slot) * 3;
+            buildPruneTable(prune, NUM_CROSS * NUM_PIECE_COORDS, moves, NUM_MOVES,
+                            [=](uint32_t index, int m) {
+                                return crossMove[index / NUM_PIECE_COORDS * NUM_MOVES + m] * NUM_PIECE_COORDS +
+                                       (*pieceMove)[index % NUM_PIECE_COORDS][m];
+                            },
+                            {crossRoot * NUM_PIECE_COORDS + piece});
+            for (int cross = 0; cross < NUM_CROSS; cross++) {
+                std::copy(prune.begin() + size_t(cross) * NUM_PIECE_COORDS,
+                          prune.begin() + size_t(cross + 1) * NUM_PIECE_COORDS,
+                          t.slotPrune.begin() + slotPruneIndex(cross, slot, edge));
+            }
+        }
+    }
+    const uint32_t numSlotPair = NUM_PIECE_COORDS * NUM_PIECE_COORDS * NUM_PIECE_COORDS * NUM_PIECE_COORDS;
+    for (int a = 0; a < 4; a++) {
+        for (int b = a + 1; b < 4; b++) {
+            uint32_t root = (((FIRST_D_CORNER + a) * 3 * NUM_PIECE_COORDS + (FIRST_SLICE_EDGE + a) * 2) *
+                             NUM_PIECE_COORDS + (FIRST_D_CORNER + b) * 3) * NUM_PIECE_COORDS +
+                            (FIRST_SLICE_EDGE + b) * 2;
+            buildPruneTable(t.slotPairPrune[SLOT_PAIR[a][b]], numSlotPair, moves, NUM_MOVES,
+                            [=](uint32_t index, int m) {
+                                uint32_t result = 0;
+                                for (uint32_t scale = numSlotPair / NUM_PIECE_COORDS, piece = 0; scale > 0;
+                                     scale /= NUM_PIECE_COORDS, piece++) {
+                                    uint32_t coord = index / scale % NUM_PIECE_COORDS;
+                                    result += (piece % 2 ? EDGE_COORD_MOVE[coord][m] : CORNER_COORD_MOVE[coord][m]) *
+                                              scale;
+                                }
+                                return result;
+                            },
+                            {root});
+        }
+    }
+    return t;
+}
+
+const StepTables& tables() {
+    static const StepTables instance = buildTables();
+    return instance;
+}
+
+} // namespace
+
+const char* cfopStepName(CfopStep step) {
+    switch (step) {
+        case CfopStep::CROSS: return "cross";
+        case CfopStep::F2L_1: return "f2l1";
+        case CfopStep::F2L_2: return "f2l2";
+        case CfopStep::F2L_3: return "f2l3";
+        case CfopStep::F2L_4: return "f2l4";
+        case CfopStep::OLL: return "oll";
+        case CfopStep::PLL: return "pll";
+        case CfopStep::COUNT: break;
+    }
+    return "";
+}
+
+int StepSolution::length() const {
+    int total = 0;
+    for (const Solution& step : steps) {
+        total += step.length;
+    }
+    return total;
+}
+
+std::string StepSolution::toString() const {
+    std::string result;
+    for (int i = 0; i < NUM_CFOP_STEPS; i++) {
+        if (i > 0) {
+            result += " | ";
+        }
+        result += cfopStepName(static_cast<CfopStep>(i));
+        result += "(" + std::to_string(steps[i].length) + "):";
+        if (steps[i].length > 0) {
+            result += " " + steps[i].toString();
+        }
+    }
+    return result;
+}
+
+StepSolver::StepSolver(const LastLayerTable& oll, const LastLayerTable& pll)
+    : oll(oll), pll(pll), solvedMask(0), length(0), nodes(0), path{} {
+    if (oll.set() != LastLayerSet::OLL || oll.caseCount() == 0) {
+        throw CubeException("Step solver needs an OLL table");
+    }
+    if (pll.set() != LastLayerSet::PLL || pll.caseCount() == 0) {
+        throw CubeException("Step solver needs a PLL table");
+    }
+}
+
+void StepSolver::warmUp() {
+    tables();
+}
+
+bool StepSolver::solve(const CubieCube& cube, StepSolution& out) {
+    Node node;
+    node.cross = static_cast<uint32_t>(crossIndex(cube));
+    for (int i = 0; i < NUM_CORNERS; i++) {
+        int k = cube.cp[i] - FIRST_D_CORNER;
+        if (k >= 0) {
+            node.corners[k] = static_cast<uint8_t>(i * 3 + cube.co[i]);
+        }
+    }
+    for (int i = 0; i < NUM_EDGES; i++) {
+        int k = cube.ep[i] - FIRST_SLICE_EDGE;
+        if (k >= 0) {
+            node.edges[k] = static_cast<uint8_t>(i * 2 + cube.eo[i]);
+        }
+    }
+
+    solveCross(node, out.steps[static_cast<int>(CfopStep::CROSS)]);
+    int solved = 0;
+    for (int i = 0; i < 4; i++) {
+        int slot = 0;
+        if (!solvePair(node, solved, out.steps[static_cast<int>(CfopStep::F2L_1) + i], slot)) {
+            return false;
+        }
+        out.pairSlots[i] = static_cast<uint8_t>(slot);
+        solved |= 1 << slot;
+    }
+
+    // The pieces outside the last layer are solved now; replay the moves
+    // on the whole cube for the last-layer lookups
+    CubieCube state = cube;
+    for (int i = static_cast<int>(CfopStep::CROSS); i <= static_cast<int>(CfopStep::F2L_4); i++) {
+        for (int k = 0; k < out.steps[i].length; k++) {
+            state.multiply(moveCube(out.steps[i].moves[k]));
+        }
+    }
+    Solution& ollStep = out.steps[static_cast<int>(CfopStep::OLL)];
+    if (oll.lookup(state, ollStep) < 0) {
+        return false;
+    }
+    for (int k = 0; k < ollStep.length; k++) {
+        state.multiply(moveCube(ollStep.moves[k]));
+    }
+    return pll.lookup(state, out.steps[static_cast<int>(CfopStep::PLL)]) >= 0;
+}
+
+StepSolver::Node StepSolver::applyMove(const Node& node, int move) {
+    const StepTables& t = tables();
+    Node child;
+    child.cross = t.crossMove[node.cross * NUM_MOVES + move];
+    for (int i = 0; i < 4; i++) {
+        child.corners[i] = CORNER_COORD_MOVE[node.corners[i]][move];
+        child.edges[i] = EDGE_COORD_MOVE[node.edges[i]][move];
+    }
+    return child;
+}
+
+bool StepSolver::solve(const Cube& cube, StepSolution& out) {
+    CubieCube cubies;
+    StateValidation validation = faceletsToCubie(cube.getFacelets(), cubies);
+    if (!validation.ok()) {
+        throw CubeException(std::string("Invalid cube: ") + validation.message());
+    }
+    return solve(cubies, out);
+}
+
+// The cross table is exact, so follow any move that gets one step closer
+void StepSolver::solveCross(Node& node, Solution& out) {
+    const StepTables& t = tables();
+    uint32_t index = node.cross;
+    out.length = 0;
+    out.nodes = 0;
+    for (int distance = t.crossPrune[index]; distance > 0; distance--) {
+        for (int m = 0; m < NUM_MOVES; m++) {
+            uint32_t next = t.crossMove[index * NUM_MOVES + m];
+            out.nodes++;
+            if (t.crossPrune[next] == distance - 1) {
+                index = next;
+                out.moves[out.length++] = static_cast<uint8_t>(m);
+                break;
+            }
+        }
+    }
+    for (int k = 0; k < out.length; k++) {
+        node = applyMove(node, out.moves[k]);
+    }
+}
+
+int StepSolver::slotBound(const Node& node, int slot) const {
+    const uint8_t* prune = &tables().slotPrune[slotPruneIndex(node.cross, slot, 0)];
+    return std::max(prune[node.corners[slot]], prune[NUM_PIECE_COORDS + node.edges[slot]]);
+}
+
+int StepSolver::slotPairBound(const Node& node, int a, int b) const {
+    if (a > b) {
+        std::swap(a, b);
+    }
+    uint32_t index = ((node.corners[a] * NUM_PIECE_COORDS + node.edges[a]) * NUM_PIECE_COORDS + node.corners[b]) *
+                     NUM_PIECE_COORDS + node.edges[b];
+    return tables().slotPairPrune[SLOT_PAIR[a][b]][index];
+}
+
+// Whether the node can be within togo moves of the step's goal: the
+// solved slots' distances, alone and two at a time, and some open slot's
+// distance together with each solved slot. If so, nearest is that open
+// slot. Checks the solved slots first, as most moves break one of them,
+// and stops at the first bound over togo.
+bool StepSolver::withinBound(const Node& node, int togo, int& nearest) const {
+    for (int i = 0; i < 4; i++) {
+        if (!(solvedMask & (1 << i))) {
+            continue;
+        }
+        if (slotBound(node, i) > togo) {
+            return false;
+        }
+        for (int j = i + 1; j < 4; j++) {
+            if ((solvedMask & (1 << j)) && slotPairBound(node, i, j) > togo) {
+                return false;
+            }
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        if (solvedMask & (1 << i) || slotBound(node, i) > togo) {
+            continue;
+        }
+        bool reachable = true;
+        for (int j = 0; j < 4 && reachable; j++) {
+            reachable = !(solvedMask & (1 << j)) || slotPairBound(node, i, j) <= togo;
+        }
+        if (reachable) {
+            nearest = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Shortest sequence that solves one more slot and keeps the cross and the
+// slots in solved; false if there is none within MAX_STEP_LENGTH
+bool StepSolver::solvePair(Node& node, int solved, Solution& out, int& slot) {
+    solvedMask = solved;
+    nodes = 0;
+    out.length = -1;
+    for (length = 0; length <= MAX_STEP_LENGTH; length++) {
+        if (searchPair(node, 0, NO_MOVE, slot)) {
+            out.length = length;
+            std::copy(path.begin(), path.begin() + length, out.moves.begin());
+            break;
+        }
+    }
+    out.nodes = nodes;
+    for (int k = 0; k < out.length; k++) {
+        node = applyMove(node, out.moves[k]);
+    }
+    return out.length >= 0;
+}
+
+bool StepSolver::searchPair(const Node& node, int depth, uint8_t previous, int& slot) {
+    nodes++;
+    int togo = length - depth;
+    int nearest = -1;
+    if (!withinBound(node, togo, nearest)) {
+        return false;
+    }
+    if (togo == 0) {
+        slot = nearest;
+        return true;
+    }
+
+    for (int m = 0; m < NUM_MOVES; m++) {
+        if (!canFollow(previous, m)) {
+            continue;
+        }
+        path[depth] = static_cast<uint8_t>(m);
+        if (searchPair(applyMove(node, m), depth + 1, static_cast<uint8_t>(m), slot)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<uint8_t> solveStepBatch(const LastLayerTable& oll, const LastLayerTable& pll,
+                                    const StepBatchOptions& options,
+                                    const std::function<void(uint64_t, uint64_t)>& progress) {
+    constexpr uint64_t BATCH_CHUNK = 256;
+    StepSolver check(oll, pll);  // throws here rather than on a worker
+    StepSolver::warmUp();
+    std::vector<uint8_t> lengths(options.count * NUM_CFOP_STEPS);
+    std::atomic<uint64_t> next{0};
+    std::atomic<uint64_t> done{0};
+    auto worker = [&] {
+        StepSolver solver(oll, pll);
+        StepSolution solution;
+        for (uint64_t chunk = next++; chunk * BATCH_CHUNK < options.count; chunk = next++) {
+            std::mt19937_64 gen(splitMix64(options.seed ^ splitMix64(chunk)));
+            uint64_t end = std::min(options.count, (chunk + 1) * BATCH_CHUNK);
+            for (uint64_t i = chunk * BATCH_CHUNK; i < end; i++) {
+                bool solved = solver.solve(CubieCube::random(gen), solution);
+                for (int step = 0; step < NUM_CFOP_STEPS; step++) {
+                    lengths[i * NUM_CFOP_STEPS + step] =
+                        solved ? static_cast<uint8_t>(solution.steps[step].length) : STEP_FAILED;
+                }
+            }
+            done += end - chunk * BATCH_CHUNK;
+        }
+    };
+
+    int threadCount = options.threads > 0 ? options.threads
+                                          : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back(worker);
+    }
+    if (progress) {
+        while (done < options.count) {
+            progress(done, options.count);
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+        progress(done, options.count);
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    return lengths;
+}
@@ -0,0 +1,95 @@
+#ifndef RUBIKSCUBE_STEPSOLVER_H
+#define RUBIKSCUBE_STEPSOLVER_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "lastlayer.h"
+#include "solver.h"
+
+// Steps of the CFOP method, solving the D layer first
+enum class CfopStep { CROSS, F2L_1, F2L_2, F2L_3, F2L_4, OLL, PLL, COUNT };
+
+constexpr int NUM_CFOP_STEPS = static_cast<int>(CfopStep::COUNT);
+
+const char* cfopStepName(CfopStep step);
+
+struct StepSolution {
+    std::array<Solution, NUM_CFOP_STEPS> steps;
+    // Slot (0-3: FR, FL, BL, BR) that each F2L step paired up
+    std::array<uint8_t, 4> pairSlots{};
+
+    const Solution& operator[](CfopStep step) const { return steps[static_cast<int>(step)]; }
+    int length() const;            // all steps, counted separately
+    std::string toString() const;  // "cross(6): ... | f2l1(7): ... | ..."; display only
+};
+
+// Human-method solver: an optimal cross, then each F2L pair in whichever
+// slot is cheapest to fill next without breaking what is solved, then the
+// OLL and PLL algorithms from last-layer tables. Each step is a small IDA*
+// search on per-piece coordinates with per-step pruning tables, which are
+// shared by all instances and built once. Use one StepSolver per thread;
+// solve() does not allocate.
+class StepSolver {
+public:
+    // Throws CubeException unless oll and pll are tables of those sets.
+    // The tables must outlive the solver.
+    StepSolver(const LastLayerTable& oll, const LastLayerTable& pll);
+
+    // Build the shared tables now instead of on the first solve
+    static void warmUp();
+
+    // Returns false, leaving out incomplete, if an F2L step finds no
+    // sequence within its length limit or a last-layer table has no
+    // entry for the state; neither should happen for a reachable cube
+    bool solve(const CubieCube& cube, StepSolution& out);
+    // Throws CubeException if the cube is not in a reachable state
+    bool solve(const Cube& cube, StepSolution& out);
+
+private:
+    // Search state: the D edges as one coordinate, and every D corner and
+    // slice edge as slot * 3 + twist or slot * 2 + flip
+    struct Node {
+        uint32_t cross;
+        std::array<uint8_t, 4> corners;
+        std::array<uint8_t, 4> edges;
+    };
+
+    static Node applyMove(const Node& node, int move);
+
+    void solveCross(Node& node, Solution& out);
+    bool solvePair(Node& node, int solved, Solution& out, int& slot);
+    bool searchPair(const Node& node, int depth, uint8_t previous, int& slot);
+    int slotBound(const Node& node, int slot) const;
+    int slotPairBound(const Node& node, int a, int b) const;
+    bool withinBound(const Node& node, int togo, int& nearest) const;
+
+    const LastLayerTable& oll;
+    const LastLayerTable& pll;
+    int solvedMask;  // F2L slots solved so far, during solvePair()
+    int length;
+    uint64_t nodes;
+    std::array<uint8_t, MAX_SOLUTION_LENGTH> path;
+};
+
+struct StepBatchOptions {
+    uint64_t count = 0;  // random scrambles to solve
+    uint64_t seed = 1;
+    int threads = 0;     // 0 = one per hardware thread
+};
+
+// Move count recorded for every step of a scramble the solver failed on
+constexpr uint8_t STEP_FAILED = 0xFF;
+
+// Solve count uniformly random scrambles on every core. Returns the move
+// count of each step, NUM_CFOP_STEPS bytes per scramble in order, or
+// STEP_FAILED bytes for a scramble solve() failed on; scramble i depends
+// only on the seed and i, not on the thread count.
+// progress, if set, is called from the calling thread with (done, count).
+std::vector<uint8_t> solveStepBatch(const LastLayerTable& oll, const LastLayerTable& pll,
+                                    const StepBatchOptions& options,
+                                    const std::function<void(uint64_t, uint64_t)>& progress = nullptr);
+
+#endif